@@ -0,0 +1,432 @@
+/* createfs.c - builds a filesystem image for the OS from a directory
+ *
+ * usage: createfs -i <dir> -o <image> [-v 1|2] [-d] [-z] [-n inodes] [-q]
+ *
+ * The image is a bootblock holding the root directory, then the inodes,
+ * then the data blocks.  Names are sorted, so the same directory always
+ * gives the same image, and each file's blocks are placed back to back in
+ * that order.  The root has no inode of its own: it is the bootblock, whose
+ * "." entry and every top-level ".." name it by inode number 0, so inode 0
+ * is left empty and the rest are numbered from 1.  An "rtc" device entry is
+ * added unless the directory already has one.
+ *
+ *   -v 2  version 2 inodes (flags word, single and double indirect blocks)
+ *   -d    mirror subdirectories as directory inodes
+ *   -z    store files LZ4 compressed when that saves at least 1/8 (needs -v 2)
+ *   -n    make at least this many inodes (default 64, like the old images)
+ *   -q    do not print the layout statistics
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lz4.h"
+
+#define BLOCK_SIZE 4096
+#define NAME_LEN 32
+#define DENTRY_SIZE 64
+#define MAX_ROOT_ENTRIES 63
+#define DIRECT_V1 1023
+#define DIRECT_V2 1020
+#define NUMS_PER_BLOCK (BLOCK_SIZE / 4)
+#define DEFAULT_INODES 64
+
+#define FS_MAGIC 0x46533931
+#define FEAT_SUBDIRS 0x1
+#define INODE_FLAG_LZ4 0x1
+
+#define TYPE_RTC 0
+#define TYPE_DIR 1
+#define TYPE_FILE 2
+
+typedef struct node {
+    char name[NAME_LEN + 1];
+    int type;
+    uint32_t inode;
+    uint8_t* data;              /* file contents, or a directory's entries */
+    size_t len;
+    uint8_t* stored;            /* what goes in the blocks: data or an LZ4 stream */
+    size_t stored_len;
+    int compressed;
+    uint32_t* blocks;           /* data block numbers, in file order */
+    size_t nblocks;
+    uint32_t indirect;          /* version 2, 0 when unused */
+    uint32_t double_indirect;
+    uint32_t* tables;           /* indirect blocks, written after the data */
+    size_t ntables;
+    struct node* parent;
+    struct node** kids;
+    size_t nkids;
+} node_t;
+
+static int version = 1, subdirs = 0, compress = 0, quiet = 0;
+static uint32_t next_inode = 1, next_block = 0;
+
+static void die (const char* fmt, const char* arg)
+{
+    fprintf (stderr, "createfs: ");
+    fprintf (stderr, fmt, arg);
+    fputc ('\n', stderr);
+    exit (1);
+}
+
+static void* xcalloc (size_t n, size_t size)
+{
+    void* p = calloc (n ? n : 1, size ? size : 1);
+
+    if (NULL == p)
+        die ("%s", "out of memory");
+    return p;
+}
+
+static void put32 (uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static int by_name (const void* a, const void* b)
+{
+    return strcmp ((*(node_t* const*)a)->name, (*(node_t* const*)b)->name);
+}
+
+static uint8_t* read_file (const char* path, size_t* len)
+{
+    FILE* f = fopen (path, "rb");
+    uint8_t* buf;
+    long n;
+
+    if (NULL == f || fseek (f, 0, SEEK_END) || (n = ftell (f)) < 0 || fseek (f, 0, SEEK_SET))
+        die ("cannot read %s", path);
+    buf = xcalloc (n, 1);
+    if ((size_t)n != fread (buf, 1, n, f))
+        die ("cannot read %s", path);
+    fclose (f);
+    *len = n;
+    return buf;
+}
+
+static node_t* new_node (const char* name, int type, node_t* parent)
+{
+    node_t* n = xcalloc (1, sizeof (node_t));
+
+    if (strlen (name) > NAME_LEN)
+        fprintf (stderr, "createfs: warning: %s is cut to %d characters\n", name, NAME_LEN);
+    strncpy (n->name, name, NAME_LEN);
+    n->type = type;
+    n->parent = parent;
+    return n;
+}
+
+/* Reads a directory into dir's children, sorted by name. */
+static void scan (const char* path, node_t* dir)
+{
+    DIR* d = opendir (path);
+    struct dirent* de;
+    struct stat st;
+    char* sub;
+    node_t* kid;
+    size_t cap = 16, i;
+
+    if (NULL == d)
+        die ("cannot open directory %s", path);
+    dir->kids = xcalloc (cap, sizeof (node_t*));
+    while (NULL != (de = readdir (d))) {
+        if (0 == strcmp (de->d_name, ".") || 0 == strcmp (de->d_name, ".."))
+            continue;
+        sub = xcalloc (strlen (path) + strlen (de->d_name) + 2, 1);
+        sprintf (sub, "%s/%s", path, de->d_name);
+        if (stat (sub, &st))
+            die ("cannot stat %s", sub);
+        if (S_ISDIR (st.st_mode)) {
+            if (!subdirs)
+                die ("%s is a directory, subdirectories need -d", sub);
+            kid = new_node (de->d_name, TYPE_DIR, dir);
+            scan (sub, kid);
+        } else if (S_ISREG (st.st_mode)) {
+            kid = new_node (de->d_name, TYPE_FILE, dir);
+            kid->data = read_file (sub, &kid->len);
+        } else {
+            fprintf (stderr, "createfs: warning: skipping %s\n", sub);
+            free (sub);
+            continue;
+        }
+        free (sub);
+        if (dir->nkids == cap)
+            dir->kids = realloc (dir->kids, (cap *= 2) * sizeof (node_t*));
+        dir->kids[dir->nkids++] = kid;
+    }
+    closedir (d);
+    qsort (dir->kids, dir->nkids, sizeof (node_t*), by_name);
+    for (i = 1; i < dir->nkids; i++)
+        if (0 == strcmp (dir->kids[i - 1]->name, dir->kids[i]->name))
+            die ("two names in one directory are the same in %s characters", "32");
+}
+
+/* Gives every file and directory an inode, depth first in name order. */
+static void number (node_t* dir)
+{
+    size_t i;
+
+    for (i = 0; i < dir->nkids; i++) {
+        if (TYPE_RTC == dir->kids[i]->type)
+            continue;
+        dir->kids[i]->inode = next_inode++;
+        if (TYPE_DIR == dir->kids[i]->type)
+            number (dir->kids[i]);
+    }
+}
+
+static void put_dentry (uint8_t* p, const char* name, int type, uint32_t inode)
+{
+    memset (p, 0, DENTRY_SIZE);
+    memcpy (p, name, strnlen (name, NAME_LEN));
+    put32 (p + NAME_LEN, type);
+    put32 (p + NAME_LEN + 4, inode);
+}
+
+/* Fills in a subdirectory's entries: ".", "..", then its children. */
+static void build_dir (node_t* dir)
+{
+    size_t i;
+
+    dir->len = (dir->nkids + 2) * DENTRY_SIZE;
+    dir->data = xcalloc (dir->len, 1);
+    put_dentry (dir->data, ".", TYPE_DIR, dir->inode);
+    put_dentry (dir->data + DENTRY_SIZE, "..", TYPE_DIR, dir->parent->inode);
+    for (i = 0; i < dir->nkids; i++)
+        put_dentry (dir->data + (i + 2) * DENTRY_SIZE, dir->kids[i]->name,
+                    dir->kids[i]->type, dir->kids[i]->inode);
+}
+
+/* Picks what is stored for a node and places its blocks right after the
+ * previous node's, then its indirect blocks, then its children's. */
+static void layout (node_t* n)
+{
+    size_t i, cap, rest;
+
+    if (TYPE_DIR == n->type && 0 != n->inode)
+        build_dir (n);
+    if (0 != n->inode) {
+        n->stored = n->data;
+        n->stored_len = n->len;
+        if (compress && TYPE_FILE == n->type && n->len > 0) {
+            cap = n->len + (n->len / BLOCK_SIZE + 2) * 4;
+            n->stored = xcalloc (cap, 1);
+            n->stored_len = lz4_pack_chunks (n->data, n->len, BLOCK_SIZE, n->stored, cap);
+            if (0 == n->stored_len || n->stored_len > n->len - n->len / 8) {
+                free (n->stored);
+                n->stored = n->data;
+                n->stored_len = n->len;
+            } else {
+                n->compressed = 1;
+            }
+        }
+        n->nblocks = (n->stored_len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (1 == version && n->nblocks > DIRECT_V1)
+            die ("%s is too big for version 1 inodes, use -v 2", n->name);
+        if (n->nblocks > DIRECT_V2 + NUMS_PER_BLOCK + (size_t)NUMS_PER_BLOCK * NUMS_PER_BLOCK)
+            die ("%s is too big for the double indirect block", n->name);
+        n->blocks = xcalloc (n->nblocks, sizeof (uint32_t));
+        for (i = 0; i < n->nblocks; i++)
+            n->blocks[i] = next_block++;
+
+        if (2 == version && n->nblocks > DIRECT_V2) {
+            rest = n->nblocks - DIRECT_V2;
+            n->ntables = 1;
+            if (rest > NUMS_PER_BLOCK) {
+                rest -= NUMS_PER_BLOCK;
+                n->ntables += 1 + (rest + NUMS_PER_BLOCK - 1) / NUMS_PER_BLOCK;
+            }
+            n->tables = xcalloc (n->ntables, sizeof (uint32_t));
+            for (i = 0; i < n->ntables; i++)
+                n->tables[i] = next_block++;
+            n->indirect = n->tables[0];
+            if (n->ntables > 1)
+                n->double_indirect = n->tables[1];
+        }
+    }
+    for (i = 0; i < n->nkids; i++)
+        layout (n->kids[i]);
+}
+
+static uint8_t* image;
+static uint32_t num_inodes;
+
+static uint8_t* block_at (uint32_t data_block)
+{
+    return image + (size_t)(1 + num_inodes + data_block) * BLOCK_SIZE;
+}
+
+/* Writes a node's inode, data and indirect blocks, then its children's. */
+static void emit (node_t* n)
+{
+    uint8_t* ino = image + (size_t)(1 + n->inode) * BLOCK_SIZE;
+    uint8_t* p;
+    size_t i, k;
+
+    if (0 != n->inode) {
+        put32 (ino, n->len);
+        if (1 == version) {
+            for (i = 0; i < n->nblocks; i++)
+                put32 (ino + 4 + i * 4, n->blocks[i]);
+        } else {
+            put32 (ino + 4, n->compressed ? INODE_FLAG_LZ4 : 0);
+            for (i = 0; i < n->nblocks && i < DIRECT_V2; i++)
+                put32 (ino + 8 + i * 4, n->blocks[i]);
+            put32 (ino + 8 + DIRECT_V2 * 4, n->indirect);
+            put32 (ino + 12 + DIRECT_V2 * 4, n->double_indirect);
+            /* single indirect block, then the double one, then its leaves */
+            for (i = DIRECT_V2; i < n->nblocks && i < DIRECT_V2 + NUMS_PER_BLOCK; i++)
+                put32 (block_at (n->indirect) + (i - DIRECT_V2) * 4, n->blocks[i]);
+            for (k = 2; k < n->ntables; k++) {
+                put32 (block_at (n->double_indirect) + (k - 2) * 4, n->tables[k]);
+                p = block_at (n->tables[k]);
+                for (i = 0; i < NUMS_PER_BLOCK; i++) {
+                    size_t b = DIRECT_V2 + NUMS_PER_BLOCK + (k - 2) * NUMS_PER_BLOCK + i;
+                    if (b >= n->nblocks)
+                        break;
+                    put32 (p + i * 4, n->blocks[b]);
+                }
+            }
+        }
+        for (i = 0; i < n->nblocks; i++) {
+            k = n->stored_len - i * BLOCK_SIZE;
+            memcpy (block_at (n->blocks[i]), n->stored + i * BLOCK_SIZE, k < BLOCK_SIZE ? k : BLOCK_SIZE);
+        }
+    }
+    for (i = 0; i < n->nkids; i++)
+        emit (n->kids[i]);
+}
+
+typedef struct {
+    size_t files, dirs, compressed;
+    size_t bytes, stored_bytes, blocks, runs, fragmented;
+} stats_t;
+
+static void gather (node_t* n, stats_t* s)
+{
+    size_t i, runs;
+
+    if (0 != n->inode) {
+        if (TYPE_DIR == n->type)
+            s->dirs++;
+        else
+            s->files++;
+        s->compressed += n->compressed;
+        s->bytes += n->len;
+        s->stored_bytes += n->stored_len;
+        s->blocks += n->nblocks + n->ntables;
+        for (runs = n->nblocks ? 1 : 0, i = 1; i < n->nblocks; i++)
+            if (n->blocks[i] != n->blocks[i - 1] + 1)
+                runs++;
+        s->runs += runs;
+        s->fragmented += runs > 1;
+    }
+    for (i = 0; i < n->nkids; i++)
+        gather (n->kids[i], s);
+}
+
+static void usage (void)
+{
+    fprintf (stderr, "usage: createfs -i <dir> -o <image> [-v 1|2] [-d] [-z] [-n inodes] [-q]\n");
+    exit (1);
+}
+
+int main (int argc, char** argv)
+{
+    const char* in = NULL;
+    const char* out = NULL;
+    uint32_t min_inodes = DEFAULT_INODES, features = 0;
+    node_t* root;
+    stats_t s;
+    size_t i, size;
+    FILE* f;
+    int has_rtc = 0;
+
+    for (i = 1; i < (size_t)argc; i++) {
+        if (0 == strcmp (argv[i], "-i") && i + 1 < (size_t)argc)
+            in = argv[++i];
+        else if (0 == strcmp (argv[i], "-o") && i + 1 < (size_t)argc)
+            out = argv[++i];
+        else if (0 == strcmp (argv[i], "-v") && i + 1 < (size_t)argc)
+            version = atoi (argv[++i]);
+        else if (0 == strcmp (argv[i], "-n") && i + 1 < (size_t)argc)
+            min_inodes = atoi (argv[++i]);
+        else if (0 == strcmp (argv[i], "-d"))
+            subdirs = 1;
+        else if (0 == strcmp (argv[i], "-z"))
+            compress = 1;
+        else if (0 == strcmp (argv[i], "-q"))
+            quiet = 1;
+        else
+            usage ();
+    }
+    if (NULL == in || NULL == out || (1 != version && 2 != version))
+        usage ();
+    if (compress && 2 != version)
+        die ("%s", "-z needs version 2 inodes (-v 2)");
+
+    root = new_node (".", TYPE_DIR, NULL);
+    root->parent = root;
+    scan (in, root);
+    for (i = 0; i < root->nkids; i++)
+        has_rtc |= 0 == strcmp (root->kids[i]->name, "rtc");
+    if (!has_rtc) {
+        root->kids = realloc (root->kids, (root->nkids + 1) * sizeof (node_t*));
+        root->kids[root->nkids++] = new_node ("rtc", TYPE_RTC, root);
+        qsort (root->kids, root->nkids, sizeof (node_t*), by_name);
+    }
+    if (root->nkids + 1 > MAX_ROOT_ENTRIES)
+        die ("%s has more entries than the bootblock holds (62), move some into a subdirectory with -d", in);
+
+    number (root);
+    num_inodes = next_inode > min_inodes ? next_inode : min_inodes;
+    layout (root);
+
+    size = (size_t)(1 + num_inodes + next_block) * BLOCK_SIZE;
+    image = xcalloc (size, 1);
+    put32 (image, root->nkids + 1);
+    put32 (image + 4, num_inodes);
+    put32 (image + 8, next_block);
+    if (subdirs)
+        features |= FEAT_SUBDIRS;
+    /* the original format has no magic, so old kernels still read -v 1 images */
+    if (2 == version || 0 != features) {
+        put32 (image + 12, FS_MAGIC);
+        put32 (image + 16, version);
+        put32 (image + 20, features);
+    }
+    put_dentry (image + DENTRY_SIZE, ".", TYPE_DIR, 0);
+    for (i = 0; i < root->nkids; i++)
+        put_dentry (image + (i + 2) * DENTRY_SIZE, root->kids[i]->name, root->kids[i]->type, root->kids[i]->inode);
+    emit (root);
+
+    if (NULL == (f = fopen (out, "wb")) || size != fwrite (image, 1, size, f) || fclose (f))
+        die ("cannot write %s", out);
+
+    if (!quiet) {
+        memset (&s, 0, sizeof (s));
+        gather (root, &s);
+        printf ("%s: version %d, %lu files, %lu directories, %u of %u inodes, %u data blocks, %lu bytes\n",
+                out, version, (unsigned long)s.files, (unsigned long)s.dirs, next_inode, num_inodes,
+                next_block, (unsigned long)size);
+        printf ("packing: %lu bytes stored in %lu blocks, %.1f%% of the block space used\n",
+                (unsigned long)s.stored_bytes, (unsigned long)s.blocks,
+                s.blocks ? 100.0 * s.stored_bytes / ((double)s.blocks * BLOCK_SIZE) : 100.0);
+        printf ("fragmentation: %lu runs over %lu files and directories, %lu split\n",
+                (unsigned long)s.runs, (unsigned long)(s.files + s.dirs), (unsigned long)s.fragmented);
+        if (compress)
+            printf ("compression: %lu files, %lu -> %lu bytes overall (%.2fx)\n",
+                    (unsigned long)s.compressed, (unsigned long)s.bytes, (unsigned long)s.stored_bytes,
+                    s.stored_bytes ? (double)s.bytes / s.stored_bytes : 1.0);
+    }
+    return 0;
+}
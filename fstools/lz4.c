@@ -0,0 +1,180 @@
+/* lz4.c - LZ4 block compression for building filesystem images */
+
+#include <string.h>
+
+#include "lz4.h"
+
+#define MIN_MATCH 4         /* shortest match the format can express */
+#define LAST_LITERALS 5     /* the block must end with this many literals */
+#define MF_LIMIT 12         /* no match may start closer than this to the end */
+#define MAX_OFFSET 65535
+#define RUN_MASK 15
+#define HASH_BITS 12
+
+static uint32_t read32 (const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t hash4 (uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/* Writes the rest of a length whose nibble was RUN_MASK. */
+static int put_length (uint8_t** op, uint8_t* oend, size_t len)
+{
+    for (; len >= 255; len -= 255) {
+        if (*op >= oend)
+            return -1;
+        *(*op)++ = 255;
+    }
+    if (*op >= oend)
+        return -1;
+    *(*op)++ = (uint8_t)len;
+    return 0;
+}
+
+/* Emits literals lit[0..nlit) followed by a match, or only the literals
+ * when mlen is 0. */
+static int put_sequence (uint8_t** op, uint8_t* oend, const uint8_t* lit, size_t nlit,
+                         size_t offset, size_t mlen)
+{
+    uint8_t* token;
+    size_t ml = mlen ? mlen - MIN_MATCH : 0;
+
+    if (*op >= oend)
+        return -1;
+    token = (*op)++;
+    *token = (uint8_t)(((nlit < RUN_MASK ? nlit : RUN_MASK) << 4) | (ml < RUN_MASK ? ml : RUN_MASK));
+    if (nlit >= RUN_MASK && put_length (op, oend, nlit - RUN_MASK))
+        return -1;
+    if ((size_t)(oend - *op) < nlit)
+        return -1;
+    memcpy (*op, lit, nlit);
+    *op += nlit;
+    if (0 == mlen)
+        return 0;
+    if (oend - *op < 2)
+        return -1;
+    *(*op)++ = offset & 0xFF;
+    *(*op)++ = offset >> 8;
+    if (ml >= RUN_MASK && put_length (op, oend, ml - RUN_MASK))
+        return -1;
+    return 0;
+}
+
+size_t lz4_compress (const uint8_t* src, size_t n, uint8_t* dst, size_t cap)
+{
+    int32_t table[1 << HASH_BITS];
+    uint8_t* op = dst;
+    uint8_t* oend = dst + cap;
+    size_t ip = 0, anchor = 0, len;
+    int32_t ref;
+    uint32_t seq, h;
+
+    memset (table, 0xFF, sizeof (table));
+    while (n >= MF_LIMIT && ip <= n - MF_LIMIT) {
+        seq = read32 (src + ip);
+        h = hash4 (seq);
+        ref = table[h];
+        table[h] = (int32_t)ip;
+        if (ref < 0 || ip - ref > MAX_OFFSET || read32 (src + ref) != seq) {
+            ip++;
+            continue;
+        }
+        for (len = MIN_MATCH; ip + len < n - LAST_LITERALS && src[ref + len] == src[ip + len]; len++);
+        if (put_sequence (&op, oend, src + anchor, ip - anchor, ip - ref, len))
+            return 0;
+        ip += len;
+        anchor = ip;
+    }
+    if (put_sequence (&op, oend, src + anchor, n - anchor, 0, 0))
+        return 0;
+    return op - dst;
+}
+
+/* Finishes a length whose nibble was RUN_MASK; -1 if the input runs out. */
+static long get_length (const uint8_t** ip, const uint8_t* iend, size_t len)
+{
+    uint8_t b;
+
+    if (RUN_MASK != len)
+        return (long)len;
+    do {
+        if (*ip >= iend)
+            return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (255 == b);
+    return (long)len;
+}
+
+long lz4_decompress (const uint8_t* src, size_t n, uint8_t* dst, size_t cap)
+{
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + n;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + cap;
+    const uint8_t* match;
+    size_t offset;
+    long len;
+    uint8_t token;
+
+    while (ip < iend) {
+        token = *ip++;
+        if ((len = get_length (&ip, iend, token >> 4)) < 0 ||
+            len > iend - ip || len > oend - op)
+            return -1;
+        memcpy (op, ip, len);
+        ip += len;
+        op += len;
+        if (ip == iend)
+            break;
+        if (iend - ip < 2)
+            return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (0 == offset || offset > (size_t)(op - dst))
+            return -1;
+        if ((len = get_length (&ip, iend, token & RUN_MASK)) < 0)
+            return -1;
+        len += MIN_MATCH;
+        if (len > oend - op)
+            return -1;
+        for (match = op - offset; len > 0; len--)
+            *op++ = *match++;
+    }
+    return op - dst;
+}
+
+size_t lz4_pack_chunks (const uint8_t* src, size_t n, size_t chunk, uint8_t* dst, size_t cap)
+{
+    size_t nchunks = (n + chunk - 1) / chunk;
+    size_t pos = (nchunks + 1) * 4;    /* the data starts after the table */
+    size_t i, in, out;
+
+    if (cap < pos)
+        return 0;
+    for (i = 0; i < nchunks; i++) {
+        dst[i * 4] = pos & 0xFF;
+        dst[i * 4 + 1] = (pos >> 8) & 0xFF;
+        dst[i * 4 + 2] = (pos >> 16) & 0xFF;
+        dst[i * 4 + 3] = (pos >> 24) & 0xFF;
+        in = n - i * chunk < chunk ? n - i * chunk : chunk;
+        /* a chunk is only kept compressed if it comes out strictly smaller */
+        out = lz4_compress (src + i * chunk, in, dst + pos, cap - pos < in - 1 ? cap - pos : in - 1);
+        if (0 == out) {
+            if (cap - pos < in)
+                return 0;
+            memcpy (dst + pos, src + i * chunk, in);
+            out = in;
+        }
+        pos += out;
+    }
+    dst[nchunks * 4] = pos & 0xFF;
+    dst[nchunks * 4 + 1] = (pos >> 8) & 0xFF;
+    dst[nchunks * 4 + 2] = (pos >> 16) & 0xFF;
+    dst[nchunks * 4 + 3] = (pos >> 24) & 0xFF;
+    return pos;
+}
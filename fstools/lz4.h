@@ -0,0 +1,27 @@
+/* lz4.h - LZ4 block compression for building filesystem images
+ *
+ * Only the block format is used: the kernel decodes one chunk of a file
+ * at a time, so there are no frames, checksums or dictionaries.
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compresses n bytes of src into dst.  Returns the compressed size, or 0
+ * if the result would not fit in cap bytes. */
+size_t lz4_compress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap);
+
+/* Decodes one block.  Returns the decoded size, or -1 if the block is
+ * malformed or larger than cap. */
+long lz4_decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t cap);
+
+/* Builds the stream a compressed inode holds: a table of chunk count + 1
+ * little-endian offsets, then each chunk of the file compressed on its
+ * own, or stored as is when it does not shrink.  Returns the stream size,
+ * or 0 if it would not fit in cap bytes. */
+size_t lz4_pack_chunks(const uint8_t* src, size_t n, size_t chunk, uint8_t* dst, size_t cap);
+
+#endif /* LZ4_H */
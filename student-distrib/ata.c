@@ -0,0 +1,486 @@
+#include "ata.h"
+#include "lib.h"
+#include "pci.h"
+#include "paging.h"
+#include "i8259.h"
+#include "pit.h"
+
+static uint32_t ata_present;
+static uint32_t ata_num_sectors;		//LBA28 capacity from IDENTIFY
+static uint32_t ata_bm_base;		//bus master registers of the channel, 0 without DMA
+static volatile uint32_t ata_busy;		//a reader owns the channel
+static volatile uint32_t ata_dma_done;
+static volatile uint32_t ata_dma_status;		//bus master status the interrupt saw
+static volatile uint32_t ata_irq_status;		//drive status the interrupt saw
+static uint64_t ata_sleep_total;		//cycles readers spent halted waiting on DMA
+static ata_prd_t ata_prdt[ATA_PRD_MAX] __attribute__((aligned(KB_4)));
+
+
+/*
+ * ata_wait
+ *   DESCRIPTION: Polls the status register until the drive is not busy
+ *   INPUTS: uint32_t want (status bits that must also be set)
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 on a drive error or timeout
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t ata_wait(uint32_t want){
+	uint32_t i, status;
+	for(i=0; i<ATA_TIMEOUT; i++){
+		status = inb(ATA_PRIMARY_IO + ATA_REG_STATUS);
+		if(status & ATA_SR_BSY){
+			continue;
+		}
+		if(status & (ATA_SR_ERR | ATA_SR_DF)){
+			return -1;
+		}
+		if((status & want) == want){
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * ata_delay
+ *   DESCRIPTION: Waits the 400ns a drive needs after a select or command
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: reads the alternate status register four times
+ */
+static void ata_delay(void){
+	inb(ATA_PRIMARY_CTRL);
+	inb(ATA_PRIMARY_CTRL);
+	inb(ATA_PRIMARY_CTRL);
+	inb(ATA_PRIMARY_CTRL);
+}
+
+/*
+ * ata_read_sector
+ *   DESCRIPTION: Moves one sector from the data register into memory
+ *   INPUTS: uint8_t* buf
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills ATA_SECTOR_SIZE bytes of buf
+ */
+static void ata_read_sector(uint8_t* buf){
+	asm volatile ("                 \n\
+            movw    %%ds, %%ax      \n\
+            movw    %%ax, %%es      \n\
+            cld                     \n\
+            rep     insw            \n\
+            "
+            :
+            : "D"(buf), "c"(ATA_SECTOR_SIZE/2), "d"(ATA_PRIMARY_IO + ATA_REG_DATA)
+            : "eax", "memory", "cc"
+    );
+}
+
+/*
+ * ata_acquire
+ *   DESCRIPTION: Waits until no other reader is using the channel and takes it
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: halts until the owner releases the channel; the PIT
+ *								 keeps scheduling everyone else meanwhile
+ */
+static void ata_acquire(void){
+	uint32_t flags;
+	cli_and_save(flags);
+	while(ata_busy){
+		sti_hlt_cli();
+	}
+	ata_busy = 1;
+	restore_flags(flags);
+}
+
+/*
+ * ata_release
+ *   DESCRIPTION: Gives the channel back
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: the next ata_acquire can go ahead
+ */
+static void ata_release(void){
+	ata_busy = 0;
+}
+
+/*
+ * ata_init_dma
+ *   DESCRIPTION: Finds the IDE controller's bus master registers
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: turns on bus mastering and IRQ 14 if the controller
+ *								 supports it, reads stay PIO otherwise
+ */
+static void ata_init_dma(void){
+	pci_dev_t pdev;
+	uint32_t bar;
+
+	ata_bm_base = 0;
+	if(pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, &pdev) == -1){
+		return;
+	}
+	if(!((pci_read(&pdev, PCI_REG_CLASS) >> 8) & PCI_IDE_BUS_MASTER)){
+		return;		//no bus master support
+	}
+	bar = pci_read(&pdev, PCI_REG_BAR4);
+	if(!(bar & 0x1) || (bar & PCI_BAR_IO_MASK) == 0){
+		return;		//the bus master block should be in I/O space
+	}
+	pci_write(&pdev, PCI_REG_COMMAND, pci_read(&pdev, PCI_REG_COMMAND) | PCI_CMD_IO | PCI_CMD_MASTER);
+	ata_bm_base = bar & PCI_BAR_IO_MASK;
+	enable_irq(ATA_IRQ);
+}
+
+/*
+ * ata_init
+ *   DESCRIPTION: Looks for a disk on the primary channel master
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 if an ATA disk answered IDENTIFY, -1 otherwise
+ *   SIDE EFFECTS: masks the channel's interrupt and records the disk size
+ */
+int32_t ata_init(void){
+	uint16_t ident[ATA_SECTOR_SIZE/2];
+	uint32_t i;
+
+	ata_present = 0;
+	if(inb(ATA_PRIMARY_IO + ATA_REG_STATUS) == 0xFF){
+		return -1;		//floating bus, nothing on the channel
+	}
+	outb(ATA_CTRL_NIEN, ATA_PRIMARY_CTRL);		//we poll, so keep IRQ 14 quiet
+	outb(ATA_DRIVE_MASTER, ATA_PRIMARY_IO + ATA_REG_DRIVE);
+	ata_delay();
+	outb(0, ATA_PRIMARY_IO + ATA_REG_SECCOUNT);
+	outb(0, ATA_PRIMARY_IO + ATA_REG_LBA_LO);
+	outb(0, ATA_PRIMARY_IO + ATA_REG_LBA_MID);
+	outb(0, ATA_PRIMARY_IO + ATA_REG_LBA_HI);
+	outb(ATA_CMD_IDENTIFY, ATA_PRIMARY_IO + ATA_REG_COMMAND);
+	ata_delay();
+	if(inb(ATA_PRIMARY_IO + ATA_REG_STATUS) == 0){
+		return -1;		//no drive
+	}
+	for(i=0; i<ATA_TIMEOUT && (inb(ATA_PRIMARY_IO + ATA_REG_STATUS) & ATA_SR_BSY); i++);
+	if(inb(ATA_PRIMARY_IO + ATA_REG_LBA_MID) != 0 || inb(ATA_PRIMARY_IO + ATA_REG_LBA_HI) != 0){
+		return -1;		//ATAPI or SATA signature, not a PIO disk
+	}
+	if(ata_wait(ATA_SR_DRQ) == -1){
+		return -1;
+	}
+	ata_read_sector((uint8_t*)ident);
+
+	ata_num_sectors = ident[60] | ((uint32_t)ident[61] << 16);	//words 60-61, LBA28 sector count
+	if(ata_num_sectors == 0){
+		return -1;		//no LBA support
+	}
+	ata_present = 1;
+	ata_init_dma();
+	return 0;
+}
+
+/*
+ * ata_read_pio
+ *   DESCRIPTION: Reads sectors from the disk with programmed I/O
+ *   INPUTS: uint32_t lba, uint32_t count, uint8_t* buf
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, -1 for failure
+ *   SIDE EFFECTS: fills buf with count sectors starting at lba; the CPU
+ *								 copies every word, with interrupts off for each
+ *								 command
+ */
+int32_t ata_read_pio(uint32_t lba, uint32_t count, uint8_t* buf){
+	uint32_t flags, n, i;
+	uint32_t done = 0;
+
+	if(!ata_present || lba >= ata_num_sectors || count > ata_num_sectors - lba){
+		return -1;
+	}
+	ata_acquire();
+	while(done < count){
+		n = count - done;
+		if(n > ATA_MAX_SECTORS){
+			n = ATA_MAX_SECTORS;
+		}
+		cli_and_save(flags);
+		if(ata_wait(0) == -1){
+			restore_flags(flags);
+			ata_release();
+			return -1;
+		}
+		outb(ATA_CTRL_NIEN, ATA_PRIMARY_CTRL);		//polled, no interrupt per sector
+		outb(ATA_DRIVE_LBA | ((lba >> 24) & 0x0F), ATA_PRIMARY_IO + ATA_REG_DRIVE);
+		outb(n & 0xFF, ATA_PRIMARY_IO + ATA_REG_SECCOUNT);		//0 means 256
+		outb(lba & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_LO);
+		outb((lba >> 8) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_MID);
+		outb((lba >> 16) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_HI);
+		outb(ATA_CMD_READ, ATA_PRIMARY_IO + ATA_REG_COMMAND);
+		ata_delay();
+		for(i=0; i<n; i++){
+			if(ata_wait(ATA_SR_DRQ) == -1){
+				restore_flags(flags);
+				ata_release();
+				return -1;
+			}
+			ata_read_sector(buf);
+			buf += ATA_SECTOR_SIZE;
+		}
+		restore_flags(flags);
+		lba += n;
+		done += n;
+	}
+	ata_release();
+	return done*ATA_SECTOR_SIZE;
+}
+
+/*
+ * ata_build_prdt
+ *   DESCRIPTION: Describes a buffer's physical frames for the bus master
+ *   INPUTS: uint8_t* buf, uint32_t bytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 if part of buf is unmapped or it needs
+ *								 more than ATA_PRD_MAX regions
+ *   SIDE EFFECTS: fills in ata_prdt; physically contiguous pages share an
+ *								 entry as long as it stays inside one 64kB window
+ */
+static int32_t ata_build_prdt(uint8_t* buf, uint32_t bytes){
+	uint32_t addr = (uint32_t)buf;
+	uint32_t phys, piece;
+	uint32_t len = 0;		//bytes in the current entry
+	int32_t i = -1;
+
+	while(bytes > 0){
+		piece = KB_4 - (addr & KB_4_MASK);		//up to the end of the page
+		if(piece > bytes){
+			piece = bytes;
+		}
+		if((phys = virt_to_phys(addr)) == 0){
+			return -1;
+		}
+		if(i >= 0 && ata_prdt[i].addr + len == phys &&
+				ata_prdt[i].addr / ATA_PRD_BOUNDARY == (phys + piece - 1) / ATA_PRD_BOUNDARY){
+			len += piece;
+		}
+		else{
+			if(++i == ATA_PRD_MAX){
+				return -1;
+			}
+			ata_prdt[i].addr = phys;
+			ata_prdt[i].flags = 0;
+			len = piece;
+		}
+		ata_prdt[i].count = len & 0xFFFF;		//a full 64kB wraps to 0, as it should
+		addr += piece;
+		bytes -= piece;
+	}
+	if(i < 0){
+		return -1;
+	}
+	ata_prdt[i].flags = ATA_PRD_EOT;
+	return 0;
+}
+
+/*
+ * ata_dma_wait
+ *   DESCRIPTION: Waits for IRQ 14 to say a DMA transfer is over
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 once it is, -1 if the drive reports an error first or
+ *								 ATA_DMA_TICKS go by without it
+ *   SIDE EFFECTS: called with interrupts off, halts with them on in between.
+ *								 At boot the PIT is not running yet, so it polls for
+ *								 ATA_TIMEOUT rounds instead of counting ticks
+ */
+static int32_t ata_dma_wait(void){
+	uint32_t deadline = pit_ticks + ATA_DMA_TICKS;
+	uint32_t i, status;
+
+	for(i=0; !ata_dma_done; i++){
+		status = inb(ATA_PRIMARY_CTRL);		//alternate status, does not acknowledge
+		if(!(status & ATA_SR_BSY) && (status & (ATA_SR_ERR | ATA_SR_DF))){
+			return -1;
+		}
+		if(pit_ticks == 0){
+			if(i == ATA_TIMEOUT){
+				return -1;
+			}
+			sti();
+			ata_delay();
+			cli();
+		}else{
+			if((int32_t)(pit_ticks - deadline) >= 0){
+				return -1;
+			}
+			sti_hlt_cli();
+		}
+	}
+	return 0;
+}
+
+/*
+ * ata_reset
+ *   DESCRIPTION: Resets the channel after a DMA read that did not finish
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: the drive drops the command, so a PIO read can start over
+ */
+static void ata_reset(void){
+	outb(ATA_CTRL_SRST | ATA_CTRL_NIEN, ATA_PRIMARY_CTRL);
+	ata_delay();
+	outb(ATA_CTRL_NIEN, ATA_PRIMARY_CTRL);
+	(void)ata_wait(0);
+}
+
+/*
+ * ata_read_dma
+ *   DESCRIPTION: Reads sectors from the disk with bus master DMA
+ *   INPUTS: uint32_t lba, uint32_t count, uint8_t* buf
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, -1 for failure, a timeout included
+ *   SIDE EFFECTS: fills buf with count sectors starting at lba; the reader
+ *								 halts until IRQ 14 and the PIT runs other processes
+ *								 while the controller moves the data
+ */
+int32_t ata_read_dma(uint32_t lba, uint32_t count, uint8_t* buf){
+	uint32_t flags, n, bm, status;
+	uint32_t done = 0;
+	int32_t ret;
+	uint64_t start;
+
+	if(!ata_present || ata_bm_base == 0 || ((uint32_t)buf & 0x1) ||
+			lba >= ata_num_sectors || count > ata_num_sectors - lba){
+		return -1;		//regions have to start on a word
+	}
+	bm = ata_bm_base;
+	ata_acquire();
+	while(done < count){
+		n = count - done;
+		if(n > ATA_MAX_SECTORS){
+			n = ATA_MAX_SECTORS;
+		}
+		if(ata_build_prdt(buf, n*ATA_SECTOR_SIZE) == -1){
+			ata_release();
+			return -1;
+		}
+		cli_and_save(flags);
+		if(ata_wait(0) == -1){
+			restore_flags(flags);
+			ata_release();
+			return -1;
+		}
+		outb(0, bm + BM_REG_COMMAND);		//stopped while it is set up
+		outl((uint32_t)ata_prdt, bm + BM_REG_PRDT);		//kernel memory, already physical
+		outb((inb(bm + BM_REG_STATUS) & BM_SR_CAPABLE) | BM_SR_ERR | BM_SR_IRQ, bm + BM_REG_STATUS);
+		outb(0, ATA_PRIMARY_CTRL);		//the drive interrupts when it is done
+		outb(ATA_DRIVE_LBA | ((lba >> 24) & 0x0F), ATA_PRIMARY_IO + ATA_REG_DRIVE);
+		outb(n & 0xFF, ATA_PRIMARY_IO + ATA_REG_SECCOUNT);
+		outb(lba & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_LO);
+		outb((lba >> 8) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_MID);
+		outb((lba >> 16) & 0xFF, ATA_PRIMARY_IO + ATA_REG_LBA_HI);
+		outb(ATA_CMD_READ_DMA, ATA_PRIMARY_IO + ATA_REG_COMMAND);
+		ata_dma_done = 0;
+		outb(BM_CMD_READ | BM_CMD_START, bm + BM_REG_COMMAND);
+
+		start = rdtsc();
+		ret = ata_dma_wait();
+		ata_sleep_total += rdtsc() - start;
+
+		outb(BM_CMD_READ, bm + BM_REG_COMMAND);		//clear start
+		if(ret == -1){
+			ata_reset();
+		}
+		status = ata_irq_status;
+		restore_flags(flags);
+		if(ret == -1 || (ata_dma_status & BM_SR_ERR) || (status & (ATA_SR_ERR | ATA_SR_DF))){
+			ata_release();
+			return -1;
+		}
+		buf += n*ATA_SECTOR_SIZE;
+		lba += n;
+		done += n;
+	}
+	ata_release();
+	return done*ATA_SECTOR_SIZE;
+}
+
+/*
+ * ata_read
+ *   DESCRIPTION: Reads sectors from the disk
+ *   INPUTS: uint32_t lba, uint32_t count, uint8_t* buf
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, -1 for failure
+ *   SIDE EFFECTS: uses DMA when the controller and buffer allow it, PIO
+ *								 otherwise or when DMA fails or times out
+ */
+int32_t ata_read(uint32_t lba, uint32_t count, uint8_t* buf){
+	int32_t ret;
+	if(ata_bm_base != 0 && (ret = ata_read_dma(lba, count, buf)) != -1){
+		return ret;
+	}
+	return ata_read_pio(lba, count, buf);
+}
+
+/*
+ * ata_interrupt
+ *   DESCRIPTION: IRQ 14 handler, a DMA transfer finished
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: acknowledges the drive and the bus master and wakes the
+ *								 reader
+ */
+void ata_interrupt(void){
+	uint32_t status;
+
+	ata_irq_status = inb(ATA_PRIMARY_IO + ATA_REG_STATUS);		//reading status acknowledges the drive
+	if(ata_bm_base != 0){
+		status = inb(ata_bm_base + BM_REG_STATUS);
+		if(status & BM_SR_IRQ){
+			ata_dma_status = status;
+			outb((status & BM_SR_CAPABLE) | BM_SR_IRQ, ata_bm_base + BM_REG_STATUS);
+			ata_dma_done = 1;
+		}
+	}
+	send_eoi(ATA_IRQ);
+}
+
+/*
+ * ata_sectors
+ *   DESCRIPTION: Returns the size of the disk
+ *   INPUTS: NONE
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: number of sectors, 0 if there is no disk
+ *   SIDE EFFECTS: NONE
+ */
+uint32_t ata_sectors(void){
+	return ata_present ? ata_num_sectors : 0;
+}
+
+/*
+ * ata_dma_enabled
+ *   DESCRIPTION: Tells whether reads can use DMA
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 1 if the controller has a bus master, 0 otherwise
+ *   SIDE EFFECTS: NONE
+ */
+int32_t ata_dma_enabled(void){
+	return ata_bm_base != 0;
+}
+
+/*
+ * ata_sleep_cycles
+ *   DESCRIPTION: Returns how long readers have waited for DMA
+ *   INPUTS: NONE
+ *   OUTPUTS: uint64_t
+ *   RETURN VALUE: TSC cycles spent halted, free for other processes
+ *   SIDE EFFECTS: NONE
+ */
+uint64_t ata_sleep_cycles(void){
+	return ata_sleep_total;
+}
@@ -0,0 +1,74 @@
+/* ATA HEADER FILE */
+#ifndef _ATA_H
+#define _ATA_H
+
+#include "types.h"
+
+#define ATA_PRIMARY_IO		0x1F0	//primary channel command block
+#define ATA_PRIMARY_CTRL	0x3F6	//primary channel device control / alternate status
+
+#define ATA_REG_DATA		0		//offsets from ATA_PRIMARY_IO
+#define ATA_REG_ERROR		1
+#define ATA_REG_SECCOUNT	2
+#define ATA_REG_LBA_LO		3
+#define ATA_REG_LBA_MID		4
+#define ATA_REG_LBA_HI		5
+#define ATA_REG_DRIVE		6
+#define ATA_REG_STATUS		7
+#define ATA_REG_COMMAND		7
+
+#define ATA_SR_BSY			0x80	//status bits
+#define ATA_SR_DRDY			0x40
+#define ATA_SR_DF			0x20
+#define ATA_SR_DRQ			0x08
+#define ATA_SR_ERR			0x01
+
+#define ATA_CMD_READ		0x20	//READ SECTORS, 28-bit LBA
+#define ATA_CMD_READ_DMA	0xC8	//READ DMA, 28-bit LBA
+#define ATA_CMD_IDENTIFY	0xEC
+#define ATA_DRIVE_MASTER	0xA0
+#define ATA_DRIVE_LBA		0xE0	//master, LBA addressing
+#define ATA_CTRL_NIEN		0x02	//no interrupts, the driver polls
+#define ATA_CTRL_SRST		0x04	//software reset of the channel
+
+#define ATA_IRQ				14
+
+#define BM_REG_COMMAND		0		//offsets from the bus master base, primary channel
+#define BM_REG_STATUS		2
+#define BM_REG_PRDT			4
+#define BM_CMD_START		0x01
+#define BM_CMD_READ			0x08	//device to memory
+#define BM_SR_ERR			0x02
+#define BM_SR_IRQ			0x04
+#define BM_SR_CAPABLE		0x60	//drive DMA capable bits, kept when clearing status
+
+#define PCI_CLASS_STORAGE	0x01
+#define PCI_SUBCLASS_IDE	0x01
+#define PCI_IDE_BUS_MASTER	0x80	//prog if bit for bus master support
+
+#define ATA_PRD_MAX			64		//enough for 128kB cut at every 4kB page
+#define ATA_PRD_EOT			0x8000	//last entry of the table
+#define ATA_PRD_BOUNDARY	0x10000	//an entry may not cross a 64kB boundary
+
+#define ATA_SECTOR_SIZE		512
+#define ATA_MAX_SECTORS		256		//most sectors one READ SECTORS moves
+#define ATA_LBA28_MAX		0x10000000
+#define ATA_TIMEOUT			0x100000	//status polls before giving up
+#define ATA_DMA_TICKS		60		//PIT ticks, two seconds, before a DMA read is given up
+
+typedef struct{
+	uint32_t addr;		//physical address of the region
+	uint16_t count;		//bytes, 0 means 64kB
+	uint16_t flags;
+}ata_prd_t;	//physical region descriptor
+
+int32_t ata_init(void);
+int32_t ata_read(uint32_t lba, uint32_t count, uint8_t* buf);
+int32_t ata_read_pio(uint32_t lba, uint32_t count, uint8_t* buf);
+int32_t ata_read_dma(uint32_t lba, uint32_t count, uint8_t* buf);
+void ata_interrupt(void);
+uint32_t ata_sectors(void);
+int32_t ata_dma_enabled(void);
+uint64_t ata_sleep_cycles(void);
+
+#endif /* _ATA_H */
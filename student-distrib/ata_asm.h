@@ -0,0 +1,20 @@
+/* ata_asm.h - assembly linkage for primary ATA channel interrupts
+ */
+
+#ifndef _ATA_ASM_H
+#define _ATA_ASM_H
+
+#define ATA_VAL 0x2E	//IRQ 14 on the slave PIC
+
+/*
+ * ata_handler()
+ *   DESCRIPTION: this is the interrupt handler for IRQ 14
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: Saves all registers and flags, then calls ata_interrupt,
+ *                restores registers, then returns from interrupt
+ */
+extern void ata_handler();
+
+#endif
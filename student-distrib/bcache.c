@@ -0,0 +1,348 @@
+#include "bcache.h"
+#include "lib.h"
+#include "devfs.h"
+#include "sys_calls.h"
+#include "poll.h"
+
+static uint8_t bcache_data[BCACHE_SIZE][DATA_BLOCK_SIZE] __attribute__((aligned(DATA_BLOCK_SIZE)));
+static bcache_buf_t bufs[BCACHE_SIZE];
+static int32_t hash_heads[BCACHE_HASH];
+static int32_t lru_head, lru_tail;
+static uint32_t bcache_hits, bcache_misses, bcache_evictions;
+
+static uint32_t disk_fops[FOPS_SIZE] = {(uint32_t)&disk_open,(uint32_t)&disk_read,(uint32_t)&disk_write,(uint32_t)&disk_close,(uint32_t)&poll_always};
+
+
+/*
+ * bcache_init
+ *   DESCRIPTION: Empties the buffer cache
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: every buffer is invalid and on the LRU list, counters
+ *								 are reset
+ */
+void bcache_init(void){
+	int32_t i;
+	for(i=0; i<BCACHE_SIZE; i++){
+		bufs[i].valid = 0;
+		bufs[i].loading = 0;
+		bufs[i].refs = 0;
+		bufs[i].prev = i-1;
+		bufs[i].next = (i == BCACHE_SIZE-1) ? BCACHE_NONE : i+1;
+		bufs[i].hnext = BCACHE_NONE;
+	}
+	for(i=0; i<BCACHE_HASH; i++){
+		hash_heads[i] = BCACHE_NONE;
+	}
+	lru_head = 0;
+	lru_tail = BCACHE_SIZE-1;
+	bcache_hits = 0;
+	bcache_misses = 0;
+	bcache_evictions = 0;
+	devfs_register("disk", disk_fops);
+}
+
+/*
+ * bcache_lookup
+ *   DESCRIPTION: Finds the buffer holding a block
+ *   INPUTS: uint32_t block
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: buffer index, BCACHE_NONE if the block is not cached
+ *   SIDE EFFECTS: NONE, caller has interrupts off
+ */
+static int32_t bcache_lookup(uint32_t block){
+	int32_t b;
+	for(b = hash_heads[block % BCACHE_HASH]; b != BCACHE_NONE; b = bufs[b].hnext){
+		if(bufs[b].block == block){
+			return b;
+		}
+	}
+	return BCACHE_NONE;
+}
+
+/*
+ * bcache_unhash
+ *   DESCRIPTION: Takes a valid buffer out of its hash bucket
+ *   INPUTS: int32_t b
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: the buffer's block can no longer be looked up
+ */
+static void bcache_unhash(int32_t b){
+	int32_t* link = &hash_heads[bufs[b].block % BCACHE_HASH];
+	while(*link != b){
+		link = &bufs[*link].hnext;
+	}
+	*link = bufs[b].hnext;
+	bufs[b].hnext = BCACHE_NONE;
+}
+
+/*
+ * bcache_touch
+ *   DESCRIPTION: Moves a buffer to the most recently used end of the LRU list
+ *   INPUTS: int32_t b
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: relinks the LRU list
+ */
+static void bcache_touch(int32_t b){
+	if(b == lru_head){
+		return;
+	}
+	//unlink, b is not the head so it has a prev
+	bufs[bufs[b].prev].next = bufs[b].next;
+	if(b == lru_tail){
+		lru_tail = bufs[b].prev;
+	}
+	else{
+		bufs[bufs[b].next].prev = bufs[b].prev;
+	}
+	bufs[b].prev = BCACHE_NONE;
+	bufs[b].next = lru_head;
+	bufs[lru_head].prev = b;
+	lru_head = b;
+}
+
+/*
+ * bcache_get
+ *   DESCRIPTION: Returns a block's contents, reading it from disk on a miss
+ *   INPUTS: uint32_t block
+ *   OUTPUTS: uint8_t*
+ *   RETURN VALUE: the cached DATA_BLOCK_SIZE bytes of the block, NULL if
+ *								 the read failed or every buffer is pinned
+ *   SIDE EFFECTS: pins the buffer until bcache_put, may evict the least
+ *								 recently used unpinned block; interrupts are on
+ *								 while the disk is read
+ */
+uint8_t* bcache_get(uint32_t block){
+	uint32_t flags;
+	int32_t b, ret;
+
+	cli_and_save(flags);
+	b = bcache_lookup(block);
+	if(b != BCACHE_NONE){
+		bcache_hits++;
+		bufs[b].refs++;
+		bcache_touch(b);
+		while(bufs[b].loading){
+			sti_hlt_cli();		//someone else is reading this block in
+		}
+		if(!bufs[b].valid){
+			bufs[b].refs--;		//and their read failed
+			restore_flags(flags);
+			return NULL;
+		}
+		restore_flags(flags);
+		return bcache_data[b];
+	}
+
+	//least recently used buffer nobody is holding
+	for(b = lru_tail; b != BCACHE_NONE && bufs[b].refs > 0; b = bufs[b].prev);
+	if(b == BCACHE_NONE){
+		restore_flags(flags);
+		return NULL;
+	}
+	if(bufs[b].valid){
+		bcache_unhash(b);
+		bufs[b].valid = 0;
+		bcache_evictions++;
+	}
+	//hashed while loading so a second reader of the block waits for this one
+	bufs[b].block = block;
+	bufs[b].loading = 1;
+	bufs[b].refs = 1;
+	bufs[b].hnext = hash_heads[block % BCACHE_HASH];
+	hash_heads[block % BCACHE_HASH] = b;
+	bcache_touch(b);
+	bcache_misses++;
+	restore_flags(flags);
+
+	ret = ata_read(block*SECTORS_PER_BLOCK, SECTORS_PER_BLOCK, bcache_data[b]);
+
+	cli_and_save(flags);
+	bufs[b].loading = 0;
+	if(ret == -1){
+		bcache_unhash(b);
+		bufs[b].refs--;
+		restore_flags(flags);
+		return NULL;
+	}
+	bufs[b].valid = 1;
+	restore_flags(flags);
+	return bcache_data[b];
+}
+
+/*
+ * bcache_put
+ *   DESCRIPTION: Releases a block returned by bcache_get
+ *   INPUTS: uint8_t* data
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: unpins the buffer so it can be evicted again
+ */
+void bcache_put(uint8_t* data){
+	uint32_t flags;
+	int32_t b;
+	if(data == NULL){
+		return;
+	}
+	b = (data - bcache_data[0]) / DATA_BLOCK_SIZE;
+	if(b < 0 || b >= BCACHE_SIZE){
+		return;
+	}
+	cli_and_save(flags);
+	if(bufs[b].refs > 0){
+		bufs[b].refs--;
+	}
+	restore_flags(flags);
+}
+
+/*
+ * bcache_read_run
+ *   DESCRIPTION: Copies consecutive blocks to a buffer, reading the ones
+ *								that are not cached straight from disk
+ *   INPUTS: uint32_t block, uint32_t count, uint8_t* buf
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes copied, -1 for failure
+ *   SIDE EFFECTS: cached blocks count as hits; uncached ones count as
+ *								 misses but are not cached, so streaming a large
+ *								 file does not flush the metadata out of the cache
+ */
+int32_t bcache_read_run(uint32_t block, uint32_t count, uint8_t* buf){
+	uint32_t flags, i;
+	uint32_t span = 0;		//uncached blocks just before block+i
+	int32_t b;
+
+	for(i=0; i<=count; i++){
+		b = BCACHE_NONE;
+		if(i < count){
+			cli_and_save(flags);
+			if((b = bcache_lookup(block+i)) != BCACHE_NONE && !bufs[b].valid){
+				b = BCACHE_NONE;		//still loading, read it ourselves
+			}
+			if(b != BCACHE_NONE){
+				bufs[b].refs++;
+				bcache_hits++;
+				bcache_touch(b);
+			}
+			restore_flags(flags);
+			if(b == BCACHE_NONE){
+				span++;
+				continue;
+			}
+		}
+		//one command for the whole uncached span
+		if(span > 0){
+			if(ata_read((block+i-span)*SECTORS_PER_BLOCK, span*SECTORS_PER_BLOCK, buf + (i-span)*DATA_BLOCK_SIZE) == -1){
+				if(b != BCACHE_NONE){
+					bcache_put(bcache_data[b]);
+				}
+				return -1;
+			}
+			cli_and_save(flags);
+			bcache_misses += span;		//counted with interrupts off like the hits
+			restore_flags(flags);
+			span = 0;
+		}
+		if(b != BCACHE_NONE){
+			memcpy(buf + i*DATA_BLOCK_SIZE, bcache_data[b], DATA_BLOCK_SIZE);
+			bcache_put(bcache_data[b]);
+		}
+	}
+	return count*DATA_BLOCK_SIZE;
+}
+
+/*
+ * bcache_stats
+ *   DESCRIPTION: Reports how well the buffer cache is doing
+ *   INPUTS: uint32_t* hits, uint32_t* misses, uint32_t* evictions
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills in the counters since the cache was last emptied
+ */
+void bcache_stats(uint32_t* hits, uint32_t* misses, uint32_t* evictions){
+	*hits = bcache_hits;
+	*misses = bcache_misses;
+	*evictions = bcache_evictions;
+}
+
+/*
+ * disk_open
+ *   DESCRIPTION: Opens the whole disk as /dev/disk
+ *   INPUTS: const uint8_t* filename
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 if there is no disk
+ *   SIDE EFFECTS: NONE
+ */
+int32_t disk_open(const uint8_t* filename){
+	return ata_sectors() == 0 ? -1 : 0;
+}
+
+/*
+ * disk_read
+ *   DESCRIPTION: Reads raw bytes of the disk through the cache
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, 0 at the end of the disk, -1 for
+ *								 failure
+ *   SIDE EFFECTS: advances the file position
+ */
+int32_t disk_read(int32_t fd, void* buf, int32_t nbytes){
+	uint32_t pos = get_fp(fd);
+	uint32_t end = ata_sectors();
+	uint32_t skip, chunk, done = 0;
+	uint8_t* data;
+
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	//the file position is 32 bits, so only the first 4GB can be read
+	end = (end >= 0xFFFFFFFF / ATA_SECTOR_SIZE) ? 0xFFFFFFFF : end*ATA_SECTOR_SIZE;
+	if(pos >= end){
+		return 0;
+	}
+	if((uint32_t)nbytes > end - pos){
+		nbytes = end - pos;
+	}
+	while(done < (uint32_t)nbytes){
+		skip = pos % DATA_BLOCK_SIZE;
+		chunk = DATA_BLOCK_SIZE - skip;
+		if(chunk > nbytes - done){
+			chunk = nbytes - done;
+		}
+		if((data = bcache_get(pos / DATA_BLOCK_SIZE)) == NULL){
+			break;
+		}
+		memcpy((uint8_t*)buf + done, data + skip, chunk);
+		bcache_put(data);
+		pos += chunk;
+		done += chunk;
+	}
+	set_fp(fd, pos);
+	return (done == 0 && nbytes > 0) ? -1 : (int32_t)done;
+}
+
+/*
+ * disk_write
+ *   DESCRIPTION: The disk is read only
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: -1
+ *   SIDE EFFECTS: NONE
+ */
+int32_t disk_write(int32_t fd, const void* buf, int32_t nbytes){
+	return -1;
+}
+
+/*
+ * disk_close
+ *   DESCRIPTION: Nothing to do
+ *   INPUTS: int32_t fd
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t disk_close(int32_t fd){
+	return 0;
+}
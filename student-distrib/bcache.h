@@ -0,0 +1,35 @@
+/* BUFFER CACHE HEADER FILE */
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include "types.h"
+#include "filesys.h"
+#include "ata.h"
+
+#define BCACHE_SIZE		64		//cached blocks, 256kB of buffers
+#define BCACHE_HASH		64		//hash buckets, keyed on the block number
+#define BCACHE_NONE		-1		//end of a list
+#define SECTORS_PER_BLOCK	(DATA_BLOCK_SIZE/ATA_SECTOR_SIZE)
+
+typedef struct{
+	uint32_t block;		//disk block held, if valid
+	uint32_t valid;		//the data is in the buffer
+	uint32_t loading;		//a reader is filling it, others wait
+	uint32_t refs;		//pinned while nonzero, never evicted
+	int32_t prev;		//LRU list, most recently used first
+	int32_t next;
+	int32_t hnext;		//hash bucket chain
+}bcache_buf_t;	//bookkeeping for one cached block
+
+void bcache_init(void);
+uint8_t* bcache_get(uint32_t block);
+void bcache_put(uint8_t* data);
+int32_t bcache_read_run(uint32_t block, uint32_t count, uint8_t* buf);
+void bcache_stats(uint32_t* hits, uint32_t* misses, uint32_t* evictions);
+
+int32_t disk_open(const uint8_t* filename);
+int32_t disk_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t disk_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t disk_close(int32_t fd);
+
+#endif /* _BCACHE_H */
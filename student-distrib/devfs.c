@@ -0,0 +1,224 @@
+#include "devfs.h"
+#include "lib.h"
+#include "poll.h"
+
+static devfs_entry_t devices[DEVFS_MAX];
+static uint32_t num_devices;
+static uint32_t random_state;		//xorshift state behind /dev/random
+
+static int32_t dev_open(const uint8_t* filename);
+static int32_t dev_close(int32_t fd);
+static int32_t null_read(int32_t fd, void* buf, int32_t nbytes);
+static int32_t null_write(int32_t fd, const void* buf, int32_t nbytes);
+static int32_t zero_read(int32_t fd, void* buf, int32_t nbytes);
+static int32_t random_read(int32_t fd, void* buf, int32_t nbytes);
+static int32_t random_write(int32_t fd, const void* buf, int32_t nbytes);
+
+static uint32_t null_fops[FOPS_SIZE] = {(uint32_t)&dev_open,(uint32_t)&null_read,(uint32_t)&null_write,(uint32_t)&dev_close,(uint32_t)&poll_always};
+static uint32_t zero_fops[FOPS_SIZE] = {(uint32_t)&dev_open,(uint32_t)&zero_read,(uint32_t)&null_write,(uint32_t)&dev_close,(uint32_t)&poll_always};
+static uint32_t random_fops[FOPS_SIZE] = {(uint32_t)&dev_open,(uint32_t)&random_read,(uint32_t)&random_write,(uint32_t)&dev_close,(uint32_t)&poll_always};
+
+
+/*
+ * devfs_init
+ *   DESCRIPTION: Registers the devices that need no hardware
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: adds null, zero and random, seeds random from the TSC
+ */
+void devfs_init(void){
+	random_state = (uint32_t)rdtsc() | 1;		//xorshift never leaves 0
+	devfs_register("null", null_fops);
+	devfs_register("zero", zero_fops);
+	devfs_register("random", random_fops);
+}
+
+/*
+ * devfs_register
+ *   DESCRIPTION: Makes a driver reachable as /dev/<name>
+ *   INPUTS: const int8_t* name, uint32_t* fops
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: the device number, -1 if the name is too long or the
+ *								 table is full
+ *   SIDE EFFECTS: registering a name again replaces its fops
+ */
+int32_t devfs_register(const int8_t* name, uint32_t* fops){
+	int32_t dev;
+	if(name == NULL || fops == NULL || strlen(name) >= DEV_NAME_LEN){
+		return -1;
+	}
+	if((dev = devfs_find((const uint8_t*)name)) == -1){
+		if(num_devices == DEVFS_MAX){
+			return -1;
+		}
+		dev = num_devices++;
+		strcpy(devices[dev].name, name);
+	}
+	devices[dev].fops = fops;
+	return dev;
+}
+
+/*
+ * devfs_path
+ *   DESCRIPTION: Checks whether a path names something under /dev or /proc
+ *   INPUTS: const uint8_t* path
+ *   OUTPUTS: const uint8_t*
+ *   RETURN VALUE: the registered name inside path ("null" for /dev/null,
+ *								 "proc/ps" for /proc/ps), NULL for any other path
+ *   SIDE EFFECTS: NONE
+ */
+const uint8_t* devfs_path(const uint8_t* path){
+	if(path == NULL){
+		return NULL;
+	}
+	if(path[0] == '/'){
+		path++;
+	}
+	if(strncmp((const int8_t*)path, PROC_DIR, PROC_DIR_LEN) == 0){
+		return path;
+	}
+	if(strncmp((const int8_t*)path, DEV_DIR, DEV_DIR_LEN) != 0){
+		return NULL;
+	}
+	return path + DEV_DIR_LEN;
+}
+
+/*
+ * devfs_find
+ *   DESCRIPTION: Looks a device up by name
+ *   INPUTS: const uint8_t* name
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: the device number, -1 if nothing registered the name
+ *   SIDE EFFECTS: NONE
+ */
+int32_t devfs_find(const uint8_t* name){
+	uint32_t i;
+	for(i=0; i<num_devices; i++){
+		if(strncmp(devices[i].name, (const int8_t*)name, DEV_NAME_LEN) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * devfs_fops
+ *   DESCRIPTION: Returns the ops table of a device
+ *   INPUTS: int32_t dev
+ *   OUTPUTS: uint32_t*
+ *   RETURN VALUE: the jumptable to put in a file descriptor, NULL for
+ *								 a bad device number
+ *   SIDE EFFECTS: NONE
+ */
+uint32_t* devfs_fops(int32_t dev){
+	if(dev < 0 || (uint32_t)dev >= num_devices){
+		return NULL;
+	}
+	return devices[dev].fops;
+}
+
+/*
+ * dev_open / dev_close
+ *   DESCRIPTION: Nothing to set up or tear down for the memory devices
+ *   INPUTS: const uint8_t* filename / int32_t fd
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t dev_open(const uint8_t* filename){
+	return 0;
+}
+static int32_t dev_close(int32_t fd){
+	return 0;
+}
+
+/*
+ * null_read
+ *   DESCRIPTION: /dev/null is always at its end
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t null_read(int32_t fd, void* buf, int32_t nbytes){
+	return 0;
+}
+
+/*
+ * null_write
+ *   DESCRIPTION: Throws the bytes away
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, -1 for a bad buffer
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t null_write(int32_t fd, const void* buf, int32_t nbytes){
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	return nbytes;
+}
+
+/*
+ * zero_read
+ *   DESCRIPTION: Fills the buffer with zeros
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, -1 for a bad buffer
+ *   SIDE EFFECTS: clears buf
+ */
+static int32_t zero_read(int32_t fd, void* buf, int32_t nbytes){
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	memset(buf, 0, nbytes);
+	return nbytes;
+}
+
+/*
+ * random_read
+ *   DESCRIPTION: Fills the buffer with xorshift32 output
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, -1 for a bad buffer
+ *   SIDE EFFECTS: advances the generator, not for anything secret
+ */
+static int32_t random_read(int32_t fd, void* buf, int32_t nbytes){
+	uint8_t* out = (uint8_t*)buf;
+	int32_t i;
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	for(i=0; i<nbytes; i++){
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
+		out[i] = random_state >> 24;
+	}
+	return nbytes;
+}
+
+/*
+ * random_write
+ *   DESCRIPTION: Mixes the bytes and the TSC into the generator
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, -1 for a bad buffer
+ *   SIDE EFFECTS: changes what random_read returns next
+ */
+static int32_t random_write(int32_t fd, const void* buf, int32_t nbytes){
+	const uint8_t* in = (const uint8_t*)buf;
+	int32_t i;
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	for(i=0; i<nbytes; i++){
+		random_state = (random_state << 8 | random_state >> 24) ^ in[i];
+	}
+	random_state ^= (uint32_t)rdtsc();
+	if(random_state == 0){
+		random_state = 1;
+	}
+	return nbytes;
+}
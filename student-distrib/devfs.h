@@ -0,0 +1,27 @@
+/* DEVFS HEADER FILE */
+#ifndef _DEVFS_H
+#define _DEVFS_H
+
+#include "types.h"
+
+#define DEVFS_MAX		16		//devices that can be registered
+#define DEV_NAME_LEN	16		//longest device name, with its NUL
+#define DEV_DIR			"dev/"	//open("/dev/<name>") or open("dev/<name>")
+#define DEV_DIR_LEN		4
+#define PROC_DIR		"proc/"	//procfs files register with this prefix in their name
+#define PROC_DIR_LEN	5
+#define FOPS_SIZE		5		//open, read, write, close, poll
+#define FOPS_POLL		4		//readiness, see poll.h
+
+typedef struct{
+	int8_t name[DEV_NAME_LEN];
+	uint32_t* fops;		//same layout as the jumptables in sys_calls.c
+}devfs_entry_t;	//one registered device
+
+void devfs_init(void);
+int32_t devfs_register(const int8_t* name, uint32_t* fops);
+const uint8_t* devfs_path(const uint8_t* path);
+int32_t devfs_find(const uint8_t* name);
+uint32_t* devfs_fops(int32_t dev);
+
+#endif
@@ -2,11 +2,68 @@
 #include "types.h"
 #include "lib.h"
 #include "sys_calls.h"
+#include "bcache.h"
+#include "lz4.h"
 
-static uint32_t location_fs, location_i, location_d;
+static uint32_t location_fs, data_start;
 static uint32_t num_direntries, num_inodes, num_datablocks, num_reads;
+static uint32_t fs_features, fs_version;
+static uint32_t fs_on_disk;		//blocks come from the buffer cache, not the module
+static bootblock_t disk_bootblock;		//the bootblock stays in memory either way
+static uint32_t fs_generation;		//bumped by every mount
+static uint32_t fsmap_generation;		//mount fsmap_area was last filled for
+static fsmap_t fsmap_area __attribute__((aligned(DATA_BLOCK_SIZE)));
+static uint32_t fs_good[FSCK_MAX_INODES/32];		//inodes fsck found a sound block map for
+
+static volatile uint32_t lz4_busy;		//a reader owns the buffers below
+static uint8_t lz4_in[DATA_BLOCK_SIZE];		//one compressed chunk
+static uint8_t lz4_out[DATA_BLOCK_SIZE];		//the last chunk decompressed
+static uint32_t lz4_valid, lz4_inode, lz4_chunk, lz4_generation;		//what lz4_out holds
 bootblock_t* super_block;
 
+typedef struct{
+	uint32_t parent;		//directory handle the name was looked up in
+	uint32_t valid;
+	dentry_t dentry;
+}dcache_entry_t;	//one memoized (parent, name) lookup
+
+static dcache_entry_t dcache[DCACHE_SIZE];
+static uint32_t dcache_hits, dcache_misses;
+
+
+/*
+ * mount_bootblock
+ *   DESCRIPTION: Reads the image layout out of a bootblock
+ *   INPUTS: bootblock_t* boot
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: sets the counts and format fields, empties the dentry cache
+ */
+static void mount_bootblock(bootblock_t* boot){
+	super_block = boot;
+	num_direntries = super_block->dir_count;
+	num_inodes = super_block->inode_count;
+	num_datablocks = super_block->data_count;
+	num_reads = 0;
+	data_start = 1 + num_inodes;		//bootblock, then the inodes, then data
+	fs_generation++;
+
+	//images without the magic number are the original flat format
+	fs_features = 0;
+	fs_version = 1;
+	if(super_block->fs_magic == FS_MAGIC){
+		fs_features = super_block->fs_features;
+		fs_version = super_block->fs_version;
+	}
+
+	//nothing is trusted until fsck has looked at this image
+	memset(fs_good, 0, sizeof(fs_good));
+
+	//a new image invalidates everything the dentry cache remembers
+	memset(dcache, 0, sizeof(dcache));
+	dcache_hits = 0;
+	dcache_misses = 0;
+}
 
 /*
  * init_filesystem
@@ -18,38 +75,265 @@ bootblock_t* super_block;
  *								 initialized
  */
 void init_filesystem(uint32_t fs_addr){
-	uint32_t size = DATA_BLOCK_SIZE;	//4kB, size of data block
+	fs_on_disk = 0;
 	location_fs = fs_addr;
-	location_i = fs_addr + size;
-	super_block = (bootblock_t*)fs_addr;
+	mount_bootblock((bootblock_t*)fs_addr);
+}
 
-	num_direntries = super_block->dir_count;
-	num_inodes = super_block->inode_count;
-	num_datablocks = super_block->data_count;
-	num_reads = 0;
-	location_d = location_i + size*num_inodes;
+/*
+ * init_filesystem_disk
+ *   DESCRIPTION: Mounts the image on the primary ATA disk instead of a module
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 if there is no disk or it does not
+ *								 hold an image
+ *   SIDE EFFECTS: copies the bootblock into memory, every other block is
+ *								 read through the buffer cache
+ */
+int32_t init_filesystem_disk(void){
+	uint8_t* boot;
+
+	if(ata_init() == -1){
+		return -1;
+	}
+	bcache_init();
+	if((boot = bcache_get(0)) == NULL){
+		return -1;
+	}
+	memcpy(&disk_bootblock, boot, sizeof(bootblock_t));
+	bcache_put(boot);
+
+	//sanity check the counts before trusting the disk
+	if(disk_bootblock.dir_count < 0 || disk_bootblock.dir_count > FS_MAX_DIRENTRIES ||
+			disk_bootblock.inode_count <= 0 || disk_bootblock.data_count < 0 ||
+			(1 + (uint32_t)disk_bootblock.inode_count + disk_bootblock.data_count)*SECTORS_PER_BLOCK > ata_sectors()){
+		return -1;
+	}
+	fs_on_disk = 1;
+	mount_bootblock(&disk_bootblock);
+	return 0;
+}
+
+/*
+ * fs_block
+ *   DESCRIPTION: Gets a block of the image, counted from the bootblock
+ *   INPUTS: uint32_t block
+ *   OUTPUTS: uint8_t*
+ *   RETURN VALUE: the block's contents, NULL for failure
+ *   SIDE EFFECTS: on disk, pins the block in the buffer cache until fs_release
+ */
+static uint8_t* fs_block(uint32_t block){
+	if(fs_on_disk){
+		return bcache_get(block);
+	}
+	return (uint8_t*)(location_fs + DATA_BLOCK_SIZE*block);
+}
+
+/*
+ * fs_release
+ *   DESCRIPTION: Gives back a block from fs_block
+ *   INPUTS: uint8_t* data
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: unpins the block on disk, nothing for a module
+ */
+static void fs_release(uint8_t* data){
+	if(fs_on_disk){
+		bcache_put(data);
+	}
+}
+
+/*
+ * dir_entry_count
+ *   DESCRIPTION: Returns the number of entries in a directory
+ *   INPUTS: uint32_t dir (directory handle)
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: number of dentries in the directory
+ *   SIDE EFFECTS: NONE
+ */
+static uint32_t dir_entry_count(uint32_t dir){
+	if(dir == FS_ROOT_DIR){
+		return num_direntries;		//root entries live in the bootblock
+	}
+	inode_t* inode;
+	uint32_t count;
+	if(dir > num_inodes-1 || (inode = (inode_t*)fs_block(1 + dir)) == NULL){
+		return 0;		//inode value out of range
+	}
+	count = inode->i_length / sizeof(dentry_t);
+	fs_release((uint8_t*)inode);
+	return count;
+}
+
+/*
+ * dir_entry_at
+ *   DESCRIPTION: Reads the index'th entry of a directory
+ *   INPUTS: uint32_t dir (directory handle), uint32_t index, dentry_t* dentry
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 for failure
+ *   SIDE EFFECTS: updates the inputted dentry with the entry's values
+ */
+static int32_t dir_entry_at(uint32_t dir, uint32_t index, dentry_t* dentry){
+	if(dir == FS_ROOT_DIR){
+		return read_dentry_by_index(index, dentry);
+	}
+	if(read_data(dir, index*sizeof(dentry_t), (uint8_t*)dentry, sizeof(dentry_t)) != sizeof(dentry_t)){
+		return -1;		//index out of range
+	}
+	return 0;
+}
+
+/*
+ * dir_handle
+ *   DESCRIPTION: Returns the directory handle a directory dentry refers to
+ *   INPUTS: const dentry_t* dentry
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: inode of the directory, or FS_ROOT_DIR
+ *   SIDE EFFECTS: NONE
+ */
+static uint32_t dir_handle(const dentry_t* dentry){
+	//flat images only have the root, whatever inode its entry names
+	if(!(fs_features & FS_FEAT_SUBDIRS)){
+		return FS_ROOT_DIR;
+	}
+	return dentry->inode_num;
+}
+
+/*
+ * dcache_slot
+ *   DESCRIPTION: Hashes a (parent, name) pair to its dentry cache slot
+ *   INPUTS: uint32_t parent, const uint8_t* name, uint32_t len
+ *   OUTPUTS: dcache_entry_t*
+ *   RETURN VALUE: the slot the pair maps to
+ *   SIDE EFFECTS: NONE
+ */
+static dcache_entry_t* dcache_slot(uint32_t parent, const uint8_t* name, uint32_t len){
+	uint32_t i;
+	uint32_t hash = 2166136261U ^ parent;	//FNV-1a over the parent and the name
+	for(i=0; i<len; i++){
+		hash = (hash ^ name[i]) * 16777619U;
+	}
+	return &dcache[hash % DCACHE_SIZE];
+}
+
+/*
+ * name_matches
+ *   DESCRIPTION: Compares one path component against a dentry's name
+ *   INPUTS: const uint8_t* name, uint32_t len, const int8_t* filename
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 1 if they match, 0 otherwise
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t name_matches(const uint8_t* name, uint32_t len, const int8_t* filename){
+	uint32_t i;
+	//like the flat lookup, only the first FILENAME_LEN characters count
+	for(i=0; i<len && i<FILENAME_LEN; i++){
+		if((int8_t)name[i] != filename[i]){
+			return 0;
+		}
+	}
+	return (i == FILENAME_LEN || filename[i] == '\0');
+}
+
+/*
+ * dir_lookup
+ *   DESCRIPTION: Looks up one path component in a directory, going
+ *								through the dentry cache
+ *   INPUTS: uint32_t dir (directory handle), const uint8_t* name,
+ *					 uint32_t len, dentry_t* dentry
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 for failure
+ *   SIDE EFFECTS: updates the inputted dentry and the dentry cache
+ */
+static int32_t dir_lookup(uint32_t dir, const uint8_t* name, uint32_t len, dentry_t* dentry){
+	uint32_t i, count;
+	dcache_entry_t* slot = dcache_slot(dir, name, len);
+
+	if(slot->valid && slot->parent == dir && name_matches(name, len, slot->dentry.filename)){
+		dcache_hits++;
+		*dentry = slot->dentry;
+		return 0;
+	}
+	dcache_misses++;
+
+	count = dir_entry_count(dir);
+	for(i=0; i<count; i++){		//loop thru all dentries in the directory until filename is found
+		if(dir_entry_at(dir, i, dentry) == 0 && name_matches(name, len, dentry->filename)){
+			slot->parent = dir;
+			slot->dentry = *dentry;
+			slot->valid = 1;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * dcache_stats
+ *   DESCRIPTION: Reports how well the dentry cache is doing
+ *   INPUTS: uint32_t* hits, uint32_t* misses
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: writes the hit and miss counts since mount
+ */
+void dcache_stats(uint32_t* hits, uint32_t* misses){
+	*hits = dcache_hits;
+	*misses = dcache_misses;
 }
 
 /*
  * read_dentry_by_name
- *   DESCRIPTION: Reads a directory entry by the name of a file
+ *   DESCRIPTION: Reads a directory entry by the path of a file
  *   INPUTS: const uint8_t* fname, dentry_t* dentry
  *   OUTPUTS: int32_t
  *   RETURN VALUE: 0 for success, -1 for failure
- *   SIDE EFFECTS: Finds the filename in the bootblock,
- *								 and updates the inputted dentry with
- *								 the file's values
+ *   SIDE EFFECTS: Walks the '/'-separated path from the root one
+ *								 component at a time, and updates the inputted
+ *								 dentry with the file's values. A directory's
+ *								 inode_num is its directory handle.
  */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry){
-	uint32_t i;
-	for(i=0; i<num_direntries; i++){		//loop thru all dentries in bootblock until filename is found
-		uint8_t* direntry = (uint8_t*)super_block->direntries[i].filename;
-		if(strncmp((int8_t*)fname, (int8_t*)direntry, FILENAME_LEN) == 0){		//filename found
-			read_dentry_by_index(i, dentry);		//use found file's index to update dentry
+	uint32_t dir = FS_ROOT_DIR;
+	uint32_t len;
+
+	if(fname == NULL || fname[0] == '\0'){
+		return -1;
+	}
+	while(*fname == '/'){		//paths are always relative to the root
+		fname++;
+	}
+	if(*fname == '\0'){
+		return dir_lookup(FS_ROOT_DIR, (const uint8_t*)".", 1, dentry);
+	}
+
+	while(1){
+		for(len=0; fname[len] != '\0' && fname[len] != '/'; len++);
+
+		if(dir == FS_ROOT_DIR && len == 2 && fname[0] == '.' && fname[1] == '.'){
+			//the root is its own parent
+			if(dir_lookup(FS_ROOT_DIR, (const uint8_t*)".", 1, dentry) == -1){
+				return -1;
+			}
+		}
+		else if(dir_lookup(dir, fname, len, dentry) == -1){
+			return -1;		//component not found
+		}
+
+		fname += len;
+		while(*fname == '/'){
+			fname++;
+		}
+		if(dentry->filetype == 1){
+			dir = dir_handle(dentry);
+			dentry->inode_num = dir;
+		}
+		if(*fname == '\0'){
 			return 0;
 		}
+		if(dentry->filetype != 1){
+			return -1;		//only directories can have more path after them
+		}
 	}
-	return -1;
 }
 
 /*
@@ -74,6 +358,362 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 	}
 }
 
+typedef struct{
+	inode_t* inode;
+	uint32_t next;		//next logical block to map
+	uint32_t end;		//one past the last logical block to map
+	uint8_t* held;		//indirect block the last lookup used, or NULL
+	uint32_t good;		//fsck vouched for every block number, skip the range checks
+}bmap_iter_t;	//walks a file's block map one contiguous run at a time
+
+/*
+ * bmap_table
+ *   DESCRIPTION: Gets an indirect block for the iterator to look into
+ *   INPUTS:  bmap_iter_t* it, int32_t block
+ *   OUTPUTS: int32_t*
+ *   RETURN VALUE: the block's block numbers, NULL for failure
+ *   SIDE EFFECTS: releases the indirect block held before
+ */
+static int32_t* bmap_table(bmap_iter_t* it, int32_t block){
+	if(it->held != NULL){
+		fs_release(it->held);
+		it->held = NULL;
+	}
+	if(!it->good && (uint32_t)block >= num_datablocks){
+		return NULL;
+	}
+	it->held = fs_block(data_start + block);
+	return (int32_t*)it->held;
+}
+
+/*
+ * bmap_segment
+ *   DESCRIPTION: Finds the block number table that maps a logical block
+ *   INPUTS:  bmap_iter_t* it, uint32_t lblock, uint32_t* left
+ *   OUTPUTS: int32_t*
+ *   RETURN VALUE: pointer to lblock's entry in the inode's direct list or
+ *								 in an indirect block, NULL for failure
+ *   SIDE EFFECTS: sets left to the number of entries from lblock to the
+ *								 end of that table
+ */
+static int32_t* bmap_segment(bmap_iter_t* it, uint32_t lblock, uint32_t* left){
+	inode_t* inode = it->inode;
+	int32_t* table;
+
+	if(fs_version < FS_VERSION_INDIRECT){
+		if(lblock >= INODE_DIRECT_V1){
+			return NULL;		//past the end of the block list
+		}
+		*left = INODE_DIRECT_V1 - lblock;
+		return &inode->data_block_num[lblock];
+	}
+	if(lblock < INODE_DIRECT_V2){
+		*left = INODE_DIRECT_V2 - lblock;
+		return &inode->v2.direct[lblock];
+	}
+	lblock -= INODE_DIRECT_V2;
+	if(lblock < BLOCK_NUMS_PER_BLOCK){
+		if((table = bmap_table(it, inode->v2.indirect)) == NULL){
+			return NULL;
+		}
+		*left = BLOCK_NUMS_PER_BLOCK - lblock;
+		return &table[lblock];
+	}
+	lblock -= BLOCK_NUMS_PER_BLOCK;
+	if(lblock < BLOCK_NUMS_PER_BLOCK*BLOCK_NUMS_PER_BLOCK){
+		if((table = bmap_table(it, inode->v2.double_indirect)) == NULL){
+			return NULL;
+		}
+		//swaps the double indirect block for the leaf it points to
+		if((table = bmap_table(it, table[lblock / BLOCK_NUMS_PER_BLOCK])) == NULL){
+			return NULL;
+		}
+		*left = BLOCK_NUMS_PER_BLOCK - lblock % BLOCK_NUMS_PER_BLOCK;
+		return &table[lblock % BLOCK_NUMS_PER_BLOCK];
+	}
+	return NULL;
+}
+
+/*
+ * bmap_next_run
+ *   DESCRIPTION: Resolves the next run of physically contiguous blocks
+ *   INPUTS:  bmap_iter_t* it, uint32_t* block, uint32_t* count
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 for failure or the end of the range
+ *   SIDE EFFECTS: sets block to the first data block of the run and count
+ *								 to its length, and moves the iterator past it
+ */
+static int32_t bmap_next_run(bmap_iter_t* it, uint32_t* block, uint32_t* count){
+	int32_t* table;
+	uint32_t first, left, i;
+	uint32_t n = 1;
+
+	if(it->next >= it->end || (table = bmap_segment(it, it->next, &left)) == NULL){
+		return -1;
+	}
+	first = table[0];
+	if(!it->good && first >= num_datablocks){
+		return -1;		//failure if data block num is greater than number of total datablocks
+	}
+
+	//the table is only looked up again when the run crosses into the next one
+	for(i=1; it->next + n < it->end; i++, n++){
+		if(i == left){
+			if((table = bmap_segment(it, it->next + n, &left)) == NULL){
+				break;
+			}
+			i = 0;
+		}
+		if((uint32_t)table[i] != first + n){
+			break;		//run ends, the next block is elsewhere
+		}
+	}
+	if(!it->good && first + n > num_datablocks){
+		n = num_datablocks - first;		//the block past the image fails on the next call
+	}
+	it->next += n;
+	*block = first;
+	*count = n;
+	return 0;
+}
+
+/*
+ * copy_blocks
+ *   DESCRIPTION: Copies whole data blocks, 4 bytes at a time
+ *   INPUTS:  uint8_t* buf, const uint8_t* src, uint32_t count
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: copies count blocks from src to buf
+ */
+static void copy_blocks(uint8_t* buf, const uint8_t* src, uint32_t count){
+	uint32_t words = count*(DATA_BLOCK_SIZE/4);
+
+	if((uint32_t)buf & 0x3){
+		memcpy(buf, src, count*DATA_BLOCK_SIZE);	//unaligned buffer, let memcpy line it up
+		return;
+	}
+	//blocks are 4kB aligned, so with an aligned buffer there is no head or tail
+	asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     movsl           \n\
+            "
+            : "+S"(src), "+D"(buf), "+c"(words)
+            :
+            : "edx", "memory", "cc"
+    );
+}
+
+/*
+ * copy_run
+ *   DESCRIPTION: Copies part of a run of contiguous data blocks
+ *   INPUTS:  uint32_t block, uint32_t skip, uint8_t* buf, uint32_t n
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 for a disk error
+ *   SIDE EFFECTS: copies n bytes, starting skip bytes into data block
+ *								 block, to buf
+ */
+static int32_t copy_run(uint32_t block, uint32_t skip, uint8_t* buf, uint32_t n){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
+	uint32_t chunk;
+	uint8_t* data;
+
+	if(!fs_on_disk){
+		data = (uint8_t*)(location_fs + size*(data_start + block));
+		if(skip == 0 && n % size == 0){
+			copy_blocks(buf, data, n / size);	//whole blocks, no partial math
+		}
+		else{
+			memcpy(buf, data + skip, n);	//the run is contiguous in memory too
+		}
+		return 0;
+	}
+
+	//partial blocks go through the cache, whole ones are read in one go
+	while(n > 0){
+		if(skip == 0 && n >= size){
+			chunk = n - n % size;
+			if(bcache_read_run(data_start + block, chunk / size, buf) == -1){
+				return -1;
+			}
+		}
+		else{
+			chunk = size - skip;
+			if(chunk > n){
+				chunk = n;
+			}
+			if((data = bcache_get(data_start + block)) == NULL){
+				return -1;
+			}
+			memcpy(buf, data + skip, chunk);
+			bcache_put(data);
+		}
+		buf += chunk;
+		n -= chunk;
+		block += (skip + chunk) / size;
+		skip = 0;
+	}
+	return 0;
+}
+
+/*
+ * inode_good
+ *   DESCRIPTION: Tells whether fsck checked an inode's whole block map
+ *   INPUTS:  uint32_t inum
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: nonzero if reads of the inode can skip the range checks
+ *   SIDE EFFECTS: NONE
+ */
+static uint32_t inode_good(uint32_t inum){
+	return inum < FSCK_MAX_INODES && (fs_good[inum / 32] & (1 << (inum % 32)));
+}
+
+/*
+ * read_blocks
+ *   DESCRIPTION: Copies bytes out of an inode's data blocks
+ *   INPUTS:  uint32_t inum, inode_t* inode, uint32_t offset, uint8_t* buf,
+ *						uint32_t length
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes copied, -1 for failure
+ *   SIDE EFFECTS: Updates the buffer, the caller has checked the range
+ */
+static int32_t read_blocks(uint32_t inum, inode_t* inode, uint32_t offset, uint8_t* buf, uint32_t length){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
+	int32_t retval = 0;
+	uint32_t skip, block, count, n;
+	bmap_iter_t it;
+
+	if(length == 0){
+		return 0;
+	}
+	//map only the blocks that hold [offset, offset+length)
+	it.inode = inode;
+	it.next = offset / size;
+	it.end = (offset + length - 1) / size + 1;
+	it.held = NULL;
+	it.good = inode_good(inum);
+	skip = offset % size;
+	while(length > 0){
+		if(bmap_next_run(&it, &block, &count) == -1){
+			retval = -1;		//failure if the block map is bad
+			break;
+		}
+		n = count*size - skip;
+		if(n > length){
+			n = length;
+		}
+		if(copy_run(block, skip, buf, n) == -1){
+			retval = -1;
+			break;
+		}
+		buf += n;
+		length -= n;		//update values
+		retval += n;
+		skip = 0;
+	}
+	if(it.held != NULL){
+		fs_release(it.held);
+	}
+	return retval;
+}
+
+/*
+ * lz4_acquire
+ *   DESCRIPTION: Waits for and takes the decompression buffers
+ *   INPUTS:  NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: halts while another process is decompressing
+ */
+static void lz4_acquire(void){
+	uint32_t flags;
+	cli_and_save(flags);
+	while(lz4_busy){
+		sti_hlt_cli();
+	}
+	lz4_busy = 1;
+	restore_flags(flags);
+}
+
+/*
+ * lz4_load_chunk
+ *   DESCRIPTION: Decompresses one chunk of a compressed file into lz4_out
+ *   INPUTS:  uint32_t inum, inode_t* inode, uint32_t chunk
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 if the stream is bad
+ *   SIDE EFFECTS: reuses lz4_out if it already holds the chunk
+ */
+static int32_t lz4_load_chunk(uint32_t inum, inode_t* inode, uint32_t chunk){
+	uint32_t bounds[2];		//where the chunk starts and ends in the stream
+	uint32_t in_len, out_len;
+
+	if(lz4_valid && lz4_inode == inum && lz4_chunk == chunk && lz4_generation == fs_generation){
+		return 0;
+	}
+	lz4_valid = 0;
+	out_len = inode->i_length - chunk*DATA_BLOCK_SIZE;
+	if(out_len > DATA_BLOCK_SIZE){
+		out_len = DATA_BLOCK_SIZE;
+	}
+	if(read_blocks(inum, inode, chunk*sizeof(uint32_t), (uint8_t*)bounds, sizeof(bounds)) != sizeof(bounds)){
+		return -1;
+	}
+	in_len = bounds[1] - bounds[0];
+	if(bounds[1] < bounds[0] || in_len > out_len){
+		return -1;
+	}
+	if(read_blocks(inum, inode, bounds[0], lz4_in, in_len) != (int32_t)in_len){
+		return -1;
+	}
+	if(in_len == out_len){
+		memcpy(lz4_out, lz4_in, in_len);		//stored, it did not compress
+	}
+	else if(lz4_decompress(lz4_in, in_len, lz4_out, out_len) != (int32_t)out_len){
+		return -1;
+	}
+	lz4_valid = 1;
+	lz4_inode = inum;
+	lz4_chunk = chunk;
+	lz4_generation = fs_generation;
+	return 0;
+}
+
+/*
+ * read_lz4
+ *   DESCRIPTION: Reads a compressed file's contents
+ *   INPUTS:  uint32_t inum, inode_t* inode, uint32_t offset, uint8_t* buf,
+ *						uint32_t length
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes copied, -1 for failure
+ *   SIDE EFFECTS: Updates the buffer, the caller has checked the range
+ */
+static int32_t read_lz4(uint32_t inum, inode_t* inode, uint32_t offset, uint8_t* buf, uint32_t length){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a chunk
+	int32_t retval = 0;
+	uint32_t skip, n;
+
+	lz4_acquire();
+	while(length > 0){
+		if(lz4_load_chunk(inum, inode, offset / size) == -1){
+			retval = -1;
+			break;
+		}
+		skip = offset % size;
+		n = size - skip;
+		if(n > length){
+			n = length;
+		}
+		memcpy(buf, lz4_out + skip, n);
+		buf += n;
+		offset += n;
+		length -= n;
+		retval += n;
+	}
+	lz4_busy = 0;
+	return retval;
+}
+
 /*
  * read_data
  *   DESCRIPTION: Reads a file's contents
@@ -83,53 +723,289 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
  *   SIDE EFFECTS: Updates the buffer with the file's contents
  */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
-	//printf("Got to read data\n");
-	uint32_t i, start, end;
-	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
-	uint32_t retval = 0;
-	start = offset / size;		//set start and end points for loop
-	end = (offset+length)/size;
+	int32_t retval;
+	uint32_t i_length;
+	inode_t* inode_to_read;
 
-	uint32_t n, location_b;
-	uint8_t* location_r;
-	//uint32_t temp = ;
-	//uint32_t temp2;
-	inode_t* inode_to_read = (inode_t*)(location_i + size*inode);
-
-	if(inode > num_inodes-1){
+	if(inode > num_inodes-1 || (inode_to_read = (inode_t*)fs_block(1 + inode)) == NULL){
 		printf("problem 1\n");	//inode value out of range
 		return -1;
 	}
-	if(offset >= inode_to_read->i_length){		//offset out of range
+	i_length = inode_to_read->i_length;
+	if(offset >= i_length){		//offset out of range
+		fs_release((uint8_t*)inode_to_read);
 		return 0;
 	}
-	if(offset+length >= (inode_to_read->i_length)){	//shorten length if out of range
-		length = (inode_to_read->i_length) - offset;
+	if(length > i_length - offset){	//shorten length if out of range
+		length = i_length - offset;
 	}
-	//printf("Pre-forloop\n");
-	//printf("%d\n", num_datablocks);
-	for (i= start ; i<= end ; i++)
-	{
-		if (inode_to_read->data_block_num[i] > num_datablocks-1){
-			return -1;		//failure if data block num is greater than number of total datablocks
-		}
-		else{
-			location_b = inode_to_read->data_block_num[i];
-		}
-		if (((offset%size) + length) >= size){ //check if out of block size
-			n = size - (offset%size);						 //set reading length to within bounds
+
+	if(fs_version >= FS_VERSION_INDIRECT && (inode_to_read->v2.i_flags & INODE_FLAG_LZ4)){
+		retval = read_lz4(inode, inode_to_read, offset, buf, length);
+	}
+	else{
+		retval = read_blocks(inode, inode_to_read, offset, buf, length);
+	}
+	fs_release((uint8_t*)inode_to_read);
+	return retval;		//return number of bytes in the file
+}
+
+/*
+ * read_data_blockwise
+ *   DESCRIPTION: Reads a file the way read_data did before runs were
+ *								 coalesced: the block map looked up and a memcpy made
+ *								 for every 4kB block. Only filesys_bench calls it, to
+ *								 time read_data against
+ *   INPUTS:  uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes copied, -1 for failure or a compressed file
+ *   SIDE EFFECTS: Updates the buffer with the file's contents
+ */
+int32_t read_data_blockwise(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
+	int32_t retval = 0;
+	uint32_t i, n, left;
+	int32_t* entry;
+	uint8_t* data;
+	inode_t* inode_to_read;
+	bmap_iter_t it;
+
+	if(inode > num_inodes-1 || (inode_to_read = (inode_t*)fs_block(1 + inode)) == NULL){
+		return -1;
+	}
+	if(fs_version >= FS_VERSION_INDIRECT && (inode_to_read->v2.i_flags & INODE_FLAG_LZ4)){
+		fs_release((uint8_t*)inode_to_read);
+		return -1;
+	}
+	if(offset >= inode_to_read->i_length){
+		length = 0;
+	}
+	else if(length > inode_to_read->i_length - offset){
+		length = inode_to_read->i_length - offset;
+	}
+	it.inode = inode_to_read;
+	it.held = NULL;
+	it.good = 0;
+	for(i = offset/size; length > 0; i++){
+		if((entry = bmap_segment(&it, i, &left)) == NULL || (uint32_t)*entry >= num_datablocks ||
+				(data = fs_block(data_start + *entry)) == NULL){
+			retval = -1;
+			break;
 		}
-		else{
+		n = size - offset%size;
+		if(n > length){
 			n = length;
 		}
-		location_r = (uint8_t*)(location_d + location_b*size + (offset%size));
-		memcpy(buf, location_r, n); //copy data to the buffer
+		memcpy(buf, data + offset%size, n);
+		fs_release(data);
 		buf += n;
 		offset += n;		//update values
 		length -= n;
 		retval += n;
 	}
-	return retval;		//return number of bytes in the file
+	if(it.held != NULL){
+		fs_release(it.held);
+	}
+	fs_release((uint8_t*)inode_to_read);
+	return retval;
+}
+
+/*
+ * stat_dentry
+ *   DESCRIPTION: Fills in a stat struct for a directory entry
+ *   INPUTS:  const dentry_t* dentry, stat_t* buf
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 for failure
+ *   SIDE EFFECTS: Updates buf with the file's size, type, inode and
+ *								 number of data blocks
+ */
+int32_t stat_dentry(const dentry_t* dentry, stat_t* buf){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
+	uint32_t stream_len;
+	inode_t* inode;
+	if(dentry == NULL || buf == NULL){
+		return -1;
+	}
+	buf->filetype = dentry->filetype;
+	buf->inode_num = dentry->inode_num;
+	buf->size = 0;
+	buf->blocks = 0;
+	switch(dentry->filetype){
+		case 1:		//directory, sized by its entries
+			buf->size = dir_entry_count(dir_handle(dentry))*sizeof(dentry_t);
+			break;
+		case 2:		//regular file
+			if((uint32_t)dentry->inode_num > num_inodes-1 || (inode = (inode_t*)fs_block(1 + dentry->inode_num)) == NULL){
+				return -1;		//inode value out of range
+			}
+			buf->size = inode->i_length;
+			buf->blocks = (buf->size + size - 1)/size;
+			if(fs_version >= FS_VERSION_INDIRECT && (inode->v2.i_flags & INODE_FLAG_LZ4)){
+				//the last chunk table entry is where the stream ends
+				if(read_blocks(dentry->inode_num, inode, buf->blocks*sizeof(uint32_t), (uint8_t*)&stream_len, sizeof(stream_len)) == sizeof(stream_len)){
+					buf->blocks = (stream_len + size - 1)/size;
+				}
+			}
+			fs_release((uint8_t*)inode);
+			break;
+		default:	//rtc and other devices have no data
+			break;
+	}
+	return 0;
+}
+
+/*
+ * fsck_lz4_table
+ *   DESCRIPTION: Checks every offset in a compressed inode's chunk table, as
+ *								 reads of a good inode take each chunk's bounds on trust
+ *   INPUTS:  uint32_t inum, inode_t* inode, uint32_t chunks - chunks in the file
+ *   OUTPUTS: uint32_t* stream_len - the length of the stream, its last offset
+ *   RETURN VALUE: 0 if the offsets start past the table and never go down,
+ *								 -1 if not
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t fsck_lz4_table(uint32_t inum, inode_t* inode, uint32_t chunks, uint32_t* stream_len){
+	uint32_t offsets[FSCK_LZ4_BATCH];
+	uint32_t prev = (chunks + 1)*sizeof(uint32_t);		//the first chunk starts after the table
+	uint32_t i, j, n;
+
+	for(i = 0; i <= chunks; i += n){
+		n = chunks + 1 - i;
+		if(n > FSCK_LZ4_BATCH){
+			n = FSCK_LZ4_BATCH;
+		}
+		if(read_blocks(inum, inode, i*sizeof(uint32_t), (uint8_t*)offsets, n*sizeof(uint32_t)) != (int32_t)(n*sizeof(uint32_t))){
+			return -1;
+		}
+		for(j = 0; j < n; j++){
+			if(offsets[j] < prev){
+				return -1;
+			}
+			prev = offsets[j];
+		}
+	}
+	//the last offset is the end of the stream, so none of the others pass it
+	*stream_len = prev;
+	return 0;
+}
+
+/*
+ * fsck_inode
+ *   DESCRIPTION: Checks that an inode's length and block map fit the image
+ *   INPUTS:  uint32_t inum
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 if the inode is sound, -1 if not
+ *   SIDE EFFECTS: reads every indirect block the inode uses
+ */
+static int32_t fsck_inode(uint32_t inum){
+	uint32_t size = DATA_BLOCK_SIZE;	//4kB size of a block
+	uint32_t length, chunks, block, count;
+	int32_t retval = 0;
+	inode_t* inode;
+	bmap_iter_t it;
+
+	if((inode = (inode_t*)fs_block(1 + inum)) == NULL){
+		return -1;
+	}
+	length = inode->i_length;
+	if(inode->i_length < 0){
+		retval = -1;
+	}
+	else if(fs_version >= FS_VERSION_INDIRECT && (inode->v2.i_flags & INODE_FLAG_LZ4)){
+		//the blocks hold the stream, which ends where the chunk table says
+		chunks = (length + size - 1)/size;
+		retval = fsck_lz4_table(inum, inode, chunks, &length);
+	}
+
+	//every block of the range has to map into the image, the same walk reads do
+	it.inode = inode;
+	it.next = 0;
+	it.end = (length + size - 1)/size;
+	it.held = NULL;
+	it.good = 0;
+	while(retval == 0 && it.next < it.end){
+		retval = bmap_next_run(&it, &block, &count);
+	}
+	if(it.held != NULL){
+		fs_release(it.held);
+	}
+	fs_release((uint8_t*)inode);
+	return retval;
+}
+
+/*
+ * fsck
+ *   DESCRIPTION: Checks the mounted image once so reads can trust it
+ *   INPUTS:  NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bad root entries and inodes, -1 if the
+ *								 bootblock itself is bad
+ *   SIDE EFFECTS: marks every sound inode good, so read_data stops range
+ *								 checking its block numbers
+ */
+int32_t fsck(void){
+	uint32_t i;
+	int32_t bad = 0;
+	dentry_t* dentry;
+
+	if(super_block == NULL || super_block->dir_count < 0 || super_block->dir_count > FS_MAX_DIRENTRIES ||
+			super_block->inode_count <= 0 || super_block->data_count < 0){
+		return -1;
+	}
+	for(i=0; i<num_direntries; i++){
+		dentry = &super_block->direntries[i];
+		if(dentry->filetype < 0 || dentry->filetype > 2 ||
+				(dentry->filetype != 0 && (uint32_t)dentry->inode_num >= num_inodes)){
+			bad++;		//points outside the inode blocks
+		}
+	}
+	for(i=0; i<num_inodes; i++){
+		if(fsck_inode(i) == -1){
+			bad++;
+		}
+		else if(i < FSCK_MAX_INODES){
+			fs_good[i / 32] |= 1 << (i % 32);
+		}
+	}
+	return bad;
+}
+
+/*
+ * fsmap_table
+ *   DESCRIPTION: Returns the directory table fsmap hands to user programs
+ *   INPUTS:  NONE
+ *   OUTPUTS: fsmap_t*
+ *   RETURN VALUE: the page aligned table, NULL if nothing is mounted
+ *   SIDE EFFECTS: refills the table from the bootblock and inodes the
+ *								 first time it is asked for after a mount
+ */
+fsmap_t* fsmap_table(void){
+	uint32_t i, count;
+	inode_t* inode;
+
+	if(super_block == NULL){
+		return NULL;
+	}
+	if(fsmap_generation != fs_generation){
+		count = num_inodes;
+		if(count > FSMAP_MAX_INODES){
+			count = FSMAP_MAX_INODES;		//the rest still need stat
+		}
+		for(i=0; i<count; i++){
+			fsmap_area.i_length[i] = 0;
+			if((inode = (inode_t*)fs_block(1 + i)) != NULL){
+				fsmap_area.i_length[i] = inode->i_length;
+				fs_release((uint8_t*)inode);
+			}
+		}
+		memcpy(&fsmap_area.boot, super_block, sizeof(bootblock_t));
+		fsmap_area.dir_count = num_direntries;
+		fsmap_area.inode_count = count;
+		fsmap_area.data_count = num_datablocks;
+		fsmap_area.generation = fs_generation;
+		fsmap_generation = fs_generation;
+	}
+	return &fsmap_area;
 }
 
 /*
@@ -214,11 +1090,13 @@ int32_t read_f(int32_t fd, void* buf,uint32_t length){
  *   SIDE EFFECTS: fills buffer with contents of directory
  */
 int32_t read_d(int32_t fd, uint8_t* buf, int32_t count){
-	if(get_fp(fd) > num_direntries-1){
+	dentry_t dentry;
+	//the fd's inode holds the handle of the directory being read
+	if(dir_entry_at(get_inode(fd), get_fp(fd), &dentry) == -1){
 		clear_fp(fd);
 		return 0;
 	}
-	strncpy((int8_t*)buf, (const int8_t*)super_block->direntries[get_fp(fd)].filename, FILENAME_LEN);
+	strncpy((int8_t*)buf, (const int8_t*)dentry.filename, FILENAME_LEN);
 	fp_plus(fd);
 	
 	int len = 1;
@@ -230,6 +1108,56 @@ int32_t read_d(int32_t fd, uint8_t* buf, int32_t count){
 	return len;
 }
 
+/*
+ * getdents_d
+ *   DESCRIPTION: read as many directory records as fit in a buffer
+ *   INPUTS:  int32_t fd, uint8_t* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes of records written, 0 at the end of
+ *								 the directory, -1 for failure
+ *   SIDE EFFECTS: fills buffer with dirent_t records and advances the
+ *								 fd's position past them
+ */
+int32_t getdents_d(int32_t fd, uint8_t* buf, int32_t nbytes){
+	uint32_t dir = get_inode(fd);		//handle of the directory being read
+	uint32_t pos = get_fp(fd);
+	uint32_t count = dir_entry_count(dir);
+	int32_t retval = 0;
+	dirent_t* rec = (dirent_t*)buf;
+	dentry_t dentry;
+	stat_t st;
+
+	if(nbytes < (int32_t)sizeof(dirent_t)){
+		return -1;		//not even one record fits
+	}
+	if(pos >= count){
+		clear_fp(fd);
+		return 0;
+	}
+	while(pos < count && retval + (int32_t)sizeof(dirent_t) <= nbytes){
+		uint8_t len = 0;
+		if(dir_entry_at(dir, pos, &dentry) == -1){
+			break;
+		}
+		while(len < FILENAME_LEN && dentry.filename[len] != '\0'){
+			len++;
+		}
+		if(stat_dentry(&dentry, &st) == -1){
+			st.size = 0;
+		}
+		rec->inode_num = dentry.inode_num;
+		rec->size = st.size;
+		rec->filetype = dentry.filetype;
+		rec->name_len = len;
+		memcpy(rec->filename, dentry.filename, FILENAME_LEN);
+		rec++;
+		pos++;
+		retval += sizeof(dirent_t);
+	}
+	set_fp(fd, pos);
+	return retval;
+}
+
 /*
  * write_f
  *   DESCRIPTION: write to a file (read-only!)
@@ -1,10 +1,34 @@
 //FILESYS_PARSE HEADER FILE
+#ifndef _FILESYS_H
+#define _FILESYS_H
+
 #include "types.h"
 #include "lib.h"
 
 #define FILENAME_LEN 32
 #define DATA_BLOCK_SIZE	4096
 
+#define FS_MAGIC		0x46533931	//"19SF", marks a bootblock with format fields
+#define FS_FEAT_SUBDIRS	0x1			//type 1 dentries other than the root name directory inodes
+#define FS_ROOT_DIR		0			//directory handle of the root (the bootblock)
+#define DCACHE_SIZE		64			//number of (parent, name) slots in the dentry cache
+#define FS_MAX_DIRENTRIES	63		//root entries that fit in the bootblock
+#define FSCK_MAX_INODES		4096	//inodes fsck can mark good, the rest are always checked
+#define FSCK_LZ4_BATCH		64		//chunk table entries fsck reads at a time
+
+#define FS_VERSION_INDIRECT	2		//inodes have single and double indirect blocks
+#define INODE_DIRECT_V1		1023	//direct block numbers in an original inode
+#define INODE_DIRECT_V2		1020	//direct block numbers in a version 2 inode
+#define BLOCK_NUMS_PER_BLOCK	(DATA_BLOCK_SIZE/4)	//block numbers in one indirect block
+
+/* A version 2 inode with INODE_FLAG_LZ4 holds a stream instead of the
+ * bytes themselves: a table of chunk count + 1 offsets into the stream,
+ * then every DATA_BLOCK_SIZE bytes of the file as its own LZ4 block, so
+ * any block can be read without the ones before it.  A chunk that would
+ * not shrink is stored as is, recognizable by its stored size being its
+ * full length.  i_length is still the uncompressed size. */
+#define INODE_FLAG_LZ4		0x1
+
 typedef struct{
   int8_t filename[FILENAME_LEN];
   int32_t filetype;
@@ -14,7 +38,15 @@ typedef struct{
 
 typedef struct{
   int32_t i_length;
-  int32_t data_block_num[1023];
+  union{
+    int32_t data_block_num[INODE_DIRECT_V1];  //original format, all direct
+    struct{
+      uint32_t i_flags;
+      int32_t direct[INODE_DIRECT_V2];
+      int32_t indirect;           //block of BLOCK_NUMS_PER_BLOCK block numbers
+      int32_t double_indirect;    //block of indirect block numbers
+    }v2;                          //FS_VERSION_INDIRECT format
+  };
 }inode_t;   //index node struct
 
 
@@ -22,20 +54,57 @@ typedef struct{
   int32_t dir_count;
   int32_t inode_count;
   int32_t data_count;
-  int8_t reserved[52];
-  dentry_t direntries[63];
+  uint32_t fs_magic;
+  uint32_t fs_version;
+  uint32_t fs_features;
+  int8_t reserved[40];
+  dentry_t direntries[FS_MAX_DIRENTRIES];
 }bootblock_t;   //bootblock struct
 
+#define FSMAP_MAX_INODES	((DATA_BLOCK_SIZE - 16)/4)	//inode lengths that fit in the header page
+
+typedef struct{
+  uint32_t generation;      //changes whenever a different image is mounted
+  uint32_t dir_count;
+  uint32_t inode_count;     //entries of i_length that are filled in
+  uint32_t data_count;
+  uint32_t i_length[FSMAP_MAX_INODES];
+  bootblock_t boot;         //second page, a copy of the bootblock
+}fsmap_t;   //read-only directory table fsmap maps into user space
+
+typedef struct{
+  uint32_t size;
+  uint32_t filetype;
+  uint32_t inode_num;
+  uint32_t blocks;
+}stat_t;    //file status struct filled in by stat/fstat
+
+typedef struct __attribute__((packed)){
+  uint32_t inode_num;
+  uint32_t size;
+  uint8_t filetype;
+  uint8_t name_len;
+  int8_t filename[FILENAME_LEN];
+}dirent_t;  //packed directory record returned by getdents
+
 void init_filesystem(uint32_t address);
+int32_t init_filesystem_disk(void);
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t read_data_blockwise(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t stat_dentry(const dentry_t* dentry, stat_t* buf);
+void dcache_stats(uint32_t* hits, uint32_t* misses);
+fsmap_t* fsmap_table(void);
+int32_t fsck(void);
 int32_t open_f(const uint8_t* fname);
 int32_t open_d(const uint8_t* fname);
 int32_t close_f(int32_t fd);
 int32_t close_d(int32_t fd);
 int32_t read_f(int32_t fd, void* buf,uint32_t length);
 int32_t read_d(int32_t fd, uint8_t* buf, int32_t count);
+int32_t getdents_d(int32_t fd, uint8_t* buf, int32_t nbytes);
 int32_t write_f(int32_t fd, int32_t count, void* buf);
 int32_t write_d(int32_t fd, int32_t count, void* buf);
 
+#endif
@@ -0,0 +1,171 @@
+#include "futex.h"
+#include "lib.h"
+#include "paging.h"
+#include "pit.h"
+#include "poll.h"
+#include "signal.h"
+#include "sys_calls.h"
+
+//first pid sleeping in each bucket, 0 if none, chained through pcb->futex_next
+static uint32_t buckets[FUTEX_BUCKETS];
+
+static uint32_t futex_key(uint32_t* addr);
+static uint32_t* futex_bucket(uint32_t key);
+static void futex_unlink(uint32_t* head, uint32_t prev, uint32_t pid);
+
+
+/*
+ * futex_wait
+ *   DESCRIPTION: Sleeps until futex_wake is called on the same word, unless the
+ *								 word no longer holds the value the caller saw
+ *   INPUTS: uint32_t* addr - aligned word in the user page
+ *					 uint32_t expected - value the caller read there
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 once woken, -1 if addr is bad, *addr != expected, or a
+ *								 signal needs delivering instead
+ *   SIDE EFFECTS: the comparison and the sleep happen with interrupts off,
+ *								 so a wake in between cannot be missed. Sleeps in wait_on,
+ *								 so poll_tick gets it up for a signal
+ */
+int32_t futex_wait(uint32_t* addr, uint32_t expected){
+	uint32_t key, flags, pid;
+	uint32_t* head;
+	pcb_t* pcb = get_pcb(current_pid);
+
+	if((key = futex_key(addr)) == 0){
+		return -1;
+	}
+	cli_and_save(flags);
+	if(*addr != expected || signal_interrupts(current_pid)){
+		restore_flags(flags);
+		return -1;
+	}
+	//join the tail, so waiters are woken in the order they came
+	head = futex_bucket(key);
+	if(*head == 0){
+		*head = current_pid;
+	}else{
+		for(pid = *head; get_pcb(pid)->futex_next != 0; pid = get_pcb(pid)->futex_next);
+		get_pcb(pid)->futex_next = current_pid;
+	}
+	pcb->futex_next = 0;
+	pcb->futex_key = key;
+	//other wakeups, such as a sibling thread halting, just put it back to sleep
+	while(pcb->futex_key != 0){
+		if(wait_on(NULL) == -1){
+			futex_cancel(current_pid);
+			restore_flags(flags);
+			return -1;
+		}
+	}
+	restore_flags(flags);
+	return 0;
+}
+
+/*
+ * futex_wake
+ *   DESCRIPTION: Wakes up to n threads sleeping on a word
+ *   INPUTS: uint32_t* addr - aligned word in the user page
+ *					 int32_t n - most threads to wake
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number woken, -1 if addr is bad
+ *   SIDE EFFECTS: the woken threads run on a later PIT tick
+ */
+int32_t futex_wake(uint32_t* addr, int32_t n){
+	uint32_t key, flags, pid, prev = 0;
+	uint32_t* head;
+	int32_t woken = 0;
+	pcb_t* pcb;
+
+	if((key = futex_key(addr)) == 0){
+		return -1;
+	}
+	cli_and_save(flags);
+	head = futex_bucket(key);
+	for(pid = *head; woken < n && pid != 0; pid = pcb->futex_next){
+		pcb = get_pcb(pid);
+		if(pcb->futex_key != key){
+			prev = pid;	//another word in the same bucket
+			continue;
+		}
+		futex_unlink(head, prev, pid);
+		pcb->futex_key = 0;
+		pcb->state = PROC_RUNNING;
+		woken++;
+	}
+	restore_flags(flags);
+	return woken;
+}
+
+/*
+ * futex_cancel
+ *   DESCRIPTION: Takes a thread that is being freed off any bucket
+ *   INPUTS: uint32_t pid - the thread, still marked in use
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: called with interrupts off
+ */
+void futex_cancel(uint32_t pid){
+	pcb_t* pcb = get_pcb(pid);
+	uint32_t* head;
+	uint32_t i, prev = 0;
+
+	if(pcb == NULL || pcb->futex_key == 0){
+		return;
+	}
+	head = futex_bucket(pcb->futex_key);
+	for(i = *head; i != 0 && i != pid; i = get_pcb(i)->futex_next){
+		prev = i;
+	}
+	futex_unlink(head, prev, pid);
+	pcb->futex_key = 0;
+}
+
+/*
+ * futex_key
+ *   DESCRIPTION: Physical address of a user word, so every thread of a program
+ *								 names the same word the same way
+ *   INPUTS: uint32_t* addr - user virtual address
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: the key, 0 if addr is unaligned or outside the user page
+ *   SIDE EFFECTS: NONE
+ */
+static uint32_t futex_key(uint32_t* addr){
+	uint32_t va = (uint32_t)addr;
+	pcb_t* pcb = get_pcb(current_pid);
+
+	if((va & (sizeof(uint32_t)-1)) != 0 || va < MB_128 || va > MB_128 + PROGRAM_SIZE - sizeof(uint32_t)){
+		return 0;
+	}
+	return SHELL_ADDR_1 + pcb->leader*PROGRAM_SIZE + (va & MB_4_MASK);
+}
+
+/*
+ * futex_bucket
+ *   DESCRIPTION: Hashes a key to its bucket
+ *   INPUTS: uint32_t key - physical address
+ *   OUTPUTS: uint32_t*
+ *   RETURN VALUE: the head of the bucket's chain
+ *   SIDE EFFECTS: NONE
+ */
+static uint32_t* futex_bucket(uint32_t key){
+	return &buckets[((key >> 2) * FUTEX_GOLDEN) >> (32 - FUTEX_HASH_BITS)];
+}
+
+/*
+ * futex_unlink
+ *   DESCRIPTION: Takes a thread out of its bucket's chain
+ *   INPUTS: uint32_t* head - the bucket
+ *					 uint32_t prev - pid before it in the chain, 0 if it is first
+ *					 uint32_t pid - the thread
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: leaves the thread's own futex_next alone, so a walk can go on past it
+ */
+static void futex_unlink(uint32_t* head, uint32_t prev, uint32_t pid){
+	if(prev == 0){
+		*head = get_pcb(pid)->futex_next;
+	}else{
+		get_pcb(prev)->futex_next = get_pcb(pid)->futex_next;
+	}
+}
@@ -0,0 +1,15 @@
+/* FUTEX HEADER FILE */
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include "types.h"
+
+#define FUTEX_HASH_BITS		4
+#define FUTEX_BUCKETS		(1 << FUTEX_HASH_BITS)
+#define FUTEX_GOLDEN		0x9E3779B1	//multiplier for Fibonacci hashing
+
+int32_t futex_wait(uint32_t* addr, uint32_t expected);
+int32_t futex_wake(uint32_t* addr, int32_t n);
+void futex_cancel(uint32_t pid);
+
+#endif
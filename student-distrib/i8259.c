@@ -5,6 +5,8 @@
 #include "i8259.h"
 #include "lib.h"
 
+uint32_t irq_counts[NUM_IRQS];
+
 /* 
  * i8259_init()
  *   Description: Initialize the 8259 PIC 
@@ -107,10 +109,13 @@ void disable_irq(uint32_t irq_num) {
  *         Input: The IRQ number
  *        Output: None
  *        Return: None
- *  Side Effects: Sends EOI signal to the IRQ number correcly according to the location of the IRQ
+ *  Side Effects: Sends EOI signal to the IRQ number correcly according to the location of the IRQ,
+ *                counts the interrupt in irq_counts
  */
 
 void send_eoi(uint32_t irq_num) {
+    if (irq_num < NUM_IRQS)
+        irq_counts[irq_num]++;                              //every handler acknowledges exactly once
     if (irq_num>=IRQS_ON_MASTER) {
         outb(EOI|(irq_num-IRQS_ON_MASTER), SLAVE_COMMAND);  //sends EOI signal to SLAVE if irq is on slave
         outb(EOI|SLAVE_IRQ_ON_MASTER, MASTER_COMMAND);      //sends EOI signal to MASTER IRQ where slave is
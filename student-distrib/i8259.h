@@ -22,6 +22,8 @@
 
 /* Number of IRQs on MASTER */
 #define IRQS_ON_MASTER   8
+/* Number of IRQs on both */
+#define NUM_IRQS         16
 
 
 /* Initialization control words to init each PIC.
@@ -50,4 +52,7 @@ void disable_irq(uint32_t irq_num);
 /* Send end-of-interrupt signal for the specified IRQ */
 void send_eoi(uint32_t irq_num);
 
+/* Interrupts handled on each IRQ line, counted by send_eoi */
+extern uint32_t irq_counts[NUM_IRQS];
+
 #endif /* _I8259_H */
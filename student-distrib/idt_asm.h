@@ -0,0 +1,31 @@
+/* idt_asm.h - exception entry stubs
+ */
+
+#ifndef _IDT_ASM_H
+#define _IDT_ASM_H
+
+/* each pushes its vector and an error code, saves a hw_context_t and calls exception_handler */
+extern void divide_error();
+extern void debug();
+extern void nmi();
+extern void breakpoint();
+extern void overflow();
+extern void bound_range();
+extern void invalid_op();
+extern void device_na();
+extern void double_fault();
+extern void seg_overrun();
+extern void invalid_tss();
+extern void seg_np();
+extern void seg_fault();
+extern void gen_prot();
+extern void page_fault();
+extern void fpe();
+extern void align();
+extern void machine();
+extern void simd();
+
+/* restores a hw_context_t and irets, after do_signal */
+extern void interrupt_return();
+
+#endif
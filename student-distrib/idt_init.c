@@ -1,6 +1,8 @@
 #include "idt_init.h"
+#include "idt_asm.h"
 #include "x86_desc.h"
 #include "lib.h"
+#include "signal.h"
 
 #include "keyboard_asm.h"
 #include "rtc_asm.h"
@@ -8,10 +10,19 @@
 #include "sys_calls.h"
 #include "types.h"
 #include "pit_asm.h"
+#include "ata_asm.h"
 
 #define RTC_VAL 0x28
 #define KEYBOARD_VAL 0x21
 
+//what each exception prints when it ends a program
+static char* exception_names[NUM_EXCEPTIONS] = {"Divide error", "Debug error", "NMI interrupt", "Breakpoint",
+									"Overflow", "BOUND range exceeded", "Invalid opcode", "Device not available",
+									"Double fault", "Coprocessor segment overrun", "Invalid TSS", "Segment not present",
+									"Stack-segment fault", "General protection", "Page fault", "Reserved",
+									"x87 FPU floating-point error", "Alignment check", "Machine check",
+									"SIMD floating-point exception"};
+
 /*
  * idt_init
  *   DESCRIPTION: Initializes the IDT to proper values.
@@ -27,10 +38,10 @@
  */
  
 void idt_init(){
-	static void (*functions[21]) = {divide_error, debug, nmi, breakpoint, overflow, bound_range, 
+	static void (*functions[NUM_EXCEPTIONS]) = {divide_error, debug, nmi, breakpoint, overflow, bound_range, 
 									invalid_op, device_na, double_fault, seg_overrun, invalid_tss,
-									seg_np, seg_fault, gen_prot, page_fault, blank, fpe, align,
-									machine, simd, general}; //insert all handler functions
+									seg_np, seg_fault, gen_prot, page_fault, NULL, fpe, align,
+									machine, simd}; //insert all handler stubs
 	int i;
 	for(i=0; i<NUM_VEC; i++){			//loop through all IDT entries
 		idt[i].seg_selector = KERNEL_CS;
@@ -53,7 +64,7 @@ void idt_init(){
 		}
 		
 	}
-	for(i=0; i<20; i++){			//interrupt handlers
+	for(i=0; i<NUM_EXCEPTIONS; i++){			//interrupt handlers
 		if(i==15){
 			continue;
 		}
@@ -64,160 +75,36 @@ void idt_init(){
 	SET_IDT_ENTRY(idt[PIT_VAL], pit_handler);			//PIC timer handler
 	SET_IDT_ENTRY(idt[KEYBOARD_VAL], keyboard_handler);	//keyboard handler
 	SET_IDT_ENTRY(idt[RTC_VAL], rtc_handler); 			//RTC handler
+	SET_IDT_ENTRY(idt[ATA_VAL], ata_handler);			//primary ATA channel handler
 	SET_IDT_ENTRY(idt[SYSCALL_VAL], sys_call_handler);	//syscall handler
 }
 
 
 /*
- * exceptions
- *   DESCRIPTION: Exception handlers to print error message and
- *					call halt to end program.
- *   INPUTS: NONE
+ * exception_handler
+ *   DESCRIPTION: Common handler for the exceptions. A fault in a user program
+ *					with a handler for it raises DIV_ZERO or SEGFAULT instead.
+ *   INPUTS: hw_context_t* ctx - what the entry stub saved
  *   OUTPUTS: NONE
- *   RETURN VALUE: NONE
- *   SIDE EFFECTS: Prints individual error messages corresponding
- *					To the error received.
+ *   RETURN VALUE: NONE, unless a signal was raised
+ *   SIDE EFFECTS: Otherwise prints the error message corresponding
+ *					to the error received and halts the program.
  */
-void divide_error(){
-	cli();
-	clear();					//clear the screen
-	printf("Divide error\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void debug(){
-	cli();
-	clear();					//clear the screen
-	printf("Debug error\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void nmi(){
-	cli();
-	clear();					//clear the screen
-	printf("NMI interrupt\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void breakpoint(){
-	cli();
-	clear();				//clear the screen
-	printf("Breakpoint\n");	//print error message
-	halt(EX_STATUS);		//call halt
-}
-
-void overflow(){
-	cli();
-	clear();				//clear the screen
-	printf("Overflow\n");	//print error message
-	halt(EX_STATUS);		//call halt
-}
-
-void bound_range(){
-	cli();
-	clear();							//clear the screen
-	printf("BOUND range exceeded\n");	//print error message
-	halt(EX_STATUS);					//call halt
-}
-
-void invalid_op(){
-	cli();
-	clear();					//clear the screen
-	printf("Invalid opcode\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void device_na(){
-	cli();
-	clear();							//clear the screen
-	printf("Device not available\n");	//print error message
-	halt(EX_STATUS);					//call halt
-}
-
-void double_fault(){
-	cli();
-	clear();					//clear the screen
-	printf("Double fault\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void seg_overrun(){
-	cli();
-	clear();									//clear the screen
-	printf("Coprocessor segment overrun\n");	//print error message
-	halt(EX_STATUS);							//call halt
-}
-
-void invalid_tss(){
-	cli();
-	clear();					//clear the screen
-	printf("Invalid TSS\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void seg_np(){
-	cli();
-	clear();							//clear the screen
-	printf("Segment not present\n");	//print error message
-	halt(EX_STATUS);					//call halt
-}
-
-void seg_fault(){
-	cli();
-	clear();							//clear the screen
-	printf("Stack-segment fault\n");	//print error message
-	halt(EX_STATUS);					//call halt
-}
-
-void gen_prot(){
-	cli();
-	clear();						//clear the screen
-	printf("General protection\n");	//print error message
-	halt(EX_STATUS);				//call halt
-}
-
-void page_fault(){
-	cli();
-	clear();
-	uint32_t addr = test_cr2();	
-
-	printf("\n0x%x\nPage fault\n",addr);	//print error message
-	halt(EX_STATUS);		//call halt
-}
+void exception_handler(hw_context_t* ctx){
+	uint32_t signum = (ctx->irq_num == 0) ? SIG_DIV_ZERO : SIG_SEGFAULT;
+	pcb_t* pcb = get_pcb(current_pid);
 
-void blank(){
-}
-
-void fpe(){
-	cli();
-	clear();									//clear the screen
-	printf("x87 FPU floating-point error\n");	//print error message
-	halt(EX_STATUS);							//call halt
-}
-
-void align(){
-	cli();
-	clear();						//clear the screen
-	printf("Alignment check\n");	//print error message
-	halt(EX_STATUS);				//call halt
-}
-
-void machine(){
 	cli();
+	//a handler that faults itself is not given another go
+	if(pcb != NULL && (ctx->cs & USER_PL) == USER_PL && !pcb->sig_masked
+		&& get_pcb(pcb->leader)->sig_handlers[signum] != 0){
+		raise_signal(current_pid, signum);
+		return;
+	}
 	clear();					//clear the screen
-	printf("Machine check\n");	//print error message
-	halt(EX_STATUS);			//call halt
-}
-
-void simd(){
-	cli();
-	clear();									//clear the screen
-	printf("SIMD floating-point exception\n");	//print error message
-	halt(EX_STATUS);							//call halt
-}
-
-void general(){
-
+	if(ctx->irq_num == PAGE_FAULT_VEC){
+		printf("\n0x%x\n", test_cr2());
+	}
+	printf("%s\n", exception_names[ctx->irq_num]);	//print error message
+	halt_exception();			//call halt
 }
-
-
@@ -15,6 +15,10 @@
 #include "sys_calls.h"
 #include "term_switch.h"
 #include "pit.h"
+#include "devfs.h"
+#include "serial.h"
+#include "procfs.h"
+#include "vdso.h"
 
 #define RUN_TESTS
 
@@ -55,12 +59,14 @@ void entry(unsigned long magic, unsigned long addr) {
     if (CHECK_FLAG(mbi->flags, 2))
         printf("cmdline = %s\n", (char *)mbi->cmdline);
 	
-	uint32_t fs_addr;
+	uint32_t fs_addr = 0;
+	int32_t fs_bad = 0;
     if (CHECK_FLAG(mbi->flags, 3)) {
         int mod_count = 0;
         int i;
         module_t* mod = (module_t*)mbi->mods_addr;
-		fs_addr = mod->mod_start;
+		if (mbi->mods_count > 0)
+			fs_addr = mod->mod_start;
         while (mod_count < mbi->mods_count) {
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
@@ -145,21 +151,44 @@ void entry(unsigned long magic, unsigned long addr) {
         ltr(KERNEL_TSS);
     }
 
+    /* SYSENTER, if the CPU has it, lands on the same kernel stacks as int $0x80 */
+    sysenter_init();
+
     /* Init the PIC */
     i8259_init();
 
+    /* Init the device registry, the drivers below add themselves to it */
+    devfs_init();
+    procfs_init();
+
     /* Init the keyboard */
     keyboard_init();
 
     /* init the RTC */
     init_rtc();
 
+    /* init COM1, if there is one */
+    serial_init();
+
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
     initialize_page();
 
-	/*Initialize the filesystem*/
-	init_filesystem(fs_addr);
+	/*Initialize the filesystem, from the disk when there is no module, and
+	  check it once so a bad image shows up now and not in execute*/
+	if (fs_addr != 0)
+		init_filesystem(fs_addr);
+	if (fs_addr == 0 && init_filesystem_disk() == -1) {
+		/*without a module there is nothing to fall back to, and no shell to run*/
+		printf("No filesystem module or disk found, stopping\n");
+		while (1)
+			asm volatile ("hlt");
+	}
+	fs_bad = fsck();
+	if (fs_bad == -1)
+		printf("Filesystem bootblock is corrupt\n");
+	else if (fs_bad > 0)
+		printf("Filesystem check: %d bad entries or inodes\n", fs_bad);
 	
 	/*Initialize the pcb array*/
 	init_pcb_array();
@@ -169,6 +198,9 @@ void entry(unsigned long magic, unsigned long addr) {
 	
 	/*Initialize the PIT*/
 	init_pit();
+
+	/*Map the shared clock page, now that the TSC is calibrated*/
+	vdso_init();
 	
 
     /* Enable interrupts */
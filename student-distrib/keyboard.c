@@ -8,6 +8,7 @@
 #include "i8259.h"
 #include "term_driver.h"
 #include "term_switch.h"
+#include "signal.h"
 
 /* maps keycode to ASCII character code */
 char keymap[NUM_ASCII] =  {   '\0', '\0' /*0x01: escape*/,							/* 0x00: not used, 0x01: esc key */
@@ -119,6 +120,7 @@ void keyboard_handler_function() {
 		if ( keymap[(uint8_t)keycode] == '\n' ) {
 			if (line_buffer[(*buffer_count)-1] == '\n') return;
 			type_to_buffer('\n');
+			terminal_wake(curr_term_num);
 			//buffer_command();
 
 			//char string[LINE_BUFFER_SIZE];
@@ -257,6 +259,12 @@ void keyboard_handler_function() {
 			return;
 		}
 		
+		/* ctrl-c interrupts whatever the shell on this terminal is running */
+		if ( ctrl > 0 && keymap[(uint8_t)keycode] == 'c' ) {
+			signal_foreground(curr_term_num);
+			return;
+		}
+		
 		/* if the line buffer is full, don't do anything */
 		if (*buffer_count == LINE_BUFFER_SIZE-1)
 			return;
@@ -113,13 +113,68 @@ do {                                    \
 /* Writes four bytes to four consecutive ports */
 #define outl(data, port)                \
 do {                                    \
-    asm volatile ("outl %l1, (%w0)"     \
+    asm volatile ("outl %k1, (%w0)"     \
             :                           \
             : "d"(port), "a"(data)      \
             : "memory", "cc"            \
     );                                  \
 } while (0)
 
+/* Reads the 64-bit time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint64_t val;
+    asm volatile ("rdtsc"
+            : "=A"(val)
+            :
+            : "memory"
+    );
+    return val;
+}
+
+/* Index of the highest set bit, 0 for 0 as well as 1 */
+static inline uint32_t bsr(uint32_t val) {
+    uint32_t idx;
+    if (val == 0)
+        return 0;
+    asm ("bsrl %1, %0"
+            : "=r"(idx)
+            : "rm"(val)
+            : "cc"
+    );
+    return idx;
+}
+
+/* Index of the lowest set bit; val must not be 0 */
+static inline uint32_t bsf(uint32_t val) {
+    uint32_t idx;
+    asm ("bsfl %1, %0"
+            : "=r"(idx)
+            : "rm"(val)
+            : "cc"
+    );
+    return idx;
+}
+
+/* Write a model-specific register */
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    asm volatile ("wrmsr"
+            :
+            : "c"(msr), "A"(val)
+            : "memory"
+    );
+}
+
+/* Feature flags in EDX of CPUID leaf 1, with the signature in EAX */
+static inline uint32_t cpuid_features(uint32_t* signature) {
+    uint32_t a, b, c, d;
+    asm volatile ("cpuid"
+            : "=a"(a), "=b"(b), "=c"(c), "=d"(d)
+            : "a"(1)
+    );
+    *signature = a;
+    return d;
+}
+
 /* Clear interrupt flag - disables interrupts on this processor */
 #define cli()                           \
 do {                                    \
@@ -171,4 +226,20 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Enables interrupts, halts until the next one arrives and disables them
+ * again. sti holds off interrupts for one instruction, so one that comes
+ * in between cannot be missed before the hlt */
+#define sti_hlt_cli()                   \
+do {                                    \
+    asm volatile ("                   \n\
+            sti                       \n\
+            hlt                       \n\
+            cli                       \n\
+            "                           \
+            :                           \
+            :                           \
+            : "memory", "cc"            \
+    );                                  \
+} while (0)
+
 #endif /* _LIB_H */
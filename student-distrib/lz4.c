@@ -0,0 +1,85 @@
+#include "lz4.h"
+#include "lib.h"
+
+
+/*
+ * lz4_length
+ *   DESCRIPTION: Finishes reading a literal or match length
+ *   INPUTS: const uint8_t** ip, const uint8_t* iend, uint32_t len
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: the whole length, -1 if the input runs out
+ *   SIDE EFFECTS: moves ip past the extra length bytes, if there are any
+ */
+static int32_t lz4_length(const uint8_t** ip, const uint8_t* iend, uint32_t len){
+	uint32_t b;
+	if(len != LZ4_RUN_MASK){
+		return len;
+	}
+	do{
+		if(*ip >= iend){
+			return -1;
+		}
+		b = *(*ip)++;
+		len += b;
+	}while(b == 0xFF);
+	return len;
+}
+
+/*
+ * lz4_decompress
+ *   DESCRIPTION: Decodes one LZ4 block
+ *   INPUTS: const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes written to dst, -1 if the block is
+ *								 malformed or does not fit in dst_len
+ *   SIDE EFFECTS: fills dst; never reads or writes outside either buffer
+ */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len){
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_len;
+	const uint8_t* match;
+	uint32_t token, offset;
+	int32_t len;
+
+	while(ip < iend){
+		token = *ip++;
+
+		//literals
+		if((len = lz4_length(&ip, iend, token >> 4)) == -1){
+			return -1;
+		}
+		if((uint32_t)len > (uint32_t)(iend - ip) || (uint32_t)len > (uint32_t)(oend - op)){
+			return -1;
+		}
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+		if(ip == iend){
+			break;		//the last sequence is literals only
+		}
+
+		//match, copied forwards a byte at a time since it may overlap itself
+		if(iend - ip < 2){
+			return -1;
+		}
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (uint32_t)(op - dst)){
+			return -1;
+		}
+		if((len = lz4_length(&ip, iend, token & LZ4_RUN_MASK)) == -1){
+			return -1;
+		}
+		len += LZ4_MIN_MATCH;
+		if((uint32_t)len > (uint32_t)(oend - op)){
+			return -1;
+		}
+		match = op - offset;
+		while(len-- > 0){
+			*op++ = *match++;
+		}
+	}
+	return op - dst;
+}
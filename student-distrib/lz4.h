@@ -0,0 +1,12 @@
+/* LZ4 HEADER FILE */
+#ifndef _LZ4_H
+#define _LZ4_H
+
+#include "types.h"
+
+#define LZ4_MIN_MATCH	4		//match lengths are stored minus this
+#define LZ4_RUN_MASK	15		//a nibble of 15 means more length bytes follow
+
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+
+#endif /* _LZ4_H */
@@ -133,6 +133,65 @@ void vid_page() {
 	//*pointer = 0;
 }
 
+/*
+ * fs_page
+ *   DESCRIPTION: Maps the filesystem's directory table read-only for user programs
+ *   INPUTS: uint32_t addr - kernel address of the FS_MAP_PAGES pages to map
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: maps the pages at FS_MAP_ADDR
+ */
+void fs_page(uint32_t addr) {
+	int i;
+
+	/*	fsmap virtual address will be at 140 MB, in other words in index 35 of the directory_entry_array,
+	*	user accessible but not writable
+	*/
+	directory_entry_array[FS_MAP_INDEX].present = 1;
+	directory_entry_array[FS_MAP_INDEX].read_write = 0;
+	directory_entry_array[FS_MAP_INDEX].page_size = 0;
+	directory_entry_array[FS_MAP_INDEX].user_super = 1;
+	directory_entry_array[FS_MAP_INDEX].p_table_addr = ((int)fsmap_table_entry_array)>>SHIFT_12;
+
+	/* kernel memory is mapped to itself, so addr is also the physical address */
+	for (i = 0; i < FS_MAP_PAGES; i++) {
+		fsmap_table_entry_array[i].present = 1;
+		fsmap_table_entry_array[i].read_write = 0;
+		fsmap_table_entry_array[i].user_super = 1;
+		fsmap_table_entry_array[i].p_base_addr = addr/KB_4 + i;
+	}
+
+	enable_paging(directory_entry_array);
+}
+
+/*
+ * vdso_page
+ *   DESCRIPTION: Maps the kernel's shared data page read-only for user programs
+ *   INPUTS: uint32_t addr - kernel address of the page
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: maps the page at VDSO_ADDR, for every process at once
+ */
+void vdso_page(uint32_t addr) {
+
+	/*	vdso virtual address will be at 132 MB, in other words in index 33 of the directory_entry_array,
+	*	user accessible but not writable
+	*/
+	directory_entry_array[VDSO_INDEX].present = 1;
+	directory_entry_array[VDSO_INDEX].read_write = 0;
+	directory_entry_array[VDSO_INDEX].page_size = 0;
+	directory_entry_array[VDSO_INDEX].user_super = 1;
+	directory_entry_array[VDSO_INDEX].p_table_addr = ((int)vdso_table_entry_array)>>SHIFT_12;
+
+	/* kernel memory is mapped to itself, so addr is also the physical address */
+	vdso_table_entry_array[0].present = 1;
+	vdso_table_entry_array[0].read_write = 0;
+	vdso_table_entry_array[0].user_super = 1;
+	vdso_table_entry_array[0].p_base_addr = addr/KB_4;
+
+	enable_paging(directory_entry_array);
+}
+
 /*
  * remap_real
  *   DESCRIPTION: Remaps and reinitializes vidmap paging for the currently displayed terminal in PIT handler
@@ -243,3 +302,28 @@ void map_terminal(uint32_t terminal)
 
 	enable_paging(directory_entry_array);
 }
+
+/*
+ * virt_to_phys
+ *   DESCRIPTION: walks the page directory to find where an address really is
+ *   INPUTS: uint32_t addr - virtual address in the current mapping
+ *   OUTPUTS: none
+ *   RETURN VALUE: physical address, 0 if addr is not mapped
+ *   SIDE EFFECTS: none
+ */
+uint32_t virt_to_phys(uint32_t addr)
+{
+	page_directory_entry_t pde = directory_entry_array[addr >> SHIFT_22];
+	page_table_entry_t* table;
+
+	if (!pde.present)
+		return 0;
+	if (pde.page_size)
+		return (pde.val & ~MB_4_MASK) | (addr & MB_4_MASK);		// 4 MB page, the low 22 bits are the offset
+
+	// page tables live in kernel memory, which is mapped to itself
+	table = (page_table_entry_t*)(pde.p_table_addr << SHIFT_12);
+	if (!table[(addr >> SHIFT_12) % NUM_ENTRIES].present)
+		return 0;
+	return (table[(addr >> SHIFT_12) % NUM_ENTRIES].p_base_addr << SHIFT_12) | (addr & KB_4_MASK);
+}
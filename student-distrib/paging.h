@@ -24,10 +24,20 @@
 #define VID_MAP_INDEX	34
 #define VID_MAP_ADDR	0x8800000//136MB
 
+#define FS_MAP_INDEX	35
+#define FS_MAP_ADDR		0x8C00000//140MB
+#define FS_MAP_PAGES	2		// header page and bootblock
+
+#define VDSO_INDEX		33
+#define VDSO_ADDR		0x8400000//132MB
+
 #define KB_8 			0x2000 //8KB
 #define MB_8 			0x800000//8MB
 #define MB_128			0x8000000//128MB
 #define NUM_ENTRIES		1024
+#define SHIFT_22		22
+#define MB_4_MASK		0x3FFFFF	//offset into a 4MB page
+#define KB_4_MASK		0xFFF		//offset into a 4kB page
 
 
 /* struct for page directory entry */
@@ -78,6 +88,10 @@ page_table_entry_t table_entry_array[NUM_ENTRIES] __attribute__((aligned (KB_4))
 
 page_table_entry_t vidmap_table_entry_array[NUM_ENTRIES] __attribute__((aligned (KB_4)));
 
+page_table_entry_t fsmap_table_entry_array[NUM_ENTRIES] __attribute__((aligned (KB_4)));
+
+page_table_entry_t vdso_table_entry_array[NUM_ENTRIES] __attribute__((aligned (KB_4)));
+
 
 /* function to initialize paging */
 extern void initialize_page();
@@ -88,6 +102,12 @@ void remap_page(uint8_t pid);
 /* function to page for vidmap */
 void vid_page();
 
+/* function to page for fsmap */
+void fs_page(uint32_t addr);
+
+/* function to page for the vdso */
+void vdso_page(uint32_t addr);
+
 
 void remap_shadow(uint32_t terminal);
 void remap_real();
@@ -97,4 +117,7 @@ void remap_shadow_lib(uint32_t terminal);
 void reset_mapping();
 void map_terminal();
 
+/* function to translate a mapped address for DMA */
+uint32_t virt_to_phys(uint32_t addr);
+
 #endif
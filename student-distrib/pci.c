@@ -0,0 +1,62 @@
+#include "pci.h"
+#include "lib.h"
+
+
+/*
+ * pci_read
+ *   DESCRIPTION: Reads a dword of a function's configuration space
+ *   INPUTS: pci_dev_t* pdev, uint32_t reg
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: the register's value
+ *   SIDE EFFECTS: NONE
+ */
+uint32_t pci_read(pci_dev_t* pdev, uint32_t reg){
+	outl(PCI_ENABLE | (pdev->bus << 16) | (pdev->dev << 11) | (pdev->func << 8) | (reg & 0xFC), PCI_CONFIG_ADDRESS);
+	return inl(PCI_CONFIG_DATA);
+}
+
+/*
+ * pci_write
+ *   DESCRIPTION: Writes a dword of a function's configuration space
+ *   INPUTS: pci_dev_t* pdev, uint32_t reg, uint32_t val
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: changes the register
+ */
+void pci_write(pci_dev_t* pdev, uint32_t reg, uint32_t val){
+	outl(PCI_ENABLE | (pdev->bus << 16) | (pdev->dev << 11) | (pdev->func << 8) | (reg & 0xFC), PCI_CONFIG_ADDRESS);
+	outl(val, PCI_CONFIG_DATA);
+}
+
+/*
+ * pci_find_class
+ *   DESCRIPTION: Scans the buses for the first function of a class
+ *   INPUTS: uint32_t class, uint32_t subclass, pci_dev_t* pdev
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 if one was found, -1 otherwise
+ *   SIDE EFFECTS: fills in pdev with where the function is
+ */
+int32_t pci_find_class(uint32_t class, uint32_t subclass, pci_dev_t* pdev){
+	uint32_t bus, dev, func, val, nfunc;
+	for(bus=0; bus<PCI_MAX_BUS; bus++){
+		for(dev=0; dev<PCI_MAX_DEV; dev++){
+			nfunc = 1;
+			for(func=0; func<nfunc; func++){
+				pdev->bus = bus;
+				pdev->dev = dev;
+				pdev->func = func;
+				if((pci_read(pdev, PCI_REG_ID) & 0xFFFF) == PCI_NO_DEVICE){
+					continue;
+				}
+				if(func == 0 && (pci_read(pdev, PCI_REG_HEADER) & 0x00800000)){
+					nfunc = PCI_MAX_FUNC;		//multifunction, look at the others too
+				}
+				val = pci_read(pdev, PCI_REG_CLASS);
+				if((val >> 24) == class && ((val >> 16) & 0xFF) == subclass){
+					return 0;
+				}
+			}
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,36 @@
+/* PCI HEADER FILE */
+#ifndef _PCI_H
+#define _PCI_H
+
+#include "types.h"
+
+#define PCI_CONFIG_ADDRESS	0xCF8
+#define PCI_CONFIG_DATA		0xCFC
+#define PCI_ENABLE			0x80000000	//config space access bit
+
+#define PCI_MAX_BUS			256
+#define PCI_MAX_DEV			32
+#define PCI_MAX_FUNC		8
+
+#define PCI_REG_ID			0x00	//device id and vendor id
+#define PCI_REG_COMMAND		0x04	//status and command
+#define PCI_REG_CLASS		0x08	//class, subclass, prog if, revision
+#define PCI_REG_HEADER		0x0C	//bit 23 of this dword marks a multifunction device
+#define PCI_REG_BAR4		0x20
+
+#define PCI_CMD_IO			0x0001	//respond to I/O space accesses
+#define PCI_CMD_MASTER		0x0004	//may act as a bus master
+#define PCI_NO_DEVICE		0xFFFF	//vendor id read from an empty slot
+#define PCI_BAR_IO_MASK		0xFFFC
+
+typedef struct{
+	uint8_t bus;
+	uint8_t dev;
+	uint8_t func;
+}pci_dev_t;	//where a function sits in configuration space
+
+uint32_t pci_read(pci_dev_t* pdev, uint32_t reg);
+void pci_write(pci_dev_t* pdev, uint32_t reg, uint32_t val);
+int32_t pci_find_class(uint32_t class, uint32_t subclass, pci_dev_t* pdev);
+
+#endif /* _PCI_H */
@@ -0,0 +1,253 @@
+#include "pipe.h"
+#include "devfs.h"
+#include "lib.h"
+#include "sys_calls.h"
+
+static pipe_t pipes[MAX_PIPES];
+
+static int32_t pipe_no_read(int32_t fd, void* buf, int32_t nbytes);
+static int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes);
+
+uint32_t pipe_read_fops[FOPS_SIZE] = {(uint32_t)&pipe_open,(uint32_t)&pipe_read,(uint32_t)&pipe_no_write,(uint32_t)&pipe_close_read,(uint32_t)&pipe_poll_read};
+uint32_t pipe_write_fops[FOPS_SIZE] = {(uint32_t)&pipe_open,(uint32_t)&pipe_no_read,(uint32_t)&pipe_write,(uint32_t)&pipe_close_write,(uint32_t)&pipe_poll_write};
+
+
+/*
+ * pipe_create
+ *   DESCRIPTION: Takes a free pipe with one reader and one writer
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: the pipe number to put in both descriptors, -1 if all
+ *								 pipes are in use
+ *   SIDE EFFECTS: empties the pipe
+ */
+int32_t pipe_create(void){
+	uint32_t flags;
+	int32_t p;
+	cli_and_save(flags);
+	for(p=0; p<MAX_PIPES; p++){
+		if(pipes[p].readers == 0 && pipes[p].writers == 0){
+			pipes[p].head = 0;
+			pipes[p].tail = 0;
+			pipes[p].readers = 1;
+			pipes[p].writers = 1;
+			pipes[p].wq = 0;
+			restore_flags(flags);
+			return p;
+		}
+	}
+	restore_flags(flags);
+	return -1;
+}
+
+/*
+ * pipe_open
+ *   DESCRIPTION: Pipes have no name, they are only made by pipe
+ *   INPUTS: const uint8_t* filename
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: -1
+ *   SIDE EFFECTS: NONE
+ */
+int32_t pipe_open(const uint8_t* filename){
+	return -1;
+}
+
+/*
+ * pipe_read
+ *   DESCRIPTION: Takes what is waiting in the pipe, sleeping while it is
+ *								empty and a writer is still open
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, 0 once every writer has closed
+ *								 and the pipe is drained, -1 for a bad buffer or a signal
+ *								 while it was empty
+ *   SIDE EFFECTS: sleeps on the pipe's wait queue until a writer wakes it
+ */
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes){
+	pipe_t* p = &pipes[get_inode(fd)];
+	uint32_t flags, n, start, first;
+
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	cli_and_save(flags);
+	while(p->head == p->tail && p->writers > 0 && nbytes > 0){
+		if(wait_on(&p->wq) == -1){
+			restore_flags(flags);
+			return -1;		//a signal, the pipe is left as it was
+		}
+	}
+
+	//still with interrupts off, so readers sharing this end cannot interleave
+	n = p->head - p->tail;
+	if(n > (uint32_t)nbytes){
+		n = nbytes;
+	}
+	start = p->tail & PIPE_MASK;
+	first = PIPE_SIZE - start;		//bytes before the ring wraps
+	if(first > n){
+		first = n;
+	}
+	memcpy(buf, p->buf + start, first);
+	memcpy((uint8_t*)buf + first, p->buf, n - first);
+	p->tail += n;
+	if(n > 0 && p->wq != 0){
+		wake_up(&p->wq);
+	}
+	restore_flags(flags);
+	return n;
+}
+
+/*
+ * pipe_write
+ *   DESCRIPTION: Copies everything into the pipe, sleeping whenever it
+ *								is full and a reader is still open
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, or what was written before the last reader
+ *								 closed or a signal came, -1 if nothing could be written
+ *   SIDE EFFECTS: sleeps on the pipe's wait queue until a reader wakes it
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes){
+	pipe_t* p = &pipes[get_inode(fd)];
+	uint32_t flags, n, start, first;
+	int32_t done = 0;
+
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	while(done < nbytes){
+		cli_and_save(flags);
+		while(p->head - p->tail == PIPE_SIZE && p->readers > 0){
+			if(wait_on(&p->wq) == -1){
+				break;
+			}
+		}
+		if(p->readers == 0 || p->head - p->tail == PIPE_SIZE){
+			restore_flags(flags);
+			break;		//nobody will ever read it, or a signal came first
+		}
+
+		//at most a ring's worth with interrupts off, then readers get a turn
+		n = PIPE_SIZE - (p->head - p->tail);
+		if(n > (uint32_t)(nbytes - done)){
+			n = nbytes - done;
+		}
+		start = p->head & PIPE_MASK;
+		first = PIPE_SIZE - start;
+		if(first > n){
+			first = n;
+		}
+		memcpy(p->buf + start, (const uint8_t*)buf + done, first);
+		memcpy(p->buf, (const uint8_t*)buf + done + first, n - first);
+		p->head += n;
+		if(p->wq != 0){
+			wake_up(&p->wq);
+		}
+		restore_flags(flags);
+		done += n;
+	}
+	return (done == 0 && nbytes > 0) ? -1 : done;
+}
+
+/*
+ * pipe_close_read / pipe_close_write
+ *   DESCRIPTION: Drops one end of a pipe
+ *   INPUTS: int32_t fd
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: a writer with no readers left fails, a reader with no
+ *								 writers left sees the end of the pipe
+ */
+int32_t pipe_close_read(int32_t fd){
+	pipe_t* p = &pipes[get_inode(fd)];
+	if(p->readers > 0){
+		p->readers--;
+	}
+	wake_up(&p->wq);
+	return 0;
+}
+int32_t pipe_close_write(int32_t fd){
+	pipe_t* p = &pipes[get_inode(fd)];
+	if(p->writers > 0){
+		p->writers--;
+	}
+	wake_up(&p->wq);
+	return 0;
+}
+
+/*
+ * pipe_poll_read / pipe_poll_write
+ *   DESCRIPTION: Whether pipe_read or pipe_write would return at once
+ *   INPUTS: int32_t fd
+ *					 int32_t wait - also wait for the pipe to change
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: POLLIN with bytes waiting, POLLHUP as well once every
+ *								 writer has closed; POLLOUT with room, POLLERR once every
+ *								 reader has closed
+ *   SIDE EFFECTS: NONE
+ */
+int32_t pipe_poll_read(int32_t fd, int32_t wait){
+	pipe_t* p = &pipes[get_inode(fd)];
+	int32_t mask = 0;
+
+	if(p->head != p->tail){
+		mask |= POLLIN;
+	}
+	if(p->writers == 0){
+		mask |= POLLIN | POLLHUP;	//a read returns 0 at once
+	}
+	if(mask == 0 && wait){
+		poll_wait(&p->wq);
+	}
+	return mask;
+}
+int32_t pipe_poll_write(int32_t fd, int32_t wait){
+	pipe_t* p = &pipes[get_inode(fd)];
+	int32_t mask = 0;
+
+	if(p->head - p->tail < PIPE_SIZE){
+		mask |= POLLOUT;
+	}
+	if(p->readers == 0){
+		mask |= POLLERR;
+	}
+	if(mask == 0 && wait){
+		poll_wait(&p->wq);
+	}
+	return mask;
+}
+
+/*
+ * pipe_share
+ *   DESCRIPTION: Counts one more holder of a pipe end, for a descriptor
+ *								 copied into another process
+ *   INPUTS: uint32_t* fops - the copied descriptor's table
+ *					 uint32_t p - its inode, the pipe number for a pipe end
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: nothing unless fops is one of the pipe tables
+ */
+void pipe_share(uint32_t* fops, uint32_t p){
+	if(fops == pipe_read_fops){
+		pipes[p].readers++;
+	}
+	else if(fops == pipe_write_fops){
+		pipes[p].writers++;
+	}
+}
+
+/*
+ * pipe_no_read / pipe_no_write
+ *   DESCRIPTION: Each end only goes one way
+ *   INPUTS: the usual read or write arguments
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: -1
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t pipe_no_read(int32_t fd, void* buf, int32_t nbytes){
+	return -1;
+}
+static int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes){
+	return -1;
+}
@@ -0,0 +1,34 @@
+/* PIPE HEADER FILE */
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "poll.h"
+
+#define PIPE_SIZE		4096	//ring buffer bytes, a power of two
+#define PIPE_MASK		(PIPE_SIZE-1)
+#define MAX_PIPES		8
+
+typedef struct{
+	uint8_t buf[PIPE_SIZE];
+	volatile uint32_t head;		//bytes ever written, the ring index is head & PIPE_MASK
+	volatile uint32_t tail;		//bytes ever read, head - tail are waiting
+	volatile uint32_t readers;		//open read ends
+	volatile uint32_t writers;		//open write ends
+	wait_queue_t wq;		//pollers of either end, woken whenever anything changes
+}pipe_t;	//one pipe, free when both counts are 0
+
+extern uint32_t pipe_read_fops[];
+extern uint32_t pipe_write_fops[];
+
+int32_t pipe_create(void);
+int32_t pipe_open(const uint8_t* filename);
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_close_read(int32_t fd);
+int32_t pipe_close_write(int32_t fd);
+int32_t pipe_poll_read(int32_t fd, int32_t wait);
+int32_t pipe_poll_write(int32_t fd, int32_t wait);
+void pipe_share(uint32_t* fops, uint32_t p);
+
+#endif
@@ -5,9 +5,14 @@
 #include "term_switch.h" 
 #include "paging.h"
 #include "x86_desc.h"
+#include "vdso.h"
+#include "poll.h"
 
 uint32_t PIT_terminal=TERM_3;
 uint32_t first_rotation = 1;
+uint32_t tsc_khz;
+uint32_t pit_ticks;
+uint32_t context_switches;
 
 
 /*
@@ -23,6 +28,32 @@ void init_pit(){
 	outb(PIT_FREQ & PIT_MASK, CHANNEL0); //lower bits to PIT's channel 0
 	outb(PIT_FREQ >> SHIFT_8, CHANNEL0); //higher bits to PIT's channel 0
 	enable_irq(PIT_IRQ);	//enable PIT's IRQ to allow for interrupts
+	calibrate_tsc();
+}
+
+/*
+ * calibrate_tsc
+ *   DESCRIPTION: Times a one-shot count on PIT channel 2 with the TSC
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: sets tsc_khz, leaves the speaker off
+ */
+void calibrate_tsc(){
+	uint32_t gate;
+	uint64_t start, end;
+
+	gate = inb(PIT_GATE_PORT) & ~(PIT_SPEAKER | PIT_GATE2);
+	outb(gate, PIT_GATE_PORT);	//hold channel 2 while it is loaded
+	outb(PIT_CH2_ONESHOT, PIT_PORT);
+	outb(PIT_CALIBRATE_COUNT & PIT_MASK, CHANNEL2);
+	outb(PIT_CALIBRATE_COUNT >> SHIFT_8, CHANNEL2);
+	outb(gate | PIT_GATE2, PIT_GATE_PORT);	//raising the gate starts the count
+
+	start = rdtsc();
+	while(!(inb(PIT_GATE_PORT) & PIT_OUT2));	//output goes high when the count runs out
+	end = rdtsc();
+	tsc_khz = (uint32_t)(end - start) / PIT_CALIBRATE_MS;
 }
 
 /* 
@@ -38,27 +69,33 @@ void pit_handler_function(){
 	//send an EOI to allow other interrupts to occur
 	send_eoi(PIT_IRQ);
 
-	//create the new terminal number, which cycles between 1-3
-	uint32_t new_terminal = PIT_terminal + 1;
-	if(new_terminal==TERM_3+1) new_terminal=1;
+	//charge the tick to whatever was running
+	pcb_t* pcb = get_pcb(current_pid);
+	pit_ticks++;
+	if(pcb != NULL) pcb->ticks++;
+	alarm_tick();
+	poll_tick();
+	vdso_tick();
 
+	/* if the PIT interrupt is one of the first three when the system's booted up, boot up a base shell instead */
+	if(first_rotation==TERM_1 ||first_rotation==TERM_2|| first_rotation==TERM_3){
 
-	//save esp/ebp of current terminal
-    asm volatile("movl %%esp,%%eax;"
-        : "=a"(terminal_array[PIT_terminal].esp)
-        :
-        : "memory");
-    asm volatile("movl %%ebp,%%eax;" 
-    : "=a"(terminal_array[PIT_terminal].ebp)
-    :
-    : "memory");
-
-	//set the video paging so that it points to the correct terminal buffer/display
-	schedule_terminal(PIT_terminal);
+		uint32_t new_terminal = first_rotation;
 
+		//the shell booted on the last tick is resumed from here like any other process
+		if(pcb != NULL){
+			asm volatile("movl %%esp,%%eax;"
+				: "=a"(pcb->kernel_esp)
+				:
+				: "memory");
+			asm volatile("movl %%ebp,%%eax;" 
+			: "=a"(pcb->kernel_ebp)
+			:
+			: "memory");
+		}
 
-	/* if the PIT interrupt is one of the first three when the system's booted up, boot up a base shell instead */
-	if(first_rotation==TERM_1 ||first_rotation==TERM_2|| first_rotation==TERM_3){
+		//set the video paging so that it points to the correct terminal buffer/display
+		schedule_terminal(new_terminal);
 
 		// store the current cursor in the terminal being left and update it to the terminal being switched to
 		terminal_array[PIT_terminal].screenx = screen_x;
@@ -71,7 +108,6 @@ void pit_handler_function(){
 
 		// set the PID for the base shell of the terminal (Terminal 1 Base Shell is at Index 1 of PCB array, etc.)
 		uint8_t pid = new_terminal;
-		terminal_array[new_terminal].curr_pid = pid;
 		first_rotation++; PIT_terminal=new_terminal; 
 
 		// set the parent 
@@ -88,30 +124,107 @@ void pit_handler_function(){
 		execute((uint8_t*)"shell");
 	}
 	else{
+		schedule();
+	}
+}
 
-		// store the current cursor in the terminal being left and update it to the terminal being switched to
-		terminal_array[PIT_terminal].screenx = screen_x;
-		terminal_array[PIT_terminal].screeny = screen_y;
-		screen_x = terminal_array[new_terminal].screenx;
-		screen_y = terminal_array[new_terminal].screeny;
+/* 
+ * schedule()
+ *   Description: Round-robin over every runnable process, whichever terminal it is on
+ *         Input: None
+ *        Output: None
+ *        Return: None, once this process is picked again
+ *  Side Effects: Switches to the next runnable process, if there is another one. Called with interrupts off
+ */
+void schedule(){
+
+	pcb_t* next_pcb;
+	uint32_t next = current_pid;
+	uint32_t i;
+
+	//find the next runnable pid after the current one, which may be the current one again
+	for(i = 0; i < MAX_PROCESSES; i++){
+		next = next % MAX_PROCESSES + 1;
+		next_pcb = get_pcb(next);
+		if(next_pcb != NULL && next_pcb->state == PROC_RUNNING) break;
+	}
+	if(i == MAX_PROCESSES || next == current_pid) return;
+	switch_to(next);
+}
 
-		//if the PIT is working on the currently displayed terminal, update the cursor
-		if(new_terminal == curr_term_num) display_cursor(screen_x,screen_y);
+/* 
+ * switch_to()
+ *   Description: Hands the CPU to one process
+ *         Input: next - pid of a runnable process other than the current one
+ *        Output: None
+ *        Return: None, once this process is picked again
+ *  Side Effects: Saves the running process's esp/ebp in its PCB and switches to next,
+ *                starting it in user mode if it has not run yet. Threads are switched like any
+ *                other process but run in their program's page. Called with interrupts off
+ */
+void switch_to(uint32_t next){
+
+	pcb_t* pcb = get_pcb(current_pid);
+	pcb_t* next_pcb = get_pcb(next);
+
+	//save esp/ebp of current process
+	if(pcb != NULL){
+		asm volatile("movl %%esp,%%eax;"
+			: "=a"(pcb->kernel_esp)
+			:
+			: "memory");
+		asm volatile("movl %%ebp,%%eax;" 
+		: "=a"(pcb->kernel_ebp)
+		:
+		: "memory");
+	}
 
-		//set PIT_terminal to hold the new terminal number
-		PIT_terminal = new_terminal;
-		//switch process paging
-		remap_page(terminal_array[PIT_terminal].curr_pid);	
-		//set tss
-		tss.esp0 = MB_8 - terminal_array[PIT_terminal].curr_pid*KB_8;
-		//restore esp ebp of new terminal
+	//set the video paging so that it points to the correct terminal buffer/display
+	uint32_t new_terminal = next_pcb->terminal;
+	schedule_terminal(new_terminal);
+
+	// store the current cursor in the terminal being left and update it to the terminal being switched to
+	terminal_array[PIT_terminal].screenx = screen_x;
+	terminal_array[PIT_terminal].screeny = screen_y;
+	screen_x = terminal_array[new_terminal].screenx;
+	screen_y = terminal_array[new_terminal].screeny;
+
+	//if the PIT is working on the currently displayed terminal, update the cursor
+	if(new_terminal == curr_term_num) display_cursor(screen_x,screen_y);
+
+	//set PIT_terminal to hold the new process's terminal
+	PIT_terminal = new_terminal;
+	current_pid = next;
+	vdso_switch(next);
+	context_switches++;
+	//switch process paging, threads run in their program's page and a loader in its child's
+	remap_page(next_pcb->page);
+	//set tss and the SYSENTER stack
+	set_kernel_stack(next);
+
+	//a new process or thread starts on an empty kernel stack straight into user mode
+	if(next_pcb->entry != 0){
+		uint32_t entry = next_pcb->entry;
+		next_pcb->entry = 0;
 		asm volatile(
 		"movl %0,%%esp;"
-		"movl %1, %%ebp;"
-		"jmp after_iret"
+		"movl %0, %%ebp;"
+		"pushl %1;"
+		"pushl %2;"
+		"pushl %3;"
+		"pushl %4;"
+		"call context_switch"
         : 
-        : "r"(terminal_array[new_terminal].esp), "r"(terminal_array[new_terminal].ebp)
+        : "r"(tss.esp0), "r"(entry), "i"(USER_CS), "r"(next_pcb->user_esp), "i"(USER_DS)
         : "memory");
-		return;
 	}
+
+	//restore esp ebp of new process
+	asm volatile(
+	"movl %0,%%esp;"
+	"movl %1, %%ebp;"
+	"jmp after_iret"
+       : 
+       : "r"(next_pcb->kernel_esp), "r"(next_pcb->kernel_ebp)
+       : "memory");
 }
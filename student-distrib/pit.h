@@ -9,13 +9,28 @@
 #define PIT_MODE 0x36  //MODE 3 (SQUARE WAVE)
 #define PIT_IRQ 0
 #define PIT_FREQ 39773 //30 Hz
+#define PIT_INPUT_HZ 1193182	//the PIT's input clock, divided by PIT_FREQ
 #define PIT_MASK 0xFF
 #define SHIFT_8 8
 
+#define PIT_GATE_PORT 0x61	//channel 2 gate and output, speaker enable
+#define PIT_GATE2 0x01
+#define PIT_SPEAKER 0x02
+#define PIT_OUT2 0x20
+#define PIT_CH2_ONESHOT 0xB0	//channel 2, low then high byte, mode 0
+#define PIT_CALIBRATE_MS 10
+#define PIT_CALIBRATE_COUNT 11932	//10 ms of the 1.193182 MHz input clock
+
 
 uint32_t PIT_terminal;
+extern uint32_t tsc_khz;	//time-stamp counter ticks per millisecond
+extern uint32_t pit_ticks;	//PIT interrupts since boot
+extern uint32_t context_switches;	//times the PIT handed the CPU to another process
 
 void init_pit();
+void calibrate_tsc();
 void pit_handler_function();
+void schedule();
+void switch_to(uint32_t next);
 
 
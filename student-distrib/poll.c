@@ -0,0 +1,193 @@
+#include "poll.h"
+#include "devfs.h"
+#include "lib.h"
+#include "paging.h"
+#include "pit.h"
+#include "signal.h"
+#include "sys_calls.h"
+
+static int32_t poll_scan(pollfd_t* fds, uint32_t nfds, int32_t wait);
+
+
+/*
+ * poll
+ *   DESCRIPTION: Waits until one of several fds is ready, so a program can
+ *								 wait on the keyboard and the RTC at once. Each fd's
+ *								 fops table reports readiness and names the wait queue
+ *								 the device wakes when that changes.
+ *   INPUTS: pollfd_t* fds - array in the user page
+ *					 uint32_t nfds - its length, at most POLL_MAX_FDS
+ *					 int32_t timeout - ms to wait, 0 to only look, -1 for no limit
+ *   OUTPUTS: fills in every revents
+ *   RETURN VALUE: number of fds with something in revents, 0 if the time ran
+ *								 out, -1 for bad arguments or a signal that needs delivering
+ *   SIDE EFFECTS: the check and the sleep happen with interrupts off, so a
+ *								 wake in between cannot be missed
+ */
+int32_t poll(pollfd_t* fds, uint32_t nfds, int32_t timeout){
+	pcb_t* pcb = get_pcb(current_pid);
+	uint32_t flags, va = (uint32_t)fds;
+	int32_t ready;
+
+	if(nfds > POLL_MAX_FDS || va < MB_128 || va > MB_128 + PROGRAM_SIZE - nfds*sizeof(pollfd_t)){
+		return -1;
+	}
+	cli_and_save(flags);
+	pcb->poll_deadline = (timeout > 0) ? pit_ticks + alarm_ms_to_ticks(timeout) : 0;
+	while((ready = poll_scan(fds, nfds, timeout != 0)) == 0 && timeout != 0){
+		if(pcb->poll_deadline != 0 && (int32_t)(pit_ticks - pcb->poll_deadline) >= 0){
+			break;
+		}
+		if(signal_interrupts(current_pid)){
+			ready = -1;
+			break;
+		}
+		//woken by a device, the deadline or a signal, then look again
+		pcb->poll_sleeping = 1;
+		pcb->state = PROC_WAITING;
+		schedule();
+		pcb->state = PROC_RUNNING;
+		pcb->poll_sleeping = 0;
+	}
+	restore_flags(flags);
+	return ready;
+}
+
+/*
+ * poll_scan
+ *   DESCRIPTION: Asks each fd's fops table what it is ready for
+ *   INPUTS: pollfd_t* fds, uint32_t nfds - already checked
+ *					 int32_t wait - also join each device's wait queue
+ *   OUTPUTS: fills in every revents
+ *   RETURN VALUE: number of fds with something in revents
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t poll_scan(pollfd_t* fds, uint32_t nfds, int32_t wait){
+	uint32_t i;
+	uint32_t* fops;
+	int32_t (*fun_ptr)(int32_t, int32_t);
+	int32_t mask, ready = 0;
+
+	for(i = 0; i < nfds; i++){
+		if(fds[i].fd < 0){
+			fds[i].revents = 0;	//skipped, as with a negative fd elsewhere
+			continue;
+		}
+		if((fops = get_fops(fds[i].fd)) == NULL){
+			mask = POLLNVAL;
+		}else{
+			fun_ptr = (void*)fops[FOPS_POLL];
+			mask = (*fun_ptr)(fds[i].fd, wait) & (fds[i].events | POLLERR | POLLHUP);
+		}
+		fds[i].revents = mask;
+		if(mask != 0){
+			ready++;
+		}
+	}
+	return ready;
+}
+
+/*
+ * poll_wait
+ *   DESCRIPTION: Puts the caller on a wait queue, from a fops poll function
+ *   INPUTS: wait_queue_t* wq - the device's queue
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: a bit left behind when something else woke the caller only
+ *								 costs a later poll one extra look
+ */
+void poll_wait(wait_queue_t* wq){
+	*wq |= 1 << current_pid;
+}
+
+/*
+ * wait_on
+ *   DESCRIPTION: Sleeps until a wait queue is woken, for a driver whose read
+ *								 or write has to block, so it is not scheduled meanwhile
+ *   INPUTS: wait_queue_t* wq - the device's queue, or NULL for a sleeper that
+ *								 is set running directly, as in futex_wait or waitpid
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: 0 once woken, -1 if a signal needs delivering instead
+ *   SIDE EFFECTS: the caller checks its condition and calls this with
+ *								 interrupts off, so a wake in between cannot be missed
+ */
+int32_t wait_on(wait_queue_t* wq){
+	pcb_t* pcb = get_pcb(current_pid);
+
+	if(signal_interrupts(current_pid)){
+		return -1;
+	}
+	if(wq != NULL){
+		poll_wait(wq);
+	}
+	pcb->poll_deadline = 0;
+	pcb->poll_sleeping = 1;
+	pcb->state = PROC_WAITING;
+	schedule();
+	pcb->state = PROC_RUNNING;
+	pcb->poll_sleeping = 0;
+	return 0;
+}
+
+/*
+ * wake_up
+ *   DESCRIPTION: Wakes whatever is sleeping in poll or wait_on on a queue, for a device
+ *								 whose readiness just changed
+ *   INPUTS: wait_queue_t* wq - the device's queue
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: empties the queue; the woken run on a later PIT tick
+ */
+void wake_up(wait_queue_t* wq){
+	uint32_t pid, flags;
+	pcb_t* pcb;
+
+	cli_and_save(flags);
+	for(pid = 1; *wq != 0 && pid <= MAX_PROCESSES; pid++){
+		if(!(*wq & (1 << pid))){
+			continue;
+		}
+		*wq &= ~(1 << pid);
+		if((pcb = get_pcb(pid)) != NULL && pcb->poll_sleeping){
+			pcb->state = PROC_RUNNING;
+		}
+	}
+	restore_flags(flags);
+}
+
+/*
+ * poll_tick
+ *   DESCRIPTION: Called every PIT tick to wake pollers whose time ran out or
+ *								 that have a signal to take
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: NONE
+ */
+void poll_tick(void){
+	uint32_t pid;
+	pcb_t* pcb;
+
+	for(pid = 1; pid <= MAX_PROCESSES; pid++){
+		pcb = get_pcb(pid);
+		if(pcb == NULL || !pcb->poll_sleeping){
+			continue;
+		}
+		if((pcb->poll_deadline != 0 && (int32_t)(pit_ticks - pcb->poll_deadline) >= 0) || signal_interrupts(pid)){
+			pcb->state = PROC_RUNNING;
+		}
+	}
+}
+
+/*
+ * poll_always
+ *   DESCRIPTION: fops poll for what never sleeps: files, directories, and
+ *								 devices whose reads and writes return at once
+ *   INPUTS: int32_t fd, int32_t wait - unused
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: POLLIN | POLLOUT
+ *   SIDE EFFECTS: NONE
+ */
+int32_t poll_always(int32_t fd, int32_t wait){
+	return POLL_ALWAYS;
+}
@@ -0,0 +1,30 @@
+/* POLL HEADER FILE */
+#ifndef _POLL_H
+#define _POLL_H
+
+#include "types.h"
+
+#define POLLIN			0x01	//read would not sleep
+#define POLLOUT			0x04	//write would not sleep
+#define POLLERR			0x08	//write end of a pipe with no reader left
+#define POLLHUP			0x10	//read end of a pipe with no writer left
+#define POLLNVAL		0x20	//fd is not open
+#define POLL_ALWAYS		(POLLIN | POLLOUT)
+#define POLL_MAX_FDS	16		//most fds one call can wait on
+
+typedef uint32_t wait_queue_t;	//a bit per pid that went to sleep in poll on it
+
+typedef struct{
+	int32_t fd;
+	int16_t events;		//POLLIN and POLLOUT it cares about
+	int16_t revents;	//filled in, POLLERR, POLLHUP and POLLNVAL always count
+}pollfd_t;	//same layout as the user's ece391_pollfd
+
+int32_t poll(pollfd_t* fds, uint32_t nfds, int32_t timeout);
+void poll_wait(wait_queue_t* wq);
+int32_t wait_on(wait_queue_t* wq);
+void wake_up(wait_queue_t* wq);
+void poll_tick(void);
+int32_t poll_always(int32_t fd, int32_t wait);
+
+#endif
@@ -0,0 +1,312 @@
+#include "procfs.h"
+#include "devfs.h"
+#include "lib.h"
+#include "sys_calls.h"
+#include "pit.h"
+#include "i8259.h"
+#include "filesys.h"
+#include "bcache.h"
+#include "paging.h"
+#include "poll.h"
+
+static void proc_stat(void);
+static void proc_ps(void);
+static void proc_meminfo(void);
+static void proc_fscache(void);
+static void proc_syscalls(void);
+
+static procfs_file_t proc_files[] = {
+	{"proc/stat", proc_stat, -1},
+	{"proc/ps", proc_ps, -1},
+	{"proc/meminfo", proc_meminfo, -1},
+	{"proc/fscache", proc_fscache, -1},
+	{"proc/syscalls", proc_syscalls, -1},
+};
+#define PROC_NUM_FILES	(sizeof(proc_files)/sizeof(proc_files[0]))
+
+static uint32_t procfs_fops[FOPS_SIZE] = {(uint32_t)&procfs_open,(uint32_t)&procfs_read,(uint32_t)&procfs_write,(uint32_t)&procfs_close,(uint32_t)&poll_always};
+
+static int8_t proc_buf[PROC_BUF_SIZE];		//text of the file being read
+static uint32_t proc_len;
+
+
+/*
+ * procfs_init
+ *   DESCRIPTION: Makes the /proc files reachable through devfs
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: registers every file in proc_files
+ */
+void procfs_init(void){
+	uint32_t i;
+	for(i=0; i<PROC_NUM_FILES; i++){
+		proc_files[i].dev = devfs_register(proc_files[i].name, procfs_fops);
+	}
+}
+
+/*
+ * proc_puts
+ *   DESCRIPTION: Appends a string to the text being generated
+ *   INPUTS: const int8_t* s
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: drops whatever does not fit in proc_buf
+ */
+static void proc_puts(const int8_t* s){
+	while(*s != '\0' && proc_len < PROC_BUF_SIZE){
+		proc_buf[proc_len++] = *s++;
+	}
+}
+
+/*
+ * proc_putn
+ *   DESCRIPTION: Appends a number in decimal, then a separator
+ *   INPUTS: uint32_t n, const int8_t* sep
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: same as proc_puts
+ */
+static void proc_putn(uint32_t n, const int8_t* sep){
+	int8_t num[PROC_NUM_LEN];
+	proc_puts(itoa(n, num, 10));
+	proc_puts(sep);
+}
+
+/*
+ * proc_stat
+ *   DESCRIPTION: /proc/stat, system wide counters since boot
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills proc_buf
+ */
+static void proc_stat(void){
+	uint32_t i;
+	proc_puts("ticks "); proc_putn(pit_ticks, "\n");
+	proc_puts("hz "); proc_putn(PIT_INPUT_HZ / PIT_FREQ, "\n");
+	proc_puts("tsc_khz "); proc_putn(tsc_khz, "\n");
+	proc_puts("context_switches "); proc_putn(context_switches, "\n");
+	//one count per system call number, starting at 1
+	proc_puts("syscalls");
+	for(i=1; i<NUM_SYS_CALLS; i++){
+		proc_puts(" "); proc_putn(syscall_counts[i], "");
+	}
+	//one count per IRQ line, starting at 0
+	proc_puts("\nirqs");
+	for(i=0; i<NUM_IRQS; i++){
+		proc_puts(" "); proc_putn(irq_counts[i], "");
+	}
+	proc_puts("\n");
+}
+
+/*
+ * proc_ps
+ *   DESCRIPTION: /proc/ps, one line per process, zombies included
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills proc_buf
+ */
+static void proc_ps(void){
+	uint32_t pid;
+	pcb_t* pcb;
+	static const int8_t* states[] = {"R ", "W ", "Z "};	//indexed by PROC_RUNNING etc.
+	proc_puts("pid ppid tty ticks syscalls state name\n");
+	for(pid=1; pid<=MAX_PROCESSES; pid++){
+		if((pcb = get_pcb(pid)) == NULL){
+			continue;
+		}
+		proc_putn(pid, " ");
+		proc_putn(pcb->parent_pid, " ");
+		proc_putn(pcb->terminal, " ");
+		proc_putn(pcb->ticks, " ");
+		proc_putn(pcb->syscalls, " ");
+		proc_puts(states[pcb->state]);
+		proc_puts((int8_t*)pcb->name);
+		proc_puts("\n");
+	}
+}
+
+/*
+ * proc_meminfo
+ *   DESCRIPTION: /proc/meminfo, how the fixed memory layout is used
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills proc_buf
+ */
+static void proc_meminfo(void){
+	uint32_t pid, used = 0;
+	pcb_t* pcb;
+	for(pid=1; pid<=MAX_PROCESSES; pid++){
+		if((pcb = get_pcb(pid)) != NULL && pcb->leader == pid){
+			used++;
+		}
+	}
+	//the kernel and every program each get one 4MB page frame, threads share their program's
+	proc_puts("kernel_kb "); proc_putn(PROGRAM_SIZE / 1024, "\n");
+	proc_puts("frame_kb "); proc_putn(PROGRAM_SIZE / 1024, "\n");
+	proc_puts("frames_used "); proc_putn(used, "\n");
+	proc_puts("frames_total "); proc_putn(MAX_PROCESSES, "\n");
+	proc_puts("bcache_kb "); proc_putn(BCACHE_SIZE*DATA_BLOCK_SIZE / 1024, "\n");
+}
+
+/*
+ * proc_fscache
+ *   DESCRIPTION: /proc/fscache, dentry and buffer cache counters
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills proc_buf
+ */
+static void proc_fscache(void){
+	uint32_t hits, misses, evictions;
+	dcache_stats(&hits, &misses);
+	proc_puts("dcache_hits "); proc_putn(hits, "\n");
+	proc_puts("dcache_misses "); proc_putn(misses, "\n");
+	bcache_stats(&hits, &misses, &evictions);
+	proc_puts("bcache_hits "); proc_putn(hits, "\n");
+	proc_puts("bcache_misses "); proc_putn(misses, "\n");
+	proc_puts("bcache_evictions "); proc_putn(evictions, "\n");
+}
+
+/*
+ * proc_sys_hist
+ *   DESCRIPTION: One line per system call number that was timed: pid, number,
+ *                calls, cycles/1024, the first nonempty log2 bucket, then the
+ *                counts from there to the last nonempty one
+ *   INPUTS: uint32_t pid - 0 for the whole system
+ *           pcb_t* pcb - the process's leader, NULL for the whole system
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: same as proc_puts
+ */
+static void proc_sys_hist(uint32_t pid, pcb_t* pcb){
+	uint32_t num, lo, hi, b, calls;
+	uint32_t counts[SYS_HIST_BUCKETS];
+	uint64_t cycles;
+	for(num=1; num<NUM_SYS_CALLS; num++){
+		calls = 0;
+		lo = SYS_HIST_BUCKETS;
+		hi = 0;
+		for(b=0; b<SYS_HIST_BUCKETS; b++){
+			counts[b] = pcb ? pcb->sys_hist[num][b] : syscall_hist[num][b];
+			if(counts[b] != 0){
+				calls += counts[b];
+				if(lo == SYS_HIST_BUCKETS) lo = b;
+				hi = b;
+			}
+		}
+		if(calls == 0){
+			continue;
+		}
+		cycles = pcb ? pcb->sys_cycles[num] : syscall_cycles[num];
+		proc_putn(pid, " ");
+		proc_putn(num, " ");
+		proc_putn(calls, " ");
+		proc_putn((uint32_t)(cycles >> 10), " ");
+		proc_putn(lo, "");
+		for(b=lo; b<=hi; b++){
+			proc_puts(" "); proc_putn(counts[b], "");
+		}
+		proc_puts("\n");
+	}
+}
+
+/*
+ * proc_syscalls
+ *   DESCRIPTION: /proc/syscalls, how long system calls took, for the whole
+ *                system as pid 0 and then for each process
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: fills proc_buf
+ */
+static void proc_syscalls(void){
+	uint32_t pid;
+	pcb_t* pcb;
+	proc_puts("pid num calls kcycles first_bucket counts\n");
+	proc_sys_hist(0, NULL);
+	for(pid=1; pid<=MAX_PROCESSES; pid++){
+		if((pcb = get_pcb(pid)) != NULL && pcb->leader == pid){
+			proc_sys_hist(pid, pcb);
+		}
+	}
+}
+
+/*
+ * procfs_open
+ *   DESCRIPTION: Nothing to set up, the text is made on every read
+ *   INPUTS: const uint8_t* filename
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t procfs_open(const uint8_t* filename){
+	return 0;
+}
+
+/*
+ * procfs_read
+ *   DESCRIPTION: Generates the file from the live counters and copies
+ *								out the part at the file position
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, 0 at the end, -1 for failure
+ *   SIDE EFFECTS: advances the file position. Reading in pieces can mix
+ *								 two snapshots, so readers should ask for the whole
+ *								 file at once
+ */
+int32_t procfs_read(int32_t fd, void* buf, int32_t nbytes){
+	uint32_t flags, i;
+	uint32_t pos = get_fp(fd);
+	int32_t dev = get_inode(fd);
+	int32_t n = 0;
+
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	for(i=0; i<PROC_NUM_FILES && proc_files[i].dev != dev; i++);
+	if(i == PROC_NUM_FILES){
+		return -1;
+	}
+	//one shared buffer, so generate and copy without being preempted
+	cli_and_save(flags);
+	proc_len = 0;
+	proc_files[i].generate();
+	if(pos < proc_len){
+		n = proc_len - pos;
+		if(n > nbytes){
+			n = nbytes;
+		}
+		memcpy(buf, proc_buf + pos, n);
+		set_fp(fd, pos + n);
+	}
+	restore_flags(flags);
+	return n;
+}
+
+/*
+ * procfs_write
+ *   DESCRIPTION: /proc files are read only
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: -1
+ *   SIDE EFFECTS: NONE
+ */
+int32_t procfs_write(int32_t fd, const void* buf, int32_t nbytes){
+	return -1;
+}
+
+/*
+ * procfs_close
+ *   DESCRIPTION: Nothing to do
+ *   INPUTS: int32_t fd
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t procfs_close(int32_t fd){
+	return 0;
+}
@@ -0,0 +1,22 @@
+/* PROCFS HEADER FILE */
+#ifndef _PROCFS_H
+#define _PROCFS_H
+
+#include "types.h"
+
+#define PROC_BUF_SIZE	4096	//longest text a /proc file generates
+#define PROC_NUM_LEN	11		//digits of a uint32_t and the NUL
+
+typedef struct{
+	const int8_t* name;		//registered in devfs, so it starts with PROC_DIR
+	void (*generate)(void);		//writes the file's text with proc_puts/proc_putn
+	int32_t dev;		//device number devfs gave it
+}procfs_file_t;	//one read-only pseudo-file
+
+void procfs_init(void);
+int32_t procfs_open(const uint8_t* filename);
+int32_t procfs_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t procfs_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t procfs_close(int32_t fd);
+
+#endif
@@ -0,0 +1,79 @@
+#include "ring.h"
+#include "lib.h"
+#include "paging.h"
+#include "sys_calls.h"
+#include "term_driver.h"
+
+static int32_t ring_call(const ring_sqe_t* sqe);
+static int32_t user_buffer(uint32_t buf, int32_t nbytes);
+
+
+/*
+ * ring_enter
+ *   DESCRIPTION: Runs every call queued on a ring, in order, for the price of one trap
+ *   INPUTS: ring_t* ring - the program's ring
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of calls run, -1 if the ring is not in the program's page
+ *   SIDE EFFECTS: stops early when the completion queue is full; the rest stay
+ *								 queued for the next ring_enter. A call that sleeps, such as a
+ *								 read of an empty pipe, holds up the ones behind it.
+ */
+int32_t ring_enter(ring_t* ring){
+	ring_sqe_t sqe;
+	ring_cqe_t* cqe;
+	int32_t done = 0;
+
+	if(!user_buffer((uint32_t)ring, sizeof(ring_t))){
+		return -1;
+	}
+	while(ring->sq_head != ring->sq_tail && ring->cq_tail - ring->cq_head < RING_ENTRIES){
+		sqe = ring->sq[ring->sq_head & RING_MASK];	//a copy, other threads share the ring
+		ring->sq_head++;
+		cqe = &ring->cq[ring->cq_tail & RING_MASK];
+		cqe->result = ring_call(&sqe);
+		cqe->user_data = sqe.user_data;
+		ring->cq_tail++;
+		done++;
+	}
+	return done;
+}
+
+/*
+ * ring_call
+ *   DESCRIPTION: Runs one queued call through the same code, and so the same fops
+ *								 tables, as its system call
+ *   INPUTS: const ring_sqe_t* sqe - kernel copy of the entry
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: the call's return value, -1 for an unknown op or a bad buffer
+ *   SIDE EFFECTS: those of the call
+ */
+static int32_t ring_call(const ring_sqe_t* sqe){
+	switch(sqe->op){
+	case RING_OP_READ:
+		if(!user_buffer(sqe->buf, sqe->nbytes)) return -1;
+		return read(sqe->fd, (void*)sqe->buf, sqe->nbytes);
+	case RING_OP_WRITE:
+		if(!user_buffer(sqe->buf, sqe->nbytes)) return -1;
+		return write(sqe->fd, (const void*)sqe->buf, sqe->nbytes);
+	case RING_OP_OPEN:
+		if(!user_string((const uint8_t*)sqe->buf, LINE_BUFFER_SIZE)) return -1;
+		return open((const uint8_t*)sqe->buf);
+	case RING_OP_CLOSE:
+		return close(sqe->fd);
+	default:
+		return -1;
+	}
+}
+
+/*
+ * user_buffer
+ *   DESCRIPTION: Checks that a buffer lies in the program's page
+ *   INPUTS: uint32_t buf - user address
+ *					 int32_t nbytes - its length
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 1 if it does, else 0
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t user_buffer(uint32_t buf, int32_t nbytes){
+	return nbytes >= 0 && buf >= MB_128 && buf <= MB_128 + PROGRAM_SIZE && (uint32_t)nbytes <= MB_128 + PROGRAM_SIZE - buf;
+}
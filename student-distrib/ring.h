@@ -0,0 +1,42 @@
+/* RING HEADER FILE */
+#ifndef _RING_H
+#define _RING_H
+
+#include "types.h"
+
+#define RING_ENTRIES	64		//slots in each queue, a power of two
+#define RING_MASK		(RING_ENTRIES-1)
+
+#define RING_OP_READ	3		//the operations take their system call numbers
+#define RING_OP_WRITE	4
+#define RING_OP_OPEN	5
+#define RING_OP_CLOSE	6
+
+typedef struct{
+	uint32_t op;		//RING_OP_*
+	int32_t fd;			//read, write and close
+	uint32_t buf;		//buffer for read and write, file name for open
+	int32_t nbytes;		//read and write
+	uint32_t user_data;	//handed back untouched in the completion
+}ring_sqe_t;	//one queued call
+
+typedef struct{
+	int32_t result;		//what the call would have returned
+	uint32_t user_data;
+}ring_cqe_t;	//one finished call
+
+/* Lives in the program's own memory; the program fills sq and moves sq_tail,
+ * ring_enter runs the calls and moves sq_head and cq_tail, and the program
+ * takes results from cq and moves cq_head. Counters only ever grow. */
+typedef struct{
+	volatile uint32_t sq_head;
+	volatile uint32_t sq_tail;
+	volatile uint32_t cq_head;
+	volatile uint32_t cq_tail;
+	ring_sqe_t sq[RING_ENTRIES];
+	ring_cqe_t cq[RING_ENTRIES];
+}ring_t;
+
+int32_t ring_enter(ring_t* ring);
+
+#endif
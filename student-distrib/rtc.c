@@ -6,6 +6,8 @@
 #include "lib.h"
 #include "types.h"
 #include "pit.h"
+#include "devfs.h"
+#include "poll.h"
 //https://wiki.osdev.org/RTC
 
 #define RTC_MAR	0x70	//address Register / Index register
@@ -26,6 +28,9 @@
 static volatile int interrupt_occurred[rtc_max_index] = {0,0,0,0,0,0,0};
 static volatile int rate[rtc_max_index]  = {f_2_Hz,f_2_Hz,f_2_Hz,f_2_Hz,f_2_Hz,f_2_Hz,f_2_Hz} ;
 static volatile int count[rtc_max_index] = {0,0,0,0,0,0,0};
+static wait_queue_t rtc_wq[rtc_max_index];	//pollers per terminal, woken when its rate is reached
+
+static uint32_t rtc_fops[FOPS_SIZE] = {(uint32_t)&rtc_open,(uint32_t)&rtc_read,(uint32_t)&rtc_write,(uint32_t)&rtc_close,(uint32_t)&rtc_poll};
 
 
 /*
@@ -34,7 +39,7 @@ static volatile int count[rtc_max_index] = {0,0,0,0,0,0,0};
  *	INPUTS:none
  *	OUTPUTS: turns on the oscillator at 2 Hz, enable periodic interrupts
  *	RETURN VALUE:none
- *	SIDE EFFECTS: RTC interrupts happen
+ *	SIDE EFFECTS: RTC interrupts happen, registers /dev/rtc
  */
 void init_rtc(void){
 	//turn on oscillator
@@ -57,6 +62,7 @@ void init_rtc(void){
 	outb(reg_b,RTC_MDR);
 
 	enable_irq(RTC_IRQ_LINE);
+	devfs_register("rtc", rtc_fops);
 }
 
 /*
@@ -74,10 +80,12 @@ void rtc_interrupt(void){
 	outb( RTC_REGISTER_C, RTC_MAR);
 	inb(RTC_MDR);
 
-	//go through every pid counter and increment it
+	//go through every pid counter and increment it, waking pollers once it is due
 	int i=0;
-	for (i=0;i<=rtc_max_index;i++)
-		count[i]++;
+	for (i=0;i<rtc_max_index;i++){
+		if (++count[i] == f_256_Hz/rate[i] && rtc_wq[i] != 0)
+			wake_up(&rtc_wq[i]);
+	}
 }
 
 /*
@@ -177,3 +185,22 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes)
 	count[PIT_terminal] = 0;
 	return 0;
 }
+
+/*
+ *	rtc_poll
+ *  DESCRIPTION: whether rtc_read would return at once
+ *	INPUTS:
+ *  	int32_t fd 		- a file descriptor (not used)
+ *  	int32_t wait	- also wait for the terminal's next tick
+ *	OUTPUTS: none
+ *	RETURN VALUE: POLLIN once the program's rate is reached, and POLLOUT
+ *	SIDE EFFECTS: none
+ */
+int32_t rtc_poll(int32_t fd, int32_t wait)
+{
+	if (count[PIT_terminal] >= f_256_Hz/rate[PIT_terminal])
+		return POLLIN | POLLOUT;
+	if (wait)
+		poll_wait(&rtc_wq[PIT_terminal]);
+	return POLLOUT;
+}
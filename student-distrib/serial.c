@@ -0,0 +1,97 @@
+#include "serial.h"
+#include "devfs.h"
+#include "lib.h"
+#include "poll.h"
+
+static uint32_t serial_fops[FOPS_SIZE] = {(uint32_t)&serial_open,(uint32_t)&serial_read,(uint32_t)&serial_write,(uint32_t)&serial_close,(uint32_t)&poll_always};
+
+
+/*
+ * serial_init
+ *   DESCRIPTION: Sets COM1 to 115200 8N1 with the FIFOs on, polled
+ *   INPUTS: NONE
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0 for success, -1 if there is no UART
+ *   SIDE EFFECTS: registers /dev/serial
+ */
+int32_t serial_init(void){
+	outb(UART_PROBE, COM1_PORT + UART_SCRATCH);
+	if(inb(COM1_PORT + UART_SCRATCH) != UART_PROBE){
+		return -1;
+	}
+	outb(0, COM1_PORT + UART_IER);		//no interrupts, reads and writes poll
+	outb(UART_LCR_DLAB, COM1_PORT + UART_LCR);
+	outb(UART_DIVISOR & 0xFF, COM1_PORT + UART_DATA);
+	outb(UART_DIVISOR >> 8, COM1_PORT + UART_IER);
+	outb(UART_LCR_8N1, COM1_PORT + UART_LCR);
+	outb(UART_FCR_ENABLE, COM1_PORT + UART_FCR);
+	outb(UART_MCR_READY, COM1_PORT + UART_MCR);
+	devfs_register("serial", serial_fops);
+	return 0;
+}
+
+/*
+ * serial_open
+ *   DESCRIPTION: Nothing to do, the port is set up at boot
+ *   INPUTS: const uint8_t* filename
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t serial_open(const uint8_t* filename){
+	return 0;
+}
+
+/*
+ * serial_read
+ *   DESCRIPTION: Takes the bytes that have arrived, without waiting
+ *   INPUTS: int32_t fd, void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: number of bytes read, 0 if none are waiting, -1 for a
+ *								 bad buffer
+ *   SIDE EFFECTS: empties the receive FIFO into buf
+ */
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes){
+	uint8_t* out = (uint8_t*)buf;
+	int32_t n = 0;
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	while(n < nbytes && (inb(COM1_PORT + UART_LSR) & UART_LSR_DATA)){
+		out[n++] = inb(COM1_PORT + UART_DATA);
+	}
+	return n;
+}
+
+/*
+ * serial_write
+ *   DESCRIPTION: Sends bytes, waiting for room in the transmitter
+ *   INPUTS: int32_t fd, const void* buf, int32_t nbytes
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: nbytes, -1 for a bad buffer
+ *   SIDE EFFECTS: writes to COM1
+ */
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes){
+	const uint8_t* in = (const uint8_t*)buf;
+	int32_t i;
+	if(buf == NULL || nbytes < 0){
+		return -1;
+	}
+	for(i=0; i<nbytes; i++){
+		while(!(inb(COM1_PORT + UART_LSR) & UART_LSR_EMPTY));
+		outb(in[i], COM1_PORT + UART_DATA);
+	}
+	return nbytes;
+}
+
+/*
+ * serial_close
+ *   DESCRIPTION: Nothing to do
+ *   INPUTS: int32_t fd
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t serial_close(int32_t fd){
+	return 0;
+}
@@ -0,0 +1,31 @@
+/* SERIAL HEADER FILE */
+#ifndef _SERIAL_H
+#define _SERIAL_H
+
+#include "types.h"
+
+#define COM1_PORT		0x3F8
+#define UART_DATA		0		//receive/transmit buffer, divisor low with DLAB
+#define UART_IER		1		//interrupt enable, divisor high with DLAB
+#define UART_FCR		2		//FIFO control
+#define UART_LCR		3		//line control
+#define UART_MCR		4		//modem control
+#define UART_LSR		5		//line status
+#define UART_SCRATCH	7
+
+#define UART_LCR_DLAB	0x80	//the first two registers are the divisor
+#define UART_LCR_8N1	0x03
+#define UART_FCR_ENABLE	0xC7	//enable and clear the FIFOs, 14 byte threshold
+#define UART_MCR_READY	0x03	//DTR and RTS
+#define UART_LSR_DATA	0x01	//a received byte is waiting
+#define UART_LSR_EMPTY	0x20	//the transmit buffer can take a byte
+#define UART_DIVISOR	1		//115200 baud
+#define UART_PROBE		0x5A	//scratch value that shows a UART is there
+
+int32_t serial_init(void);
+int32_t serial_open(const uint8_t* filename);
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t serial_close(int32_t fd);
+
+#endif
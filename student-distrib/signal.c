@@ -0,0 +1,203 @@
+#include "signal.h"
+#include "lib.h"
+#include "paging.h"
+#include "pit.h"
+#include "sys_calls.h"
+
+//the sigreturn trampoline copied under each handler frame: movl $10,%eax; int $0x80
+static uint8_t sigreturn_code[SIGRETURN_CODE_SIZE] = {0xB8, 0x0A, 0x00, 0x00, 0x00, 0xCD, 0x80, 0x90};
+
+static int32_t user_range(uint32_t start, uint32_t end);
+
+
+/*
+ * raise_signal
+ *   DESCRIPTION: Marks a signal pending, to be delivered the next time the
+ *								 thread goes back to user mode
+ *   INPUTS: uint32_t pid - thread that faulted, or the leader of a program for
+ *												 the signals that are not about one instruction
+ *					 uint32_t signum - SIG_*
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: NONE
+ */
+void raise_signal(uint32_t pid, uint32_t signum){
+	pcb_t* pcb = get_pcb(pid);
+
+	if(pcb == NULL || signum >= NUM_SIGNALS){
+		return;
+	}
+	pcb->sig_pending |= 1 << signum;
+}
+
+/*
+ * signal_foreground
+ *   DESCRIPTION: Sends INTERRUPT for ctrl-c to the program the terminal's shell
+ *								 is waiting on, following nested shells down
+ *   INPUTS: uint32_t terminal - the terminal on screen
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: the base shell itself is left alone
+ */
+void signal_foreground(uint32_t terminal){
+	uint32_t fg = terminal, i;	//a terminal's base shell has its number as pid
+	pcb_t* pcb;
+
+	for(i = 1; i <= MAX_PROCESSES; i++){
+		pcb = get_pcb(i);
+		if(pcb == NULL || pcb->parent_pid != fg || pcb->leader != i || pcb->background || pcb->state == PROC_ZOMBIE){
+			continue;
+		}
+		fg = i;
+		i = 0;	//look for its child in turn
+	}
+	if(fg != terminal){
+		raise_signal(fg, SIG_INTERRUPT);
+	}
+}
+
+/*
+ * signal_interrupts
+ *   DESCRIPTION: Whether a thread sleeping in poll should get up to take a
+ *								 signal, one with a handler or a default that halts, or to halt
+ *								 with its program
+ *   INPUTS: uint32_t pid - the sleeping thread
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 1 if so, else 0
+ *   SIDE EFFECTS: NONE
+ */
+int32_t signal_interrupts(uint32_t pid){
+	pcb_t* pcb = get_pcb(pid);
+	pcb_t* leader;
+	uint32_t signum;
+
+	if(pcb == NULL){
+		return 0;
+	}
+	if(pcb->exiting){
+		return 1;
+	}
+	if(pcb->sig_masked || pcb->sig_pending == 0){
+		return 0;
+	}
+	leader = get_pcb(pcb->leader);
+	for(signum = 0; signum < NUM_SIGNALS; signum++){
+		if((pcb->sig_pending & (1 << signum)) && (leader->sig_handlers[signum] != 0 ||
+			signum == SIG_DIV_ZERO || signum == SIG_SEGFAULT || signum == SIG_INTERRUPT)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * alarm_tick
+ *   DESCRIPTION: Counts down every program's alarm, from the PIT handler
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: raises ALARM on the leaders whose period ran out
+ */
+void alarm_tick(void){
+	uint32_t i;
+	pcb_t* pcb;
+
+	for(i = 1; i <= MAX_PROCESSES; i++){
+		pcb = get_pcb(i);
+		if(pcb == NULL || pcb->leader != i || pcb->alarm_period == 0 || pcb->state == PROC_ZOMBIE){
+			continue;
+		}
+		if(--pcb->alarm_left == 0){
+			pcb->alarm_left = pcb->alarm_period;
+			raise_signal(i, SIG_ALARM);
+		}
+	}
+}
+
+/*
+ * alarm_ms_to_ticks
+ *   DESCRIPTION: Rounds a period up to whole PIT ticks
+ *   INPUTS: uint32_t ms - period, 0 for none
+ *   OUTPUTS: uint32_t
+ *   RETURN VALUE: ticks, at least 1 unless ms is 0
+ *   SIDE EFFECTS: NONE
+ */
+uint32_t alarm_ms_to_ticks(uint32_t ms){
+	return (ms * (PIT_INPUT_HZ / PIT_FREQ) + 999) / 1000;
+}
+
+/*
+ * do_signal
+ *   DESCRIPTION: Runs on every return from an interrupt, exception or system call.
+ *								 If it is going back to user mode with a signal pending, it either
+ *								 takes the default action or points the return at the handler.
+ *   INPUTS: hw_context_t* ctx - what the entry saved, on the kernel stack
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: called with interrupts off. Default for DIV_ZERO, SEGFAULT and
+ *								 INTERRUPT is to halt; ALARM and USER1 are ignored. A handler
+ *								 gets a frame on the user stack: the return into the sigreturn
+ *								 trampoline, signum, a copy of ctx, then the trampoline itself.
+ *								 Nothing more is delivered until it calls sigreturn.
+ */
+void do_signal(hw_context_t* ctx){
+	pcb_t* pcb = get_pcb(current_pid);
+	pcb_t* leader;
+	uint32_t signum, handler, esp, tramp;
+
+	if(pcb == NULL || (ctx->cs & USER_PL) != USER_PL){
+		return;
+	}
+	if(pcb->exiting){
+		halt(AB_STATUS);	//out of the kernel, its program is going
+	}
+	if(pcb->sig_masked){
+		return;
+	}
+	leader = get_pcb(pcb->leader);
+	for(signum = 0; signum < NUM_SIGNALS; signum++){
+		if(!(pcb->sig_pending & (1 << signum))){
+			continue;
+		}
+		pcb->sig_pending &= ~(1 << signum);
+		if((handler = leader->sig_handlers[signum]) != 0){
+			break;
+		}
+		if(signum == SIG_DIV_ZERO || signum == SIG_SEGFAULT){
+			halt_exception();
+		}
+		if(signum == SIG_INTERRUPT){
+			halt(AB_STATUS);
+		}
+	}
+	if(signum == NUM_SIGNALS){
+		return;
+	}
+
+	esp = ctx->esp - SIGRETURN_CODE_SIZE;
+	tramp = esp;
+	esp -= sizeof(hw_context_t) + 2*sizeof(uint32_t);
+	if(!user_range(esp, ctx->esp)){
+		halt_exception();	//no stack to run the handler on
+	}
+	memcpy((void*)tramp, sigreturn_code, SIGRETURN_CODE_SIZE);
+	memcpy((void*)(esp + 2*sizeof(uint32_t)), ctx, sizeof(hw_context_t));
+	((uint32_t*)esp)[1] = signum;
+	((uint32_t*)esp)[0] = tramp;
+
+	ctx->esp = esp;
+	ctx->ret_addr = handler;
+	pcb->sig_masked = 1;
+}
+
+/*
+ * user_range
+ *   DESCRIPTION: Checks that [start, end) lies in the program's page
+ *   INPUTS: uint32_t start, end - user virtual addresses
+ *   OUTPUTS: int32_t
+ *   RETURN VALUE: 1 if it does, else 0
+ *   SIDE EFFECTS: NONE
+ */
+static int32_t user_range(uint32_t start, uint32_t end){
+	return start >= MB_128 && start <= end && end <= MB_128 + PROGRAM_SIZE;
+}
@@ -0,0 +1,94 @@
+/* signal.h - signals delivered to user programs on their way back from the kernel
+ */
+
+#ifndef _SIGNAL_H
+#define _SIGNAL_H
+
+#define SIG_DIV_ZERO		0	//same numbers as the signums enum user programs see
+#define SIG_SEGFAULT		1
+#define SIG_INTERRUPT		2
+#define SIG_ALARM			3
+#define SIG_USER1			4
+#define NUM_SIGNALS			5
+
+#define HW_CONTEXT_SIZE		68	//17 words, see hw_context_t
+#define HW_EAX				24	//offset of eax in hw_context_t
+#define HW_ECX				4
+#define HW_EDX				8
+#define HW_ESI				12
+#define HW_EBP				20
+#define HW_ERR				44
+#define HW_RET				48
+#define HW_ESP				60
+
+#ifdef ASM
+
+/* Fills in hw_context_t below the error code and vector the entry already pushed */
+.macro SAVE_ALL
+	pushl %fs
+	pushl %es
+	pushl %ds
+	pushl %eax
+	pushl %ebp
+	pushl %edi
+	pushl %esi
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+.endm
+
+/* Undoes SAVE_ALL, leaving the vector and error code on the stack */
+.macro RESTORE_ALL
+	popl %ebx
+	popl %ecx
+	popl %edx
+	popl %esi
+	popl %edi
+	popl %ebp
+	popl %eax
+	popl %ds
+	popl %es
+	popl %fs
+.endm
+
+#else
+
+#include "types.h"
+
+#define SIGRETURN_CODE_SIZE	8		//"movl $10,%eax; int $0x80", padded to a word
+#define ALARM_DEFAULT_MS	10000	//programs get ALARM this often until they call alarm
+#define USER_PL				3		//privilege level in the low bits of a user selector
+#define USER_EFLAGS			0xCD5	//CF PF AF ZF SF DF OF, the flags sigreturn lets a handler change
+
+/* What the kernel saved on entry, in the order the stubs push it. A copy sits on
+ * the user stack under a handler's signum, and sigreturn puts it back. */
+typedef struct hw_context{
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+	uint32_t esi;
+	uint32_t edi;
+	uint32_t ebp;
+	uint32_t eax;
+	uint32_t ds;
+	uint32_t es;
+	uint32_t fs;
+	uint32_t irq_num;	//vector it came in on
+	uint32_t err_code;	//0 unless the CPU pushed one
+	uint32_t ret_addr;	//from here on the CPU pushed it
+	uint32_t cs;
+	uint32_t eflags;
+	uint32_t esp;		//esp and ss only when it came from user mode
+	uint32_t ss;
+}hw_context_t;
+
+void raise_signal(uint32_t pid, uint32_t signum);
+void signal_foreground(uint32_t terminal);
+int32_t signal_interrupts(uint32_t pid);
+void alarm_tick(void);
+uint32_t alarm_ms_to_ticks(uint32_t ms);
+void do_signal(hw_context_t* ctx);
+
+#endif /* ASM */
+
+#endif
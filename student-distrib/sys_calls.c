@@ -13,11 +13,15 @@
 #include "term_switch.h"
 #include "types.h"
 #include "pit.h"
+#include "devfs.h"
+#include "pipe.h"
+#include "futex.h"
+#include "vdso.h"
+#include "poll.h"
 
-static uint32_t rtc_jumptable[ELF_SIZE] = { (uint32_t)&rtc_open,(uint32_t)&rtc_read,(uint32_t)&rtc_write,(uint32_t)&rtc_close};
-static uint32_t terminal_jumptable[ELF_SIZE] = {(uint32_t)&terminal_open,(uint32_t)&terminal_read,(uint32_t)&terminal_write,(uint32_t)&terminal_close};
-static uint32_t directory_jumptable[ELF_SIZE] = {(uint32_t)&open_d,(uint32_t)&read_d,(uint32_t)&write_d,(uint32_t)&close_d};
-static uint32_t file_jumptable[ELF_SIZE] = {(uint32_t)&open_f,(uint32_t)&read_f,(uint32_t)&write_f,(uint32_t)&close_f};
+//devices keep their own tables in the devfs registry
+static uint32_t directory_jumptable[FOPS_SIZE] = {(uint32_t)&open_d,(uint32_t)&read_d,(uint32_t)&write_d,(uint32_t)&close_d,(uint32_t)&poll_always};
+static uint32_t file_jumptable[FOPS_SIZE] = {(uint32_t)&open_f,(uint32_t)&read_f,(uint32_t)&write_f,(uint32_t)&close_f,(uint32_t)&poll_always};
 
 static int8_t elf_string[ELF_SIZE] = {ELF_0,ELF_1,ELF_2,ELF_3};
 
@@ -26,30 +30,306 @@ static uint32_t num_processes=0;
 //index 0 is skipped for our implementation, 1-6 will hold the base shell and command programs
 static pcb_t pcb_array[MAX_PROCESSES+1];
 
+uint32_t syscall_counts[NUM_SYS_CALLS];
+uint32_t syscall_hist[NUM_SYS_CALLS][SYS_HIST_BUCKETS];
+uint64_t syscall_cycles[NUM_SYS_CALLS];
+uint32_t current_pid;
+static uint32_t sysenter_ok;	//the CPU has SYSENTER and its MSRs are set
+
+//descriptors past a program's first FD_CHUNK, handed out a chunk at a time
+static file_entry_t fd_pool[FD_POOL_CHUNKS][FD_CHUNK];
+static uint32_t fd_pool_free = (1 << FD_POOL_CHUNKS) - 1;	//a bit per free chunk
+
+static void fd_release(int32_t fd);
+static void fd_copy(file_entry_t* dst, const file_entry_t* src);
+static file_entry_t* fd_slot(uint32_t leader, int32_t fd);
+static file_entry_t* fd_lookup(int32_t fd);
+static void fd_table_init(uint32_t pid);
+static void fd_table_free(uint32_t pid);
+static int32_t fd_grow(uint32_t leader);
+static int32_t fd_alloc(uint32_t leader);
+static void fd_put(uint32_t leader, int32_t fd);
+static void fd_inherit(uint32_t pid, int32_t in_fd, int32_t out_fd);
+static void orphan_children(uint32_t pid);
+static int32_t wait_child(int32_t pid, int32_t* status, int32_t flags);
+static void kill_threads(uint32_t leader);
+static void wake_threads(uint32_t leader);
+static int32_t end_process(uint32_t ret_val);
+
+/*
+ *	fd_slot
+ *
+ *	INPUTS: uint32_t leader - program whose table it is
+ *			int32_t fd - file descriptor
+ *	OUTPUTS: none
+ *	RETURN VALUE: the descriptor's entry, open or not, or NULL if the table has not grown that far
+ *	SIDE EFFECTS: none
+ */
+static file_entry_t* fd_slot(uint32_t leader, int32_t fd)
+{
+	pcb_t* pcb = &pcb_array[leader];
+	uint32_t chunk;
+
+	if (fd < 0 || fd > MAX_FILES-1) return NULL;
+	if (fd < FD_CHUNK) return &pcb->fd_array[fd];
+	if ((chunk = pcb->fd_chunks[fd/FD_CHUNK - 1]) == FD_NO_CHUNK) return NULL;
+	return &fd_pool[chunk][fd % FD_CHUNK];
+}
+
+/*
+ *	fd_lookup
+ *
+ *	INPUTS: int32_t fd - file descriptor
+ *	OUTPUTS: none
+ *	RETURN VALUE: the running thread's entry for fd, which belongs to its program's first
+ *				  thread, or NULL if fd is not open
+ *	SIDE EFFECTS: none
+ */
+static file_entry_t* fd_lookup(int32_t fd)
+{
+	file_entry_t* f = fd_slot(pcb_array[current_pid].leader, fd);
+	return (f == NULL || f->flags == NOT_IN_USE_FLAG) ? NULL : f;
+}
+
+/*
+ *	fd_table_init
+ *
+ *	INPUTS: uint32_t pid - a new program
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: leaves it FD_CHUNK descriptors, all free
+ */
+static void fd_table_init(uint32_t pid)
+{
+	int i;
+	for (i = 0; i < FD_CHUNK; i++) {
+		pcb_array[pid].fd_array[i].flags = NOT_IN_USE_FLAG;
+	}
+	for (i = 0; i < FD_CHUNKS; i++) {
+		pcb_array[pid].fd_chunks[i] = FD_NO_CHUNK;
+	}
+	pcb_array[pid].fd_free = FD_CHUNK_BITS;
+}
+
+/*
+ *	fd_table_free
+ *
+ *	INPUTS: uint32_t pid - a halting program, its descriptors already closed
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: gives the chunks it grew into back to the pool
+ */
+static void fd_table_free(uint32_t pid)
+{
+	uint32_t flags;
+	int i;
+	cli_and_save(flags);
+	for (i = 0; i < FD_CHUNKS; i++) {
+		if (pcb_array[pid].fd_chunks[i] != FD_NO_CHUNK)
+			fd_pool_free |= 1 << pcb_array[pid].fd_chunks[i];
+		pcb_array[pid].fd_chunks[i] = FD_NO_CHUNK;
+	}
+	pcb_array[pid].fd_free = 0;
+	restore_flags(flags);
+}
+
+/*
+ *	fd_grow
+ *
+ *	INPUTS: uint32_t leader - program whose table it is
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 for success, -1 if the table is at MAX_FILES or the pool is empty
+ *	SIDE EFFECTS: adds FD_CHUNK free descriptors past the current end
+ */
+static int32_t fd_grow(uint32_t leader)
+{
+	pcb_t* pcb = &pcb_array[leader];
+	uint32_t c, chunk, flags;
+	int i;
+
+	for (c = 0; c < FD_CHUNKS && pcb->fd_chunks[c] != FD_NO_CHUNK; c++);
+	if (c == FD_CHUNKS) return -1;
+
+	cli_and_save(flags);
+	if (fd_pool_free == 0) {
+		restore_flags(flags);
+		return -1;
+	}
+	chunk = bsf(fd_pool_free);
+	fd_pool_free &= ~(1 << chunk);
+	restore_flags(flags);
+
+	for (i = 0; i < FD_CHUNK; i++) {
+		fd_pool[chunk][i].flags = NOT_IN_USE_FLAG;
+	}
+	pcb->fd_chunks[c] = chunk;
+	pcb->fd_free |= FD_CHUNK_BITS << ((c+1)*FD_CHUNK);
+	return 0;
+}
+
+/*
+ *	fd_alloc
+ *
+ *	INPUTS: uint32_t leader - program whose table it is
+ *	OUTPUTS: none
+ *	RETURN VALUE: the lowest free descriptor, or -1 if there is none and the table cannot grow
+ *	SIDE EFFECTS: takes it out of fd_free, the caller fills in the entry
+ */
+static int32_t fd_alloc(uint32_t leader)
+{
+	pcb_t* pcb = &pcb_array[leader];
+	uint32_t flags;
+	int32_t fd;
+
+	//the program's threads share the table
+	cli_and_save(flags);
+	if (pcb->fd_free == 0 && fd_grow(leader) == -1) {
+		restore_flags(flags);
+		return -1;
+	}
+	fd = bsf(pcb->fd_free);
+	pcb->fd_free &= ~(1 << fd);
+	restore_flags(flags);
+	return fd;
+}
+
+/*
+ *	fd_put
+ *
+ *	INPUTS: uint32_t leader - program whose table it is
+ *			int32_t fd - descriptor from fd_alloc, or one that was just closed
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: marks it free for the next fd_alloc
+ */
+static void fd_put(uint32_t leader, int32_t fd)
+{
+	uint32_t flags;
+	cli_and_save(flags);
+	fd_slot(leader, fd)->flags = NOT_IN_USE_FLAG;
+	pcb_array[leader].fd_free |= 1 << fd;
+	restore_flags(flags);
+}
+
+/*
+ *	fd_inherit
+ *
+ *	INPUTS: uint32_t pid - a new program started by the running one
+ *			int32_t in_fd - open descriptor it gets as stdin
+ *			int32_t out_fd - open descriptor it gets as stdout
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: every other descriptor without FD_CLOEXEC is copied under the same number.
+ *				  One that does not fit because the pool is empty is left closed
+ */
+static void fd_inherit(uint32_t pid, int32_t in_fd, int32_t out_fd)
+{
+	uint32_t leader = pcb_array[current_pid].leader;
+	file_entry_t* src;
+	file_entry_t* dst;
+	int32_t fd;
+
+	fd_table_init(pid);
+	for (fd = 0; fd < MAX_FILES; fd++) {
+		if (fd == 0 || fd == 1) {
+			src = fd_slot(leader, fd == 0 ? in_fd : out_fd);
+		} else {
+			if ((src = fd_slot(leader, fd)) == NULL) break;	//past the end of its table
+			if (src->flags == NOT_IN_USE_FLAG || (src->fd_flags & FD_CLOEXEC)) continue;
+		}
+		while ((dst = fd_slot(pid, fd)) == NULL) {
+			if (fd_grow(pid) == -1) return;
+		}
+		fd_copy(dst, src);
+		dst->fd_flags = 0;
+		pcb_array[pid].fd_free &= ~(1 << fd);
+	}
+}
+
 
 /*
  *	halt 
  *
- *	INPUTS: uint8_t status - the number corresponding to how halt was called
+ *	INPUTS: uint8_t status - what the program passed, handed back as is
  *	OUTPUTS: none
- *	RETURN VALUE: technically returns for execute
- *	SIDE EFFECTS: program is removed from PCB array
+ *	RETURN VALUE: none, the CPU goes to the parent or the next runnable process
+ *	SIDE EFFECTS: as for end_process
  */
 int32_t halt (uint8_t status){
+	return end_process(status);
+}
+
+/*
+ *	halt_exception
+ *
+ *	INPUTS: none
+ *	OUTPUTS: none
+ *	RETURN VALUE: none, the CPU goes to the parent or the next runnable process
+ *	SIDE EFFECTS: ends a program the kernel stops for a fault, which is the only
+ *				  way to the EXCEPTION status; no byte passed to halt can look like it
+ */
+int32_t halt_exception (void){
+	return end_process(EXCEPTION);
+}
+
+/*
+ *	end_process
+ *
+ *	INPUTS: uint32_t ret_val - for execute, waitpid or thread_join: a halt byte, or EXCEPTION
+ *	OUTPUTS: none
+ *	RETURN VALUE: none, the CPU goes to the parent or the next runnable process
+ *	SIDE EFFECTS: program is left as a zombie until its parent collects the exit status,
+ *				  or removed from the PCB array if it has no parent. A thread other than
+ *				  the first is left for thread_join, and the first takes the others with it
+ */
+static int32_t end_process (uint32_t ret_val){
 
+	pcb_t* pcb = &pcb_array[current_pid];
+
+	// a thread ends alone, the page and files stay with its program
+	if (pcb->leader != current_pid)
+	{
+		orphan_children(current_pid);
+		cli();
+		pcb->state = PROC_ZOMBIE;
+		pcb->exit_status = ret_val;
+		wake_threads(pcb->leader);
+		schedule();
+		while(1);	//never picked again
+	}
+
+	// the program's other threads go with it
+	uint32_t flags;
+	cli_and_save(flags);
+	kill_threads(current_pid);
+	restore_flags(flags);
+
+	// a background program does not own the line being typed
 	int j;
-	for (j = 0; j<LINE_BUFFER_SIZE; j++) {
-		terminal_array[PIT_terminal].keyboard[j] = '\0';
+	if (!pcb->background) {
+		for (j = 0; j<LINE_BUFFER_SIZE; j++) {
+			terminal_array[PIT_terminal].keyboard[j] = '\0';
+		}
+		terminal_array[PIT_terminal].buf_count = 0;
+	}
+
+	// close the program's files, stdin and stdout too, so pipe ends it held are dropped
+	int i;
+	for (i = 0; i < MAX_FILES; i++) {
+		if (fd_lookup(i) != NULL)
+			fd_release(i);
 	}
-	terminal_array[PIT_terminal].buf_count = 0;
+	fd_table_free(current_pid);
+
+	// nobody is left to wait for its children
+	orphan_children(current_pid);
 
-    if(terminal_array[PIT_terminal].curr_pid==1 ||terminal_array[PIT_terminal].curr_pid==2|| terminal_array[PIT_terminal].curr_pid==3)
+    if(current_pid==1 ||current_pid==2|| current_pid==3)
     {
         num_processes--;
-        pcb_array[terminal_array[PIT_terminal].curr_pid].in_use_flag = NOT_IN_USE_FLAG;
-        //terminal_array[PIT_terminal].curr_pid = pcb_array[terminal_array[PIT_terminal].curr_pid].parent_pid;
-        uint32_t kernel_stack_bottom = MB_8 - terminal_array[PIT_terminal].curr_pid*KB_8;
-        if(terminal_array[PIT_terminal].curr_pid != PIT_terminal)
+        pcb_array[current_pid].in_use_flag = NOT_IN_USE_FLAG;
+        uint32_t kernel_stack_bottom = MB_8 - current_pid*KB_8;
+        if(current_pid != pcb->terminal)
         {
             while(1)
             {
@@ -66,83 +346,43 @@ int32_t halt (uint8_t status){
         execute((const uint8_t*)"shell");
 
     }
-	
-	// clear out the fd_array associated with the program being halted
-	int i;
-	for (i = FILE_TYPE_2; i < MAX_FILES; i++) {
-		close(i);
-	}
-
-	// write parent process back info to tss.esp0
-	//tss.esp0 = pcb_array[current_pid].parent_kernel_esp;
-	
-	// set the in_use_flag of the pcb we're going to leave to NOT_IN_USE
-	pcb_array[terminal_array[PIT_terminal].curr_pid].in_use_flag = NOT_IN_USE_FLAG;
-	
-	// get new pid after halt is done
-	uint32_t old_pid = terminal_array[PIT_terminal].curr_pid;
-	uint32_t new_pid = pcb_array[terminal_array[PIT_terminal].curr_pid].parent_pid;
-	terminal_array[PIT_terminal].curr_pid = new_pid;
 
-	// decrement number of processes
-	num_processes--;
-	
-	//set tss.esp0 back to original address
-    tss.esp0 = MB_8 - new_pid*KB_8;
-    //printf("\nhalt1: %x %x %x\n",tss.esp0,current_pid,pcb_array[current_pid].parent_kernel_esp);
-	
-	// restore paging
-	remap_page(new_pid);
-
-	// set the return value for execute
-	uint32_t ret_val;
-	if (status == 0)
-		ret_val = 0;
-	else if (status == EX_STATUS)
-		ret_val = EXCEPTION;
-	else
-		ret_val = ABNORMAL;
-    
-    //printf("\nhalt2: %x %x %x\n",tss.esp0,current_pid,pcb_array[current_pid].parent_kernel_esp);
-	// move parent esp and ebp values back into esp/ebp registers
-    asm volatile(
-		"movl %0, %%eax;"
-		"movl %1,%%esp;"
-		"movl %2, %%ebp;"
-		"jmp after_iret"
-        : 
-        : "r"(ret_val),"r"(pcb_array[old_pid].parent_kernel_esp), "r"(pcb_array[old_pid].parent_kernel_ebp)
-        : "memory");
+	// the PCB stays as a zombie until the parent collects the status
+	cli();
+	pcb_t* parent = get_pcb(pcb->parent_pid);
+	if (parent != NULL) {
+		pcb->state = PROC_ZOMBIE;
+		pcb->exit_status = ret_val;
+		// a parent in execute or waitpid gets the CPU straight back
+		if (parent->state == PROC_WAITING) {
+			parent->state = PROC_RUNNING;
+			switch_to(pcb->parent_pid);
+		}
+	}
+	else {
+		pcb->in_use_flag = NOT_IN_USE_FLAG;
+		num_processes--;
+	}
+	schedule();
+	while(1);	//never picked again
 
 	return 0;
 }
 
 /*
- *	execute 
+ *	parse_command
  *
- *	INPUTS: const uint8_t* command - a string specifying a program
+ *	INPUTS: const uint8_t* command - a string specifying a program and its arguments
+ *			uint8_t* exe - LINE_BUFFER_SIZE buffer for the program name
  *	OUTPUTS: none
- *	RETURN VALUE: the execute call returns -1 if the command cannot be executed,
- *  for example, if the program does not exist or the filename specified is not an executable, 256 if the program dies by an
- *  exception, or a value in the range 0 to 255 if the program executes a halt system call, in which case the value returned
- *  is that given by the program's call to halt.
- *	SIDE EFFECTS: program is added to PCB array
+ *	RETURN VALUE: index of the arguments in command
+ *	SIDE EFFECTS: none
  */
-int32_t execute (const uint8_t* command)
+static int32_t parse_command (const uint8_t* command, uint8_t* exe)
 {
-	//check if command pointer is NULL
-	if(command == NULL) return -1;
-
-
-	//check if the max number of processes are running
-	if (num_processes == MAX_PROCESSES) {
-		printf("Max number of processes reached \n");
-		return 0;
-	}
-
 	// parse the execute command from the original buffer
     // '\0', ' ', '\n'
-    uint8_t exe[LINE_BUFFER_SIZE];exe[0] = '\0';
+    exe[0] = '\0';
     int i=0; 
 	while (i<LINE_BUFFER_SIZE && command[i] == ' ') {
 		i++;
@@ -155,26 +395,52 @@ int32_t execute (const uint8_t* command)
 		i++;
     }
     exe[k]='\0';
-	if (exe[0] == '\n' || exe[0]=='\0') return 0;
 
 	// move through the rest of the spaces that occur after the command
 	while(i<LINE_BUFFER_SIZE && command[i]==' ')
 	{
 		i++;
 	}
+	return i;
+}
 
-    dentry_t test;
+/*
+ *	check_program
+ *
+ *	INPUTS: const uint8_t* exe - program name
+ *			dentry_t* test - filled in with the program's entry
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 if it can run, -1 if it does not exist, AB_STATUS if it is not an executable
+ *	SIDE EFFECTS: none
+ */
+static int32_t check_program (const uint8_t* exe, dentry_t* test)
+{
     int8_t buf[ELF_SIZE];
-    int32_t file_size;
     //check if file exists
-    if(read_dentry_by_name(exe,&test)==-1) return -1;
+    if(read_dentry_by_name(exe,test)==-1) return -1;
 	//check if the filetype is a file
-    if(test.filetype != FILE_TYPE_2) return AB_STATUS;
+    if(test->filetype != FILE_TYPE_2) return AB_STATUS;
     //check if the first 4 bytes are ELF magic number
-    file_size = read_data(test.inode_num,0,(uint8_t*) buf,ELF_SIZE);
+    read_data(test->inode_num,0,(uint8_t*) buf,ELF_SIZE);
     if(strncmp(buf,elf_string,ELF_SIZE)!=0) return AB_STATUS;
+    return 0;
+}
 
-
+/*
+ *	new_process
+ *
+ *	INPUTS: const uint8_t* exe - program name
+ *			const uint8_t* args - its arguments
+ *			dentry_t* test - the program's entry, checked by check_program
+ *			int32_t in_fd - caller's open descriptor the program gets as stdin
+ *			int32_t out_fd - caller's open descriptor the program gets as stdout
+ *	OUTPUTS: none
+ *	RETURN VALUE: the new pid
+ *	SIDE EFFECTS: takes a PCB and loads the program into its page, which is left mapped;
+ *				  the child is left PROC_WAITING for the caller to start
+ */
+static uint32_t new_process (const uint8_t* exe, const uint8_t* args, dentry_t* test, int32_t in_fd, int32_t out_fd)
+{
 	//assign pid
 	uint32_t new_pid = 1;
 	while (pcb_array[new_pid].in_use_flag != NOT_IN_USE_FLAG) {
@@ -184,79 +450,127 @@ int32_t execute (const uint8_t* command)
 
 	//increment number of processes
 	num_processes++;
-  
-	//uint8_t* te = (uint8_t*)0x08048000;
-	//uint32_t blah = *te;
 
     int j=0;
     //save args for getargs 
-    if (command[i]=='\0' || command[i]=='\n') 
+    while(j<LINE_BUFFER_SIZE-1 && args[j]!='\0' && args[j]!= '\n')
     {
-        pcb_array[new_pid].args[j] ='\0';
-    }
-    else
-    {
-        while(i<LINE_BUFFER_SIZE && command[i]!='\0' && command[i]!= '\n')
-        {
-            pcb_array[new_pid].args[j] =command[i];
-            i++;j++;
-        }
-        pcb_array[new_pid].args[j] ='\0';
+        pcb_array[new_pid].args[j] =args[j];
+        j++;
     }
+    pcb_array[new_pid].args[j] ='\0';
 
+    //name and counters for /proc
+    strncpy((int8_t*)pcb_array[new_pid].name, (int8_t*)exe, FILENAME_LEN);
+    pcb_array[new_pid].name[FILENAME_LEN] = '\0';
+    pcb_array[new_pid].ticks = 0;
+    pcb_array[new_pid].syscalls = 0;
+    memset(pcb_array[new_pid].sys_hist, 0, sizeof(pcb_array[new_pid].sys_hist));
+    memset(pcb_array[new_pid].sys_cycles, 0, sizeof(pcb_array[new_pid].sys_cycles));
+    pcb_array[new_pid].terminal = PIT_terminal;
+    pcb_array[new_pid].state = PROC_WAITING;	//not runnable until the caller has finished it
+    pcb_array[new_pid].entry = 0;
+    pcb_array[new_pid].background = 0;
+    pcb_array[new_pid].leader = new_pid;
+    pcb_array[new_pid].page = new_pid;
+    pcb_array[new_pid].user_esp = PROGRAM_VIRTUAL_END;
+    pcb_array[new_pid].futex_key = 0;
+    pcb_array[new_pid].poll_sleeping = 0;
+    pcb_array[new_pid].sig_pending = 0;
+    pcb_array[new_pid].sig_masked = 0;
+    pcb_array[new_pid].exiting = 0;
+    memset(pcb_array[new_pid].sig_handlers, 0, sizeof(pcb_array[new_pid].sig_handlers));
+    pcb_array[new_pid].alarm_period = alarm_ms_to_ticks(ALARM_DEFAULT_MS);
+    pcb_array[new_pid].alarm_left = pcb_array[new_pid].alarm_period;
 
-    //assign memory for the process
+    //assign memory for the process; a read that sleeps on the disk can switch away
+    //and back, so the caller records the page to come back to
+    pcb_array[current_pid].page = new_pid;
     remap_page(new_pid);
 
     //copy program into memory
-    read_data(test.inode_num,0,(uint8_t*)PROGRAM_VIRTUAL_ADDRESS,PROGRAM_SIZE);
+    read_data(test->inode_num,0,(uint8_t*)PROGRAM_VIRTUAL_ADDRESS,PROGRAM_SIZE);
 
-    //Initialize PCB values and stdin/out file descriptors
-    init_STD(new_pid);
+    //a base shell starts on its terminal, any other program gets copies of its caller's descriptors
+    if(new_pid <= TERM_3)
+        init_STD(new_pid);
+    else
+        fd_inherit(new_pid, in_fd, out_fd);
 
+    return new_pid;
+}
 
-    if( new_pid >= 1 && new_pid <= 3 )
-    {
-        pcb_array[new_pid].parent_pid = 0;
-    }
-    else
-    {
-        pcb_array[new_pid].parent_pid = terminal_array[PIT_terminal].curr_pid;
-    }
-    
+/*
+ *	execute 
+ *
+ *	INPUTS: const uint8_t* command - a string specifying a program
+ *	OUTPUTS: none
+ *	RETURN VALUE: the execute call returns -1 if the command cannot be executed,
+ *  for example, if the program does not exist or the filename specified is not an executable, 256 if the program dies by an
+ *  exception, or a value in the range 0 to 255 if the program executes a halt system call, in which case the value returned
+ *  is that given by the program's call to halt.
+ *	SIDE EFFECTS: program is added to PCB array
+ */
+int32_t execute (const uint8_t* command)
+{
+	//check if command pointer is NULL
+	if(command == NULL) return -1;
 
-	//save parent esp and ebp values
-    asm volatile("movl %%esp,%%eax;"
-        : "=a"(pcb_array[new_pid].parent_kernel_esp)
-        :
-        : "memory");
-    asm volatile("movl %%ebp,%%eax;" 
-    : "=a"(pcb_array[new_pid].parent_kernel_ebp)
-    :
-    : "memory");
 
-	//set tss values
-    tss.esp0 = MB_8 - new_pid*KB_8;
-	tss.ss0 = KERNEL_DS;
-    //printf("\nexecute1: %x %x %x\n",tss.esp0,new_pid,pcb_array[new_pid].parent_kernel_esp);
+	//check if the max number of processes are running
+	if (num_processes == MAX_PROCESSES) {
+		printf("Max number of processes reached \n");
+		return 0;
+	}
+
+    uint8_t exe[LINE_BUFFER_SIZE];
+    int32_t i = parse_command(command, exe);
+	if (exe[0] == '\n' || exe[0]=='\0') return 0;
+
+    dentry_t test;
+    int32_t rval;
+    if((rval = check_program(exe, &test)) != 0) return rval;
+
+	//interrupts stay off from here until the child runs, except while a read sleeps
+	uint32_t flags;
+	cli_and_save(flags);
+	uint32_t new_pid = new_process(exe, command + i, &test, 0, 1);
 
     //get entry point
 	uint32_t entry;
 	read_data(test.inode_num,INDEX_24,(uint8_t*)&entry,ELF_SIZE);
 
-	uint32_t user_ds = USER_DS; //store USER_DS in a variable
-	uint32_t user_cs = USER_CS; //store USER_CS in a variable
-	uint32_t iret_esp = PROGRAM_VIRTUAL_END; //store the IRET esp in a variable
+    if( new_pid >= 1 && new_pid <= 3 )
+    {
+		//a base shell has no parent, it takes over the stack it was started on
+        pcb_array[new_pid].parent_pid = 0;
 
-	//update the current terminal pid
-	terminal_array[PIT_terminal].curr_pid = new_pid;
+		//set tss values
+		set_kernel_stack(new_pid);
+		tss.ss0 = KERNEL_DS;
 
-	//next is context switching, so close interrupts
-	cli();
-    //printf("\nexecute2: %x %x %x\n",tss.esp0,new_pid,pcb_array[current_pid].parent_kernel_esp);
-	context_switch(user_ds, iret_esp, user_cs, entry);
+		uint32_t user_ds = USER_DS; //store USER_DS in a variable
+		uint32_t user_cs = USER_CS; //store USER_CS in a variable
+		uint32_t iret_esp = PROGRAM_VIRTUAL_END; //store the IRET esp in a variable
 
-    return 0;
+		pcb_array[new_pid].state = PROC_RUNNING;
+		current_pid = new_pid;
+		vdso_switch(new_pid);
+		context_switch(user_ds, iret_esp, user_cs, entry);
+    }
+
+	//any other program is a child the caller waits for, it gets the CPU at once
+	pcb_array[new_pid].parent_pid = current_pid;
+	pcb_array[new_pid].entry = entry;
+	pcb_array[new_pid].state = PROC_RUNNING;
+	pcb_array[current_pid].page = pcb_array[current_pid].leader;
+	pcb_array[current_pid].state = PROC_WAITING;
+	switch_to(new_pid);
+
+	// a signal gets the caller up too, the child is then collected by waitpid or when it halts
+	if (wait_child(new_pid, &rval, 0) == -1) rval = -1;
+	restore_flags(flags);
+    return rval;
 }
 
 /*
@@ -285,23 +599,22 @@ void init_pcb_array()
  */
 void init_STD(uint32_t pid)
 {
+	fd_table_init(pid);
+
 	// set stdin
-    pcb_array[pid].fd_array[0].fops = (uint32_t)terminal_jumptable;
+    pcb_array[pid].fd_array[0].fops = (uint32_t)terminal_fops;
     pcb_array[pid].fd_array[0].inode =0;
     pcb_array[pid].fd_array[0].fp =0;
     pcb_array[pid].fd_array[0].flags =IN_USE_FLAG;
 
 	// set stdout
-    pcb_array[pid].fd_array[1].fops = (uint32_t)terminal_jumptable;
+    pcb_array[pid].fd_array[1].fops = (uint32_t)terminal_fops;
     pcb_array[pid].fd_array[1].inode =0;
     pcb_array[pid].fd_array[1].fp =0;
     pcb_array[pid].fd_array[1].flags =IN_USE_FLAG;
-
-	// set all other file descriptors as not in use
-	int i;
-	for (i = FILE_TYPE_2; i < MAX_FILES; i++) {
-		pcb_array[pid].fd_array[i].flags = NOT_IN_USE_FLAG;
-	}
+    pcb_array[pid].fd_array[0].fd_flags = 0;
+    pcb_array[pid].fd_array[1].fd_flags = 0;
+    pcb_array[pid].fd_free &= ~((1 << 0) | (1 << 1));
 }
 
 /*
@@ -317,19 +630,100 @@ void init_STD(uint32_t pid)
 int32_t read (int32_t fd, void* buf, int32_t nbytes)
 {
     //check if file descriptor is in bounds and if the flag is IN_USE
-    if(fd > MAX_FILES-1 || fd < 0) return -1;
-	if(pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].flags == NOT_IN_USE_FLAG) return -1;
+    file_entry_t* f = fd_lookup(fd);
+    if(f == NULL) return -1;
 	
 	//if the fd called is stdout, return -1
 	if(fd==1) return -1;
  
 	//jump to the corresponding read function
-    uint32_t* ptr = (uint32_t*)pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fops; 
+    uint32_t* ptr = (uint32_t*)f->fops; 
     int32_t (*fun_ptr)(int32_t, void*, int32_t) = (void*)ptr[1];
     return (*fun_ptr)(fd,buf,nbytes);
 }
 
 
+/*
+ *	get_pcb
+ *
+ *	INPUTS: uint32_t pid - the processor ID of the PCB
+ *	OUTPUTS: none
+ *	RETURN VALUE: the process's PCB, NULL if the pid is out of range or not running
+ *	SIDE EFFECTS: none
+ */
+pcb_t* get_pcb(uint32_t pid){
+	if (pid < 1 || pid > MAX_PROCESSES || pcb_array[pid].in_use_flag != IN_USE_FLAG) return NULL;
+	return &pcb_array[pid];
+}
+
+/*
+ *	sysenter_init
+ *
+ *	INPUTS: none
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: points the SYSENTER MSRs at sysenter_handler when CPUID says the CPU
+ *				  has it. SYSEXIT takes USER_CS and USER_DS from KERNEL_CS, so the GDT
+ *				  order is what makes this work. The stack MSR follows each task.
+ */
+void sysenter_init(void)
+{
+	uint32_t signature;
+	if (!(cpuid_features(&signature) & CPUID_SEP) || CPUID_SEP_BROKEN(signature)) return;
+	wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+	wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_handler);
+	sysenter_ok = 1;
+	set_kernel_stack(current_pid);
+}
+
+/*
+ *	set_kernel_stack
+ *
+ *	INPUTS: uint32_t pid - process or thread about to run
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: both int $0x80 and SYSENTER land on the top of its kernel stack
+ */
+void set_kernel_stack(uint32_t pid)
+{
+	tss.esp0 = MB_8 - pid*KB_8;
+	if (sysenter_ok) wrmsr(MSR_SYSENTER_ESP, tss.esp0);
+}
+
+/*
+ *	syscall_enter
+ *
+ *	INPUTS: uint32_t num - system call number, already checked by sys_call_handler
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: counts the call for the system and for the calling process
+ */
+void syscall_enter(uint32_t num){
+	syscall_counts[num]++;
+	pcb_array[current_pid].syscalls++;
+}
+
+/*
+ *	syscall_exit
+ *
+ *	INPUTS: uint64_t start - time-stamp counter when sys_call_handler took the call
+ *			uint32_t num - system call number
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: adds the cycles it took, sleeping included, to the system's
+ *				  histogram and to its process's. halt never returns, so it is
+ *				  never timed
+ */
+void syscall_exit(uint64_t start, uint32_t num){
+	uint64_t cycles = rdtsc() - start;
+	uint32_t bucket = (cycles >> 32) ? SYS_HIST_BUCKETS-1 : bsr((uint32_t)cycles);
+	pcb_t* leader = &pcb_array[pcb_array[current_pid].leader];
+	syscall_hist[num][bucket]++;
+	syscall_cycles[num] += cycles;
+	leader->sys_hist[num][bucket]++;
+	leader->sys_cycles[num] += cycles;
+}
+
 /*
  *	get_flags
  *
@@ -339,7 +733,7 @@ int32_t read (int32_t fd, void* buf, int32_t nbytes)
  *	SIDE EFFECTS: none
  */
 uint32_t get_flags(int32_t fd){
-	return pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].flags;
+	return fd_slot(pcb_array[current_pid].leader, fd)->flags;
 }
 /*
  *	get_inode
@@ -350,7 +744,19 @@ uint32_t get_flags(int32_t fd){
  *	SIDE EFFECTS: none
  */
 uint32_t get_inode(int32_t fd){
-	return pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].inode;
+	return fd_slot(pcb_array[current_pid].leader, fd)->inode;
+}
+/*
+ *	get_fops
+ *
+ *	INPUTS: int32_t fd - file descriptor
+ *	OUTPUTS: none
+ *	RETURN VALUE: fops table of specified fd, NULL if it is not open
+ *	SIDE EFFECTS: none
+ */
+uint32_t* get_fops(int32_t fd){
+	file_entry_t* f = fd_lookup(fd);
+	return f == NULL ? NULL : (uint32_t*)f->fops;
 }
 /*
  *	get_fp
@@ -361,7 +767,7 @@ uint32_t get_inode(int32_t fd){
  *	SIDE EFFECTS: none
  */
 uint32_t get_fp(int32_t fd){
-	return pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fp;
+	return fd_slot(pcb_array[current_pid].leader, fd)->fp;
 }
 /*
  *	set_fp
@@ -372,7 +778,7 @@ uint32_t get_fp(int32_t fd){
  *	SIDE EFFECTS: changes fp of specified fd
  */
 void set_fp(int32_t fd,uint32_t fp){
-	pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fp = fp;
+	fd_slot(pcb_array[current_pid].leader, fd)->fp = fp;
 }
 /*
  *	clear_fp
@@ -383,7 +789,7 @@ void set_fp(int32_t fd,uint32_t fp){
  *	SIDE EFFECTS: clears fp of specified fd
  */
 void clear_fp(int32_t fd){
-	pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fp = 0;
+	fd_slot(pcb_array[current_pid].leader, fd)->fp = 0;
 	return;
 }
 /*
@@ -395,7 +801,7 @@ void clear_fp(int32_t fd){
  *	SIDE EFFECTS: increment fp of specified fd
  */
 void fp_plus(int32_t fd){
-	pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fp++;
+	fd_slot(pcb_array[current_pid].leader, fd)->fp++;
 	return;
 }
 
@@ -412,83 +818,113 @@ void fp_plus(int32_t fd){
 int32_t write (int32_t fd, const void* buf, int32_t nbytes)
 {
     //check if file descriptor is in bounds and if the flag is IN_USE
-    if(fd > MAX_FILES-1 || fd < 0) return -1;
-	if(pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].flags == NOT_IN_USE_FLAG) return -1;
+    file_entry_t* f = fd_lookup(fd);
+    if(f == NULL) return -1;
 	
 	//if the fd called is stin, return -1
 	if(fd==0) return -1;
  
 	//jump to the corresponding write function
-    uint32_t* ptr = (uint32_t*)pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].fops; 
+    uint32_t* ptr = (uint32_t*)f->fops; 
     int32_t (*fun_ptr)(int32_t, const void*, int32_t) = (void*)ptr[FILE_TYPE_2];
     return (*fun_ptr)(fd,buf,nbytes);
 }
 
+/*
+ *	user_string
+ *
+ *	INPUTS: const uint8_t* s - string a program passed in
+ *			uint32_t max - most bytes the kernel will read of it
+ *	OUTPUTS: none
+ *	RETURN VALUE: 1 if every byte up to its NUL, or max bytes if that comes first,
+ *				  is in the program's page, else 0
+ *	SIDE EFFECTS: none
+ */
+int32_t user_string (const uint8_t* s, uint32_t max)
+{
+	uint32_t i, addr = (uint32_t)s;
+
+	if (addr < MB_128 || addr >= MB_128 + PROGRAM_SIZE) return 0;
+	for (i = 0; i < max && s[i] != '\0'; i++) {
+		if (addr + i + 1 == MB_128 + PROGRAM_SIZE) return 0;	//runs off the page
+	}
+	return 1;
+}
+
 /*
  *	open
  *
  *	INPUTS: const uint8_t* filename - pointer to file name
  *	OUTPUTS: none
  *	RETURN VALUE: file descriptor value
- *				  If the named file does not exist or no descriptors are free, the call returns -1.
- *	SIDE EFFECTS: runs the open command based on the file type
+ *				  If the named file does not exist, the name is not in the program's page
+ *				  or no descriptors are free, the call returns -1.
+ *	SIDE EFFECTS: runs the open command based on the file type. /dev names go straight to
+ *				  the devfs registry, and device entries in the image are looked up there by name
  */
 int32_t open (const uint8_t* filename)
 {
     dentry_t test;
-    //check if file exists
-    if(read_dentry_by_name(filename,&test)==-1) return -1;
-    //get an unused file descriptor
-    uint32_t unusedfd = FILE_TYPE_2;
-    for(unusedfd = FILE_TYPE_2; unusedfd<=MAX_FILES; unusedfd++)
+    const uint8_t* devname;
+    uint32_t* fops;
+    int32_t dev = -1;
+    //the name is a path, no longer than a command line
+    if(!user_string(filename, LINE_BUFFER_SIZE)) return -1;
+    devname = devfs_path(filename);
+    if(devname != NULL)
     {
-       if(unusedfd==MAX_FILES) return -1;	//if all file descriptors are in use, return -1
-       if(pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].flags == NOT_IN_USE_FLAG)
-            break;
+        //a device, the image is never searched
+        if((dev = devfs_find(devname)) == -1) return -1;
+        test.filetype = 0;
     }
-
-	//set the file descriptor values based on file type
+    //check if file exists
+    else if(read_dentry_by_name(filename,&test)==-1) return -1;
+	//find the driver based on file type
+    uint32_t inode;
     switch(test.filetype)
     {
-        case 0://rtc
+        case 0://device, an image entry names the driver it stands for
         {
-
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fops = (uint32_t)rtc_jumptable;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].inode = 0;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fp = 0;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].flags = IN_USE_FLAG;
+            if(dev == -1 && (dev = devfs_find((const uint8_t*)test.filename)) == -1) return -1;
+            if((fops = devfs_fops(dev)) == NULL) return -1;
+            inode = dev;	//device number
             break;
         }
         case 1://directory
         {
-
-
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fops = (uint32_t)directory_jumptable;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].inode = 0;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fp = 0;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].flags = IN_USE_FLAG;
+            fops = directory_jumptable;
+            inode = test.inode_num;	//directory handle
             break;
         }
         case FILE_TYPE_2://file
         {
-
-
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fops = (uint32_t)file_jumptable;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].inode = test.inode_num;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fp = 0;
-            pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].flags = IN_USE_FLAG;
+            fops = file_jumptable;
+            inode = test.inode_num;
             break;
         }
         default:
             return -1;
-
-
     }
+
+    //take the lowest unused file descriptor, -1 if the table is full and cannot grow
+    uint32_t leader = pcb_array[current_pid].leader;
+    int32_t unusedfd = fd_alloc(leader);
+    if(unusedfd == -1) return -1;
+    file_entry_t* f = fd_slot(leader, unusedfd);
+    f->fops = (uint32_t)fops;
+    f->inode = inode;
+    f->fp = 0;
+    f->fd_flags = 0;
+    f->flags = IN_USE_FLAG;
  
 	//jump to the corresponding open function
-    uint32_t* ptr = (uint32_t*)pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[unusedfd].fops; 
-    int32_t (*fun_ptr)(const uint8_t*) = (void*)ptr[0];
-    (*fun_ptr)(filename);
+    int32_t (*fun_ptr)(const uint8_t*) = (void*)fops[0];
+    if((*fun_ptr)(filename) == -1)
+    {
+        //the driver refused, give the descriptor back
+        fd_put(leader, unusedfd);
+        return -1;
+    }
 
     return unusedfd;
 }
@@ -499,24 +935,142 @@ int32_t open (const uint8_t* filename)
  *	INPUTS: int32_t fd - file descriptor value
  *	OUTPUTS: none
  *	RETURN VALUE: 0 if the close was successful, -1 if fd is out of bounds
- *	SIDE EFFECTS: makes the certain file descriptor flagged as not in use
+ *	SIDE EFFECTS: runs the close command based on the file type, then makes the certain
+ *				  file descriptor flagged as not in use
  */
 int32_t close (int32_t fd)
 {
 	// check if fd is within range and set it to not in use, return -1 if fd is out of bounds
-	if(fd > MAX_FILES-1 || fd < FILE_TYPE_2){
+	if(fd < FILE_TYPE_2){
 		return -1;
 	}
 	// check if fd is unopened, if so, return -1
-	if (pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].flags == NOT_IN_USE_FLAG) {
+	if (fd_lookup(fd) == NULL) {
 		return -1;
 	}
 	
-	// set the flag of the now-closed fd to NOT_IN_USE
-	pcb_array[terminal_array[PIT_terminal].curr_pid].fd_array[fd].flags = NOT_IN_USE_FLAG;
+	fd_release(fd);
     return 0;
 }
 
+/*
+ *	fd_release
+ *
+ *	INPUTS: int32_t fd - open file descriptor of the current process
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: runs the close command based on the file type, then makes the
+ *				  file descriptor flagged as not in use
+ */
+static void fd_release(int32_t fd)
+{
+	//jump to the corresponding close function
+    uint32_t* ptr = (uint32_t*)fd_lookup(fd)->fops;
+    int32_t (*fun_ptr)(int32_t) = (void*)ptr[3];
+    (*fun_ptr)(fd);
+
+	// set the flag of the now-closed fd to NOT_IN_USE, and its bit free
+	fd_put(pcb_array[current_pid].leader, fd);
+}
+
+/*
+ *	fd_copy
+ *
+ *	INPUTS: file_entry_t* dst - descriptor to fill in
+ *			const file_entry_t* src - open descriptor to copy
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: a copied pipe end counts as one more holder, so the pipe stays open
+ *				  until both descriptors are closed
+ */
+static void fd_copy(file_entry_t* dst, const file_entry_t* src)
+{
+	*dst = *src;
+	pipe_share((uint32_t*)dst->fops, dst->inode);
+}
+
+/*
+ *	dup
+ *
+ *	INPUTS: int32_t fd - open file descriptor
+ *	OUTPUTS: none
+ *	RETURN VALUE: the lowest unused descriptor, now naming the same file, or -1 if fd is
+ *				  not open or the table is full and cannot grow
+ *	SIDE EFFECTS: the copy starts at fd's file position but moves on its own, and does not
+ *				  have FD_CLOEXEC
+ */
+int32_t dup (int32_t fd)
+{
+	uint32_t leader = pcb_array[current_pid].leader;
+	file_entry_t* f;
+	int32_t new_fd;
+
+	if ((f = fd_lookup(fd)) == NULL) return -1;
+	if ((new_fd = fd_alloc(leader)) == -1) return -1;
+	fd_copy(fd_slot(leader, new_fd), f);
+	fd_slot(leader, new_fd)->fd_flags = 0;
+	return new_fd;
+}
+
+/*
+ *	dup2
+ *
+ *	INPUTS: int32_t fd - open file descriptor
+ *			int32_t new_fd - descriptor to make a copy of it, stdin and stdout included
+ *	OUTPUTS: none
+ *	RETURN VALUE: new_fd, or -1 if fd is not open, new_fd is not below MAX_FILES or
+ *				  the table cannot grow to it
+ *	SIDE EFFECTS: closes whatever new_fd named first, as close would. The copy is like dup's
+ */
+int32_t dup2 (int32_t fd, int32_t new_fd)
+{
+	uint32_t leader = pcb_array[current_pid].leader;
+	file_entry_t* f;
+	uint32_t flags;
+
+	if ((f = fd_lookup(fd)) == NULL || new_fd < 0 || new_fd > MAX_FILES-1) return -1;
+	if (fd == new_fd) return new_fd;
+	while (fd_slot(leader, new_fd) == NULL) {
+		if (fd_grow(leader) == -1) return -1;
+	}
+	//another thread must not take new_fd between the close and the copy
+	cli_and_save(flags);
+	if (fd_lookup(new_fd) != NULL)
+		fd_release(new_fd);
+	pcb_array[leader].fd_free &= ~(1 << new_fd);
+	fd_copy(fd_slot(leader, new_fd), f);
+	fd_slot(leader, new_fd)->fd_flags = 0;
+	restore_flags(flags);
+	return new_fd;
+}
+
+/*
+ *	fcntl
+ *
+ *	INPUTS: int32_t fd - open file descriptor
+ *			int32_t cmd - F_GETFD or F_SETFD
+ *			int32_t arg - the new descriptor flags for F_SETFD
+ *	OUTPUTS: none
+ *	RETURN VALUE: the descriptor flags for F_GETFD, 0 for F_SETFD, -1 if fd is not open or
+ *				  cmd is unknown
+ *	SIDE EFFECTS: FD_CLOEXEC keeps fd out of the programs that execute and spawn start
+ */
+int32_t fcntl (int32_t fd, int32_t cmd, int32_t arg)
+{
+	file_entry_t* f = fd_lookup(fd);
+
+	if (f == NULL) return -1;
+	switch (cmd) {
+		case F_GETFD:
+			return f->fd_flags;
+		case F_SETFD:
+			f->fd_flags = arg & FD_CLOEXEC;
+			return 0;
+		default:
+			return -1;
+	}
+}
+
 /*
  *	getargs
  *
@@ -533,12 +1087,14 @@ int32_t getargs (uint8_t* buf, int32_t nbytes)
 {
 	// check if buffer pointer is NULL or if the args buffer in the pcb is empty
 	if (buf == NULL) return -1;
-	if(nbytes < LINE_BUFFER_SIZE || pcb_array[terminal_array[PIT_terminal].curr_pid].args[0] =='\0' ) return -1;
+	// every thread sees its program's arguments
+	uint8_t* args = pcb_array[pcb_array[current_pid].leader].args;
+	if(nbytes < LINE_BUFFER_SIZE || args[0] =='\0' ) return -1;
 
 	// insert the args buffer into the argument buffer
     int32_t i = 0;
-    while (pcb_array[terminal_array[PIT_terminal].curr_pid].args[i]!= '\0' && i<LINE_BUFFER_SIZE) {
-        buf[i] = pcb_array[terminal_array[PIT_terminal].curr_pid].args[i];
+    while (args[i]!= '\0' && i<LINE_BUFFER_SIZE) {
+        buf[i] = args[i];
         i++;
     }
     buf[i] = '\0';
@@ -574,26 +1130,515 @@ int32_t vidmap (uint8_t** screen_start)
 /*
  *	set_handler
  *
- *	INPUTS: int32_t signum -
- *			void* handler_address -
+ *	INPUTS: int32_t signum - signal to handle
+ *			void* handler_address - user function taking the signum, NULL for the default
  *	OUTPUTS: none
- *	RETURN VALUE:
- *	SIDE EFFECTS:
+ *	RETURN VALUE: 0 for success, -1 if signum or the address is bad
+ *	SIDE EFFECTS: the handler is the program's, every thread's signals go to it
  */
 int32_t set_handler (int32_t signum, void* handler_address)
 {
-    return -1;
+	uint32_t addr = (uint32_t)handler_address;
+	if (signum < 0 || signum >= NUM_SIGNALS) return -1;
+	if (addr != 0 && (addr < MB_128 || addr >= MB_128 + PROGRAM_SIZE)) return -1;
+	pcb_array[pcb_array[current_pid].leader].sig_handlers[signum] = addr;
+	return 0;
 }
 
 /*
  *	sigreturn
  *
- *	INPUTS: none
+ *	INPUTS: none, called by the trampoline do_signal put under the handler
  *	OUTPUTS: none
- *	RETURN VALUE:
- *	SIDE EFFECTS:
+ *	RETURN VALUE: the eax the handler's frame holds, so the context comes back whole
+ *	SIDE EFFECTS: copies the registers saved in the frame on the user stack back over
+ *				  this call's context, so it returns to where the signal interrupted.
+ *				  Segments and privileged flags are kept, whatever the handler wrote.
  */
 int32_t sigreturn (void)
 {
-    return -1;
+	pcb_t* pcb = &pcb_array[current_pid];
+	hw_context_t* ctx = (hw_context_t*)(tss.esp0 - sizeof(hw_context_t));
+	hw_context_t* saved = (hw_context_t*)(ctx->esp + sizeof(uint32_t));	//past signum
+
+	if (!pcb->sig_masked) return -1;
+	if ((uint32_t)saved < MB_128 || (uint32_t)(saved+1) > MB_128 + PROGRAM_SIZE) {
+		halt_exception();	//the frame is gone, there is nothing to go back to
+	}
+	ctx->ebx = saved->ebx;
+	ctx->ecx = saved->ecx;
+	ctx->edx = saved->edx;
+	ctx->esi = saved->esi;
+	ctx->edi = saved->edi;
+	ctx->ebp = saved->ebp;
+	ctx->ret_addr = saved->ret_addr;
+	ctx->esp = saved->esp;
+	ctx->eflags = (ctx->eflags & ~USER_EFLAGS) | (saved->eflags & USER_EFLAGS);
+	pcb->sig_masked = 0;
+	return saved->eax;
+}
+
+/*
+ *	stat
+ *
+ *	INPUTS: const uint8_t* filename - pointer to file name
+ *			stat_t* buf - user buffer to fill in
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 for success, -1 if the file does not exist or buf is bad
+ *	SIDE EFFECTS: writes the file's size, type, inode and block count into buf
+ */
+int32_t stat (const uint8_t* filename, stat_t* buf)
+{
+	dentry_t test;
+	const uint8_t* devname;
+	// check if pointers are NULL or if buf lies outside of the user-level page
+	if (filename == NULL || buf == NULL) return -1;
+	if ((uint32_t)buf < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)(buf+1) > PROGRAM_VIRTUAL_END) return -1;
+
+	//devices have no inode, the device number stands in for it
+	if((devname = devfs_path(filename)) != NULL){
+		if((test.inode_num = devfs_find(devname)) == -1) return -1;
+		test.filetype = 0;
+		return stat_dentry(&test, buf);
+	}
+	//check if file exists
+	if(read_dentry_by_name(filename,&test)==-1) return -1;
+	return stat_dentry(&test, buf);
+}
+
+/*
+ *	fstat
+ *
+ *	INPUTS: int32_t fd - file descriptor
+ *			stat_t* buf - user buffer to fill in
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 for success, -1 if fd is not open or buf is bad
+ *	SIDE EFFECTS: writes the open file's size, type, inode and block count into buf
+ */
+int32_t fstat (int32_t fd, stat_t* buf)
+{
+	dentry_t test;
+    //check if file descriptor is in bounds and if the flag is IN_USE
+    file_entry_t* f = fd_lookup(fd);
+    if(f == NULL) return -1;
+	if (buf == NULL) return -1;
+	if ((uint32_t)buf < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)(buf+1) > PROGRAM_VIRTUAL_END) return -1;
+
+	//recover the file type from the fd's jumptable
+    uint32_t* ptr = (uint32_t*)f->fops;
+	if (ptr == directory_jumptable)
+		test.filetype = 1;
+	else if (ptr == file_jumptable)
+		test.filetype = FILE_TYPE_2;
+	else if (ptr == terminal_fops)
+		test.filetype = FILE_TYPE_TERMINAL;
+	else
+		test.filetype = 0;
+	test.inode_num = f->inode;
+	return stat_dentry(&test, buf);
+}
+
+/*
+ *	getdents
+ *
+ *	INPUTS: int32_t fd - file descriptor of an open directory
+ *			void* buf - user buffer to fill with dirent_t records
+ *			int32_t nbytes - size of the buffer (in bytes)
+ *	OUTPUTS: none
+ *	RETURN VALUE: number of bytes of records written, 0 at the end of the directory,
+ *				  or -1 if fd is not an open directory or buf is bad
+ *	SIDE EFFECTS: advances the directory position past the returned records
+ */
+int32_t getdents (int32_t fd, void* buf, int32_t nbytes)
+{
+    //check if file descriptor is in bounds and if the flag is IN_USE
+    file_entry_t* f = fd_lookup(fd);
+    if(f == NULL) return -1;
+	if((uint32_t*)f->fops != directory_jumptable) return -1;
+
+	// check if buf lies within the user-level page
+	if (buf == NULL || nbytes <= 0) return -1;
+	if ((uint32_t)buf < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)buf + nbytes > PROGRAM_VIRTUAL_END) return -1;
+
+	return getdents_d(fd, (uint8_t*)buf, nbytes);
+}
+
+/*
+ *	fsmap
+ *
+ *	INPUTS: fsmap_t** map - where to store the table's user address
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 for success, -1 for failure
+ *	SIDE EFFECTS: maps the root directory table (names, types and inode lengths) and a
+ *				  copy of the bootblock read-only at FS_MAP_ADDR, so lookups and listings
+ *				  need no system call per entry
+ */
+int32_t fsmap (fsmap_t** map)
+{
+	fsmap_t* table;
+
+	// check if the pointer lies within the user-level page
+	if (map == NULL) return -1;
+	if ((uint32_t)map < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)map + sizeof(fsmap_t*) > PROGRAM_VIRTUAL_END) return -1;
+
+	if ((table = fsmap_table()) == NULL) return -1;
+	fs_page((uint32_t)table);
+	*map = (fsmap_t*)FS_MAP_ADDR;
+	return 0;
+}
+
+/*
+ *	pipe
+ *
+ *	INPUTS: int32_t* fds - user array of two descriptors to fill in
+ *	OUTPUTS: none
+ *	RETURN VALUE: 0 for success, -1 if fds is bad or there is no free pipe or pair of descriptors
+ *	SIDE EFFECTS: fds[0] becomes the read end and fds[1] the write end of a new pipe
+ */
+int32_t pipe (int32_t* fds)
+{
+	uint32_t leader = pcb_array[current_pid].leader;
+	file_entry_t* f;
+	int32_t ends[2];
+	int32_t i, p;
+
+	// check if fds lies within the user-level page
+	if (fds == NULL) return -1;
+	if ((uint32_t)fds < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)(fds+2) > PROGRAM_VIRTUAL_END) return -1;
+
+	// take two unused file descriptors and a pipe, or give back what was taken
+	if ((ends[0] = fd_alloc(leader)) == -1) return -1;
+	if ((ends[1] = fd_alloc(leader)) == -1 || (p = pipe_create()) == -1) {
+		if (ends[1] != -1) fd_put(leader, ends[1]);
+		fd_put(leader, ends[0]);
+		return -1;
+	}
+
+	for (i = 0; i < 2; i++) {
+		f = fd_slot(leader, ends[i]);
+		f->fops = (uint32_t)(i == 0 ? pipe_read_fops : pipe_write_fops);
+		f->inode = p;	//pipe number
+		f->fp = 0;
+		f->fd_flags = 0;
+		f->flags = IN_USE_FLAG;
+		fds[i] = ends[i];
+	}
+	return 0;
+}
+
+/*
+ *	spawn
+ *
+ *	INPUTS: const uint8_t* command - a string specifying a program and its arguments
+ *			int32_t in_fd - open descriptor the child gets as stdin
+ *			int32_t out_fd - open descriptor the child gets as stdout
+ *	OUTPUTS: none
+ *	RETURN VALUE: the child's pid, or -1 if the command cannot be executed or runs off
+ *				  the program's page, a descriptor is not open or no process is free
+ *	SIDE EFFECTS: the child is left runnable and starts on a later PIT tick; the caller
+ *				  carries on and collects its status with waitpid
+ */
+int32_t spawn (const uint8_t* command, int32_t in_fd, int32_t out_fd)
+{
+	uint8_t exe[LINE_BUFFER_SIZE];
+	dentry_t test;
+	uint32_t new_pid, entry, flags;
+	int32_t i;
+
+	// check the command and both descriptors before taking a PCB
+	if (command == NULL) return -1;
+	// the name and then the arguments are each read up to a line's length
+	if (!user_string(command, 2*LINE_BUFFER_SIZE)) return -1;
+	if (fd_lookup(in_fd) == NULL || fd_lookup(out_fd) == NULL) return -1;
+	if (num_processes == MAX_PROCESSES) return -1;
+
+	// the command lives in the caller's page, so parse it before that is unmapped
+	i = parse_command(command, exe);
+	if (exe[0] == '\0' || check_program(exe, &test) != 0) return -1;
+	uint8_t args[LINE_BUFFER_SIZE];
+	strncpy((int8_t*)args, (const int8_t*)command + i, LINE_BUFFER_SIZE-1);
+	args[LINE_BUFFER_SIZE-1] = '\0';
+
+	// the child is not runnable until it is finished, even if a read sleeps
+	cli_and_save(flags);
+	new_pid = new_process(exe, args, &test, in_fd, out_fd);
+	read_data(test.inode_num,INDEX_24,(uint8_t*)&entry,ELF_SIZE);
+	pcb_array[new_pid].parent_pid = current_pid;
+	pcb_array[new_pid].background = 1;
+	pcb_array[new_pid].entry = entry;
+	pcb_array[new_pid].state = PROC_RUNNING;
+	pcb_array[current_pid].page = pcb_array[current_pid].leader;
+	remap_page(pcb_array[current_pid].leader);
+	restore_flags(flags);
+
+	return new_pid;
+}
+
+/*
+ *	waitpid
+ *
+ *	INPUTS: int32_t pid - a child of the caller, or -1 for any child
+ *			int32_t* status - where to store what execute would have returned, may be NULL
+ *			int32_t flags - WNOHANG to return at once if no child has halted yet
+ *	OUTPUTS: none
+ *	RETURN VALUE: pid of the child collected, 0 if WNOHANG was given and none has halted,
+ *				  or -1 if there is no such child, status is bad or a signal came first
+ *	SIDE EFFECTS: sleeps until a child halts unless WNOHANG was given, then frees its PCB
+ */
+int32_t waitpid (int32_t pid, int32_t* status, int32_t flags)
+{
+	uint32_t saved;
+	int32_t ret;
+
+	// check if status lies within the user-level page
+	if (status != NULL && ((uint32_t)status < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)(status+1) > PROGRAM_VIRTUAL_END)) return -1;
+	if (pid != -1 && (pid < 1 || pid > MAX_PROCESSES)) return -1;
+
+	cli_and_save(saved);
+	ret = wait_child(pid, status, flags);
+	restore_flags(saved);
+	return ret;
+}
+
+/*
+ *	wait_child
+ *
+ *	INPUTS: int32_t pid - a child of the current process, or -1 for any child
+ *			int32_t* status - where to store its exit status, may be NULL
+ *			int32_t flags - WNOHANG to return at once if no child has halted yet
+ *	OUTPUTS: none
+ *	RETURN VALUE: as for waitpid
+ *	SIDE EFFECTS: the caller sleeps out of the scheduler until halt wakes it, or until a signal
+ *				  needs delivering. Called with interrupts off
+ */
+static int32_t wait_child(int32_t pid, int32_t* status, int32_t flags)
+{
+	uint32_t i, children;
+
+	while (1) {
+		children = 0;
+		for (i = 1; i <= MAX_PROCESSES; i++) {
+			if (pcb_array[i].in_use_flag != IN_USE_FLAG || pcb_array[i].parent_pid != current_pid) continue;
+			if (pcb_array[i].leader != i) continue;	//threads are collected by thread_join
+			if (pid != -1 && (uint32_t)pid != i) continue;
+			children++;
+			if (pcb_array[i].state == PROC_ZOMBIE) {
+				// reap it
+				if (status != NULL) *status = pcb_array[i].exit_status;
+				pcb_array[i].in_use_flag = NOT_IN_USE_FLAG;
+				num_processes--;
+				return i;
+			}
+		}
+		if (children == 0) return -1;
+		if (flags & WNOHANG) return 0;
+		if (wait_on(NULL) == -1) return -1;
+	}
+}
+
+/*
+ *	orphan_children
+ *
+ *	INPUTS: uint32_t pid - a process that is halting
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: frees its zombie children, the running ones free themselves when they halt
+ */
+static void orphan_children(uint32_t pid)
+{
+	uint32_t i, flags;
+	cli_and_save(flags);
+	for (i = 1; i <= MAX_PROCESSES; i++) {
+		if (pcb_array[i].in_use_flag != IN_USE_FLAG || pcb_array[i].parent_pid != pid || pcb_array[i].leader != i)
+			continue;
+		if (pcb_array[i].state == PROC_ZOMBIE) {
+			pcb_array[i].in_use_flag = NOT_IN_USE_FLAG;
+			num_processes--;
+		}
+		else {
+			pcb_array[i].parent_pid = 0;
+		}
+	}
+	restore_flags(flags);
+}
+
+/*
+ *	thread_create
+ *
+ *	INPUTS: uint32_t entry - user address the thread starts at
+ *			uint32_t fn, arg - left on the thread's stack for entry to pick up
+ *	OUTPUTS: none
+ *	RETURN VALUE: the new thread's id, or -1 if entry is bad or no PCB is free
+ *	SIDE EFFECTS: the thread shares the caller's page and files but has its own kernel stack
+ *				  and its own THREAD_STACK_SIZE user stack below the first thread's, and starts
+ *				  on a later PIT tick
+ */
+int32_t thread_create (uint32_t entry, uint32_t fn, uint32_t arg)
+{
+	pcb_t* pcb = &pcb_array[current_pid];
+	uint32_t tid, flags;
+	uint32_t* sp;
+
+	if (entry < PROGRAM_VIRTUAL_ADDRESS || entry > PROGRAM_VIRTUAL_END) return -1;
+
+	cli_and_save(flags);
+	if (num_processes == MAX_PROCESSES) {
+		restore_flags(flags);
+		return -1;
+	}
+	tid = 1;
+	while (pcb_array[tid].in_use_flag != NOT_IN_USE_FLAG) {
+		tid++;
+	}
+	pcb_array[tid].in_use_flag = IN_USE_FLAG;
+	num_processes++;
+
+	strncpy((int8_t*)pcb_array[tid].name, (int8_t*)pcb->name, FILENAME_LEN+1);
+	pcb_array[tid].ticks = 0;
+	pcb_array[tid].syscalls = 0;
+	pcb_array[tid].terminal = pcb->terminal;
+	pcb_array[tid].background = pcb->background;
+	pcb_array[tid].leader = pcb->leader;
+	pcb_array[tid].page = pcb->leader;
+	pcb_array[tid].parent_pid = pcb->leader;
+	pcb_array[tid].state = PROC_RUNNING;
+	pcb_array[tid].entry = entry;
+	pcb_array[tid].futex_key = 0;
+	pcb_array[tid].poll_sleeping = 0;
+	pcb_array[tid].sig_pending = 0;
+	pcb_array[tid].sig_masked = 0;
+	pcb_array[tid].exiting = 0;
+
+	// the stacks are handed out by PCB slot, so no two live threads share one
+	sp = (uint32_t*)(PROGRAM_VIRTUAL_END - MAIN_STACK_SIZE - (tid-1)*THREAD_STACK_SIZE);
+	*--sp = arg;
+	*--sp = fn;
+	pcb_array[tid].user_esp = (uint32_t)sp;
+	restore_flags(flags);
+
+	return tid;
+}
+
+/*
+ *	thread_join
+ *
+ *	INPUTS: int32_t tid - another thread of the caller's program, not its first
+ *			int32_t* status - where to store what it halted with, may be NULL
+ *	OUTPUTS: none
+ *	RETURN VALUE: tid, or -1 if it is not such a thread, status is bad or a signal came first
+ *	SIDE EFFECTS: sleeps until the thread halts, then frees its PCB
+ */
+int32_t thread_join (int32_t tid, int32_t* status)
+{
+	uint32_t leader = pcb_array[current_pid].leader;
+	uint32_t flags;
+	pcb_t* t;
+
+	// check if status lies within the user-level page
+	if (status != NULL && ((uint32_t)status < PROGRAM_VIRTUAL_ADDRESS || (uint32_t)(status+1) > PROGRAM_VIRTUAL_END)) return -1;
+	if (tid < 1 || tid > MAX_PROCESSES || (uint32_t)tid == current_pid) return -1;
+	t = &pcb_array[tid];
+
+	cli_and_save(flags);
+	while (1) {
+		// checked each time round, another joiner may have collected it
+		if (t->in_use_flag != IN_USE_FLAG || t->leader != leader || (uint32_t)tid == leader) {
+			restore_flags(flags);
+			return -1;
+		}
+		if (t->state == PROC_ZOMBIE) break;
+		if (wait_on(NULL) == -1) {
+			restore_flags(flags);
+			return -1;
+		}
+	}
+	if (status != NULL) *status = t->exit_status;
+	t->in_use_flag = NOT_IN_USE_FLAG;
+	num_processes--;
+	restore_flags(flags);
+	return tid;
+}
+
+/*
+ *	alarm
+ *
+ *	INPUTS: uint32_t ms - time between ALARM signals, 0 to stop them
+ *	OUTPUTS: none
+ *	RETURN VALUE: the previous period in ms, rounded to PIT ticks
+ *	SIDE EFFECTS: restarts the count, the first ALARM comes one period from now
+ */
+int32_t alarm (uint32_t ms)
+{
+	pcb_t* leader = &pcb_array[pcb_array[current_pid].leader];
+	uint32_t old = leader->alarm_period * 1000 / (PIT_INPUT_HZ / PIT_FREQ);
+	uint32_t flags;
+
+	cli_and_save(flags);
+	leader->alarm_period = alarm_ms_to_ticks(ms);
+	leader->alarm_left = leader->alarm_period;
+	restore_flags(flags);
+	return old;
+}
+
+/*
+ *	kill_threads
+ *
+ *	INPUTS: uint32_t leader - first thread of a program that is halting
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: marks the program's other threads to halt and wakes any that sleep. The
+ *				  caller sleeps until each has left the kernel and halted, so none is freed
+ *				  holding the disk, the decompressor or a cache block; then frees them.
+ *				  Called with interrupts off
+ */
+static void kill_threads(uint32_t leader)
+{
+	uint32_t i, left;
+	for (i = 1; i <= MAX_PROCESSES; i++) {
+		if (i == leader || pcb_array[i].in_use_flag != IN_USE_FLAG || pcb_array[i].leader != leader)
+			continue;
+		pcb_array[i].exiting = 1;
+		futex_cancel(i);
+		// poll_tick gets up the ones in poll, wait_on or futex_wait, the rest look again themselves
+		if (pcb_array[i].state == PROC_WAITING && !pcb_array[i].poll_sleeping)
+			pcb_array[i].state = PROC_RUNNING;
+	}
+
+	while (1) {
+		left = 0;
+		for (i = 1; i <= MAX_PROCESSES; i++) {
+			if (i == leader || pcb_array[i].in_use_flag != IN_USE_FLAG || pcb_array[i].leader != leader)
+				continue;
+			// one that never ran holds nothing, the others halt on their way back to user mode
+			if (pcb_array[i].state == PROC_ZOMBIE || pcb_array[i].entry != 0) {
+				orphan_children(i);
+				pcb_array[i].in_use_flag = NOT_IN_USE_FLAG;
+				num_processes--;
+			} else {
+				left++;
+			}
+		}
+		if (left == 0) break;
+		pcb_array[leader].state = PROC_WAITING;
+		schedule();
+		pcb_array[leader].state = PROC_RUNNING;
+	}
+}
+
+/*
+ *	wake_threads
+ *
+ *	INPUTS: uint32_t leader - first thread of a program
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: makes every waiting thread of the program runnable, so a joiner sees a
+ *				  thread that just halted; the others find nothing and sleep again
+ */
+static void wake_threads(uint32_t leader)
+{
+	uint32_t i;
+	for (i = 1; i <= MAX_PROCESSES; i++) {
+		if (pcb_array[i].in_use_flag == IN_USE_FLAG && pcb_array[i].leader == leader && pcb_array[i].state == PROC_WAITING)
+			pcb_array[i].state = PROC_RUNNING;
+	}
 }
@@ -4,13 +4,24 @@
 #ifndef _SYS_CALLS_H
 #define _SYS_CALLS_H
 #include "types.h"
+#include "filesys.h"
+#include "signal.h"
 
 #define IN_USE_FLAG 			33
 #define NOT_IN_USE_FLAG 		44
 
 #define MAX_PROCESSES 			6
-#define MAX_FILES 				8
+#define MAX_FILES 				32	//descriptors a program can have open, its table grows to this
+#define FD_CHUNK				8	//descriptors in the pcb, and in each chunk the table grows by
+#define FD_CHUNKS				(MAX_FILES/FD_CHUNK - 1)	//pool chunks one table can take
+#define FD_CHUNK_BITS			0xFF	//FD_CHUNK bits of fd_free
+#define FD_NO_CHUNK				0xFF	//fd_chunks entry not taken yet
+#define FD_POOL_CHUNKS			8	//chunks shared by every program
+#define FD_CLOEXEC				1	//fd_flags bit: not copied into programs it starts
+#define F_GETFD					1	//fcntl commands
+#define F_SETFD					2
 #define FILE_TYPE_2				2
+#define FILE_TYPE_TERMINAL		3
 
 #define ELF_SIZE 				4
 #define ELF_0					0x7f
@@ -24,10 +35,27 @@
 #define PROGRAM_VIRTUAL_ADDRESS 0x08048000
 #define PROGRAM_VIRTUAL_END		0x83FFFFC
 
-#define	EX_STATUS				8
 #define EXCEPTION				256
-#define ABNORMAL				125
 #define AB_STATUS				3
+#define NUM_SYS_CALLS			28	//one past the highest number in jump_table
+
+#define PROC_RUNNING			0	//can be picked by the scheduler
+#define PROC_WAITING			1	//sitting in execute or waitpid until a child halts
+#define PROC_ZOMBIE				2	//halted, holding its exit status for its parent
+
+#define SYS_HIST_BUCKETS		32	//log2 of the cycles a call took, one bucket per bit
+
+#define WNOHANG					1	//waitpid flag, do not sleep
+
+#define MSR_SYSENTER_CS			0x174
+#define MSR_SYSENTER_ESP		0x175
+#define MSR_SYSENTER_EIP		0x176
+#define CPUID_SEP				0x800	//EDX bit 11, SYSENTER and SYSEXIT
+//the first family 6 parts, model and stepping both below 3, claim SEP without having it
+#define CPUID_SEP_BROKEN(sig)	(((sig) & 0xF0F00) == 0x600 && ((sig) >> 4 & 0xF) < 3 && ((sig) & 0xF) < 3)
+
+#define MAIN_STACK_SIZE			0x100000	//user stack left to a program's first thread
+#define THREAD_STACK_SIZE		0x10000		//user stack of every other thread, below it
 
 
 
@@ -37,32 +65,70 @@ typedef struct __attribute__((packed))  file_entry{
     uint32_t inode	: 32; //inode
     uint32_t fp		: 32; //file position
     uint32_t flags	: 32; //flags
+    uint32_t fd_flags	: 32; //FD_CLOEXEC, belongs to the descriptor and not to what it names
 
 }file_entry_t;
 
 typedef struct __attribute__((packed)) pcb{
 
-    file_entry_t fd_array[MAX_FILES] ;	
+    file_entry_t fd_array[FD_CHUNK] ;	//the first descriptors, the rest are in fd_chunks
+    uint8_t fd_chunks[FD_CHUNKS];	//fd_pool chunk for each further FD_CHUNK descriptors, FD_NO_CHUNK past the end
+    uint32_t fd_free;	//a bit per free descriptor the table has room for
     uint32_t parent_pid;
-    uint32_t parent_kernel_esp;
-    uint32_t parent_kernel_ebp;
     uint8_t args[128];
 	uint8_t in_use_flag;
 	uint8_t active_flag;
     uint32_t terminal;
+    uint8_t name[FILENAME_LEN+1];	//program it runs, for /proc/ps
+    uint32_t ticks;		//PIT ticks it was running for
+    uint32_t syscalls;	//system calls it made
+    uint32_t state;		//PROC_RUNNING, PROC_WAITING or PROC_ZOMBIE
+    uint32_t kernel_esp;	//where the scheduler left it
+    uint32_t kernel_ebp;
+    uint32_t entry;		//user entry point of a spawned process that has not run yet, else 0
+    uint8_t background;	//started by spawn, so it does not own the terminal
+    int32_t exit_status;	//what execute would have returned, kept for waitpid
+    uint32_t leader;	//pid whose page and files it shares, its own pid for a program's first thread
+    uint32_t page;	//pid whose program page is mapped while it runs: its leader's, or a child's it is loading
+    uint32_t user_esp;	//user stack pointer it starts with
+    uint32_t futex_key;	//physical address it sleeps on in futex_wait, else 0
+    uint32_t futex_next;	//next pid sleeping in the same futex bucket
+    uint32_t sig_pending;	//a bit per signal raised and not yet delivered
+    uint8_t sig_masked;	//running a handler, nothing more until it calls sigreturn
+    uint8_t exiting;	//its program's first thread is halting, so it halts on its way back to user mode
+    uint32_t sig_handlers[NUM_SIGNALS];	//user handler per signal, 0 for the default; the leader's count
+    uint32_t alarm_period;	//PIT ticks between ALARMs, 0 for none; the leader's count
+    uint32_t alarm_left;	//ticks to the next one
+    uint8_t poll_sleeping;	//asleep in poll or wait_on, so wake_up and poll_tick may wake it
+    uint32_t poll_deadline;	//pit_ticks when its poll times out, 0 for none
+    uint32_t sys_hist[NUM_SYS_CALLS][SYS_HIST_BUCKETS];	//calls by number and log2 cycles; the leader's count
+    uint64_t sys_cycles[NUM_SYS_CALLS];	//cycles spent in each number; the leader's count
     
 }pcb_t;
 
 void set_fp(int32_t fd,uint32_t fp);
 uint32_t get_flags(int32_t fd);
 uint32_t get_inode(int32_t fd);
+uint32_t* get_fops(int32_t fd);
+int32_t user_string (const uint8_t* s, uint32_t max);
 void init_pcb_array();
 void init_STD(uint32_t pid);
 uint32_t get_fp(int32_t fd);
 void clear_fp(int32_t fd);
 void fp_plus(int32_t fd);
+pcb_t* get_pcb(uint32_t pid);
+void syscall_enter(uint32_t num);
+void syscall_exit(uint64_t start, uint32_t num);
+void sysenter_init(void);
+void set_kernel_stack(uint32_t pid);
+
+extern uint32_t syscall_counts[NUM_SYS_CALLS];	//calls made of each number since boot
+extern uint32_t syscall_hist[NUM_SYS_CALLS][SYS_HIST_BUCKETS];	//the same, by log2 of the cycles they took
+extern uint64_t syscall_cycles[NUM_SYS_CALLS];	//cycles spent in each number since boot
+extern uint32_t current_pid;	//the process on the CPU
 
 int32_t halt(uint8_t status);
+int32_t halt_exception(void);
 int32_t execute(const uint8_t* command);
 int32_t read (int32_t fd, void* buf, int32_t nbytes);
 int32_t write (int32_t fd, const void* buf, int32_t nbytes);
@@ -72,5 +138,18 @@ int32_t getargs (uint8_t* buf, int32_t nbytes);
 int32_t vidmap (uint8_t** screen_start);
 int32_t set_handler (int32_t signum, void* handler_address);
 int32_t sigreturn (void);
+int32_t stat (const uint8_t* filename, stat_t* buf);
+int32_t fstat (int32_t fd, stat_t* buf);
+int32_t getdents (int32_t fd, void* buf, int32_t nbytes);
+int32_t fsmap (fsmap_t** map);
+int32_t pipe (int32_t* fds);
+int32_t spawn (const uint8_t* command, int32_t in_fd, int32_t out_fd);
+int32_t waitpid (int32_t pid, int32_t* status, int32_t flags);
+int32_t thread_create (uint32_t entry, uint32_t fn, uint32_t arg);
+int32_t thread_join (int32_t tid, int32_t* status);
+int32_t alarm (uint32_t ms);
+int32_t dup (int32_t fd);
+int32_t dup2 (int32_t fd, int32_t new_fd);
+int32_t fcntl (int32_t fd, int32_t cmd, int32_t arg);
 
 #endif
@@ -9,6 +9,7 @@
 #include "sys_calls.h"
 
 extern void sys_call_handler();
+extern void sysenter_handler();
 
 extern void context_switch(uint32_t user_ds, uint32_t iret_esp, uint32_t user_cs, uint32_t entry);
 
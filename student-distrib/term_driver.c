@@ -4,6 +4,13 @@
 #include "lib.h"
 #include "term_switch.h"
 #include "pit.h"
+#include "devfs.h"
+#include "poll.h"
+
+//stdin and stdout of every process, and /dev/tty
+static wait_queue_t terminal_wq[TERM_3+1];	//pollers and readers per terminal, woken on Enter
+
+uint32_t terminal_fops[FOPS_SIZE] = {(uint32_t)&terminal_open,(uint32_t)&terminal_read,(uint32_t)&terminal_write,(uint32_t)&terminal_close,(uint32_t)&terminal_poll};
 
 /* 
  * type_to_buffer(char input)
@@ -90,12 +97,15 @@ void clear_buffer() {
  *  const void* buf  - a char* string that has 128 bytes
  *  int32_t nbytes - must be larger than 128 bytes (specifies size of the buffer)
  *	OUTPUTS: writes to the address pointed to by buf
- *	RETURN VALUE:the number of bytes written, or -1 on failure
- *	SIDE EFFECTS: none
+ *	RETURN VALUE:the number of bytes written, or -1 on failure or if a signal came first
+ *	SIDE EFFECTS: sleeps until Enter finishes a line on the program's terminal
  */
 
 int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
 {
+	term_t* term = &terminal_array[PIT_terminal];
+	uint32_t flags, count;
+
 	if(nbytes < LINE_BUFFER_SIZE-1 || buf==NULL) return -1;
 
 	/* int8_t* strcpy(int8_t* dest, const int8_t* src, uint32_t n)
@@ -105,10 +115,17 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
 	* Return Value: pointer to dest
 	* Function: copy n bytes of the source string into the destination string */
 	
-	while(terminal_array[PIT_terminal].keyboard[terminal_array[PIT_terminal].buf_count-1]!='\n');
-		uint32_t count = terminal_array[PIT_terminal].buf_count;
-		strncpy((int8_t*) buf, terminal_array[PIT_terminal].keyboard, terminal_array[PIT_terminal].buf_count);
+	cli_and_save(flags);
+	while(term->buf_count == 0 || term->keyboard[term->buf_count-1]!='\n'){
+		if(wait_on(&terminal_wq[PIT_terminal]) == -1){
+			restore_flags(flags);
+			return -1;
+		}
+	}
+	count = term->buf_count;
+	strncpy((int8_t*) buf, term->keyboard, count);
 	clear_buffer();
+	restore_flags(flags);
 	return count;
 
 
@@ -122,28 +139,16 @@ int32_t terminal_read(int32_t fd, void* buf, int32_t nbytes)
  *  const void* buf  - a char* string that has 128 bytes
  *  int32_t nbytes -  must be larger than 128 bytes (specifies size of the buffer)
  *	OUTPUTS: writes to the address pointed to by buf
- *	RETURN VALUE:the number of bytes read, or -1 on failure
- *	SIDE EFFECTS: none
+ *	RETURN VALUE:the number of bytes read, or -1 on failure or if a signal came first
+ *	SIDE EFFECTS: sleeps until Enter finishes a line on the program's terminal
  */
 
 int32_t keyboard_read(int32_t fd, void* buf, int32_t nbytes)
 {
 	if(nbytes < LINE_BUFFER_SIZE || buf==NULL) return -1;
 
-	/* int8_t* strcpy(int8_t* dest, const int8_t* src, uint32_t n)
-	* Inputs:      int8_t* dest = destination string of copy
-	*         const int8_t* src = source string of copy
-	*                uint32_t n = number of bytes to copy
-	* Return Value: pointer to dest
-	* Function: copy n bytes of the source string into the destination string */
-	
-	while(terminal_array[PIT_terminal].keyboard[terminal_array[PIT_terminal].buf_count-1]!='\n');
-		uint32_t count = terminal_array[PIT_terminal].buf_count;
-		strncpy((int8_t*) buf, terminal_array[PIT_terminal].keyboard, terminal_array[PIT_terminal].buf_count);
-	clear_buffer();
-	return count;
-
-
+	//the same wait for Enter as terminal_read
+	return terminal_read(fd, buf, nbytes);
 }
 
 
@@ -180,16 +185,15 @@ int32_t terminal_write(int32_t fd, const void* buf, int32_t nbytes)
 
 /*
  *	terminal_open
- *  DESCRIPTION: not used
+ *  DESCRIPTION: opens the terminal again as /dev/tty, nothing to set up
  *	INPUTS:the name of a file , represented as a array of bytes, with max size of 32 (addresses in filesys.c)
  *	OUTPUTS: none
- *	RETURN VALUE:file descriptor 
- *  If the named file does not exist or no descriptors are free, the call returns -1
+ *	RETURN VALUE:0 for success
  *	SIDE EFFECTS: none
  */
 int32_t terminal_open(const uint8_t* filename){
 	 
-	return -1;
+	return 0;
 
  }
 
@@ -207,3 +211,35 @@ int32_t terminal_open(const uint8_t* filename){
 	return -1;
 }
 
+/*
+ *	terminal_poll
+ *  DESCRIPTION: whether terminal_read would return at once
+ *	INPUTS:
+ *  int32_t fd - a file descriptor (not used)
+ *  int32_t wait - also wait for the next line typed on the program's terminal
+ *	OUTPUTS: none
+ *	RETURN VALUE: POLLIN once a whole line is in the buffer, and POLLOUT
+ *	SIDE EFFECTS: none
+ */
+int32_t terminal_poll(int32_t fd, int32_t wait){
+	term_t* term = &terminal_array[PIT_terminal];
+
+	if(term->buf_count > 0 && term->keyboard[term->buf_count-1] == '\n')
+		return POLLIN | POLLOUT;
+	if(wait)
+		poll_wait(&terminal_wq[PIT_terminal]);
+	return POLLOUT;
+}
+
+/*
+ *	terminal_wake
+ *  DESCRIPTION: wakes programs polling or reading a terminal, once Enter finishes a line
+ *	INPUTS: uint32_t term - the terminal typed on
+ *	OUTPUTS: none
+ *	RETURN VALUE: none
+ *	SIDE EFFECTS: none
+ */
+void terminal_wake(uint32_t term){
+	if(terminal_wq[term] != 0)
+		wake_up(&terminal_wq[term]);
+}
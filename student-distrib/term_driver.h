@@ -31,4 +31,11 @@ extern int32_t terminal_open(const uint8_t* filename);
 
 extern int32_t terminal_close(int32_t fd);
 
+extern int32_t terminal_poll(int32_t fd, int32_t wait);
+
+/* Wake programs polling a terminal for a line */
+void terminal_wake(uint32_t term);
+
+extern uint32_t terminal_fops[];
+
 #endif
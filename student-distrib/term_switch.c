@@ -8,6 +8,7 @@
 #include "lib.h"
 #include "term_driver.h"
 #include "pit.h"
+#include "devfs.h"
 
 uint8_t term1pid = TERM_1;
 uint8_t term2pid = TERM_2;
@@ -23,7 +24,8 @@ uint32_t curr_addr = TERM_VID_1;
  *	INPUTS: none
  *	OUTPUTS: none
  *	RETURN VALUE: none
- *	SIDE EFFECTS: set all global variables affiliated with terminal programs to start in terminal 1
+ *	SIDE EFFECTS: set all global variables affiliated with terminal programs to start in terminal 1,
+ *				  registers /dev/tty
  */
 void init_terminal(){
 	/* initialize data in all terminal structures */
@@ -42,6 +44,7 @@ void init_terminal(){
 	line_buffer = terminal_array[1].keyboard;
 	buffer_count = &terminal_array[1].buf_count;
 	map_terminal(1);
+	devfs_register("tty", terminal_fops);
 }
 
 /*
@@ -104,18 +107,14 @@ void switch_terminal(uint8_t keycode) {
 }
 
 /*
- *	schedule_terminal (uint32_t old_terminal)
+ *	schedule_terminal (uint32_t new_terminal)
  *
- *	INPUTS: uint32_t old_terminal - terminal the scheduler is leaving
+ *	INPUTS: uint32_t new_terminal - terminal of the process the scheduler is switching to
  *	OUTPUTS: none
  *	RETURN VALUE: none
  *	SIDE EFFECTS: remaps vidmap virtual address and sets lib.c video pointer for the next program on the scheduler
  */
-void schedule_terminal(uint32_t old_terminal) {
-	/* determine which terminal is PIT going to switch to */
-	uint32_t new_terminal = old_terminal + 1;
-	if(new_terminal==TERM_3+1) new_terminal=1;
-
+void schedule_terminal(uint32_t new_terminal) {
 	/* set lib.c to point to new virtual terminal address, and if terminal to switch to is the one being displayed,
 	*  set mapping of vidmap to physical video memory, otherwise set it to the respective temrinal buffer
 	*/
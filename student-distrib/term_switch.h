@@ -18,9 +18,6 @@ typedef struct __attribute__((packed)) term{
 	int buf_count;
     uint8_t screenx;
     uint8_t screeny;
-	uint32_t curr_pid;
-    uint32_t esp;
-    uint32_t ebp;
 
 }term_t;
 
@@ -28,6 +25,6 @@ term_t terminal_array[TERM_3+1];
 
 void init_terminal();
 void switch_terminal(uint8_t keycode);
-void schedule_terminal(uint32_t old_terminal);
+void schedule_terminal(uint32_t new_terminal);
 
 #endif
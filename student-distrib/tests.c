@@ -6,6 +6,11 @@
 #include "rtc.h"
 #include "term_driver.h"
 #include "filesys.h"
+#include "bcache.h"
+#include "pit.h"
+#include "lz4.h"
+#include "devfs.h"
+#include "vdso.h"
 
 #define PASS 1
 #define FAIL 0
@@ -440,6 +445,386 @@ int filesys_test_directory(){
 	return PASS;
 }
 
+/* 
+
+ *Filesystem stat test
+ * 
+ * Description: Checks that stat_dentry reports the same size read_data returns
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: Filesystem stat_dentry functionality
+ * Files: filesys.c/filesys.h
+ */
+int filesys_stat_test(){
+	TEST_HEADER;
+
+	dentry_t test;
+	stat_t st;
+	uint32_t size=6000; //upper limit for a large file
+	uint8_t buf[size];
+	if(read_dentry_by_name((uint8_t*)"verylargetextwithverylongname.tx", &test) == -1)
+		return FAIL;
+	if(stat_dentry(&test, &st) == -1)
+		return FAIL;
+	if(st.filetype != 2 || st.inode_num != test.inode_num)
+		return FAIL;
+	if(st.size != read_data(test.inode_num, 0, buf, size))
+		return FAIL;
+	if(st.blocks != (st.size + DATA_BLOCK_SIZE - 1)/DATA_BLOCK_SIZE)
+		return FAIL;
+
+	/* the directory is sized by its bootblock entries, devices have no data */
+	if(read_dentry_by_name((uint8_t*)".", &test) == -1 || stat_dentry(&test, &st) == -1)
+		return FAIL;
+	if(st.filetype != 1 || st.size == 0 || st.size % sizeof(dentry_t) != 0)
+		return FAIL;
+	return PASS;
+}
+
+/* 
+
+ *Filesystem path test
+ * 
+ * Description: Checks path resolution and that repeated lookups hit the dentry cache
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: Filesystem read_dentry_by_name path walk, dentry cache
+ * Files: filesys.c/filesys.h
+ */
+int filesys_path_test(){
+	TEST_HEADER;
+
+	dentry_t test, again;
+	uint32_t hits, misses, hits_after, misses_after;
+	if(read_dentry_by_name((uint8_t*)"/", &test) == -1 || test.filetype != 1 || test.inode_num != FS_ROOT_DIR)
+		return FAIL;
+	if(read_dentry_by_name((uint8_t*)"shell", &test) == -1)
+		return FAIL;
+	/* leading slashes and "." components resolve to the same file */
+	if(read_dentry_by_name((uint8_t*)"/./shell", &again) == -1 || again.inode_num != test.inode_num)
+		return FAIL;
+	/* a file cannot have more path after it */
+	if(read_dentry_by_name((uint8_t*)"shell/shell", &again) != -1)
+		return FAIL;
+
+	dcache_stats(&hits, &misses);
+	if(read_dentry_by_name((uint8_t*)"shell", &again) == -1 || again.inode_num != test.inode_num)
+		return FAIL;
+	dcache_stats(&hits_after, &misses_after);
+	if(hits_after != hits+1 || misses_after != misses)
+		return FAIL;
+	return PASS;
+}
+
+/* 
+
+ *Filesystem map test
+ * 
+ * Description: Checks that the fsmap table agrees with the bootblock and stat_dentry
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: Filesystem fsmap_table
+ * Files: filesys.c/filesys.h
+ */
+int filesys_fsmap_test(){
+	TEST_HEADER;
+
+	fsmap_t* map;
+	dentry_t test;
+	stat_t st;
+	uint32_t i;
+	if((map = fsmap_table()) == NULL || ((uint32_t)map & (DATA_BLOCK_SIZE-1)) != 0)
+		return FAIL;
+	for(i=0; read_dentry_by_index(i, &test) != -1; i++){
+		if(i >= map->dir_count || strncmp(map->boot.direntries[i].filename, test.filename, FILENAME_LEN) != 0)
+			return FAIL;
+		if(test.filetype == 2){
+			if(stat_dentry(&test, &st) == -1 || map->i_length[test.inode_num] != st.size)
+				return FAIL;
+		}
+	}
+	if(i != map->dir_count)
+		return FAIL;
+	return PASS;
+}
+
+/* 
+
+ *Filesystem check test
+ * 
+ * Description: The shipped image checks clean and reads the same afterwards
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: Filesystem fsck, read_data
+ * Files: filesys.c/filesys.h
+ */
+int filesys_fsck_test(){
+	TEST_HEADER;
+
+	static uint8_t before[0x10000], after[0x10000];		//fish is about 36kB
+	dentry_t test;
+	int32_t n, i;
+	if(read_dentry_by_name((uint8_t*)"fish", &test) == -1)
+		return FAIL;
+	n = read_data(test.inode_num, 0, before, sizeof(before));
+	if(n <= 0 || fsck() != 0)
+		return FAIL;
+	if(read_data(test.inode_num, 0, after, sizeof(after)) != n)
+		return FAIL;
+	for(i=0; i<n; i++){
+		if(before[i] != after[i])
+			return FAIL;
+	}
+	return PASS;
+}
+
+/* 
+
+ *devfs test
+ * 
+ * Description: Resolves /dev and /proc names and reads /dev/zero through its ops table
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: devfs_path, devfs_find, devfs_fops
+ * Files: devfs.c/devfs.h
+ */
+int devfs_test(){
+	TEST_HEADER;
+
+	uint8_t buf[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+	int32_t (*read_fn)(int32_t, void*, int32_t);
+	uint32_t* fops;
+	int32_t i;
+	if(devfs_path((uint8_t*)"/dev/zero") == NULL || devfs_path((uint8_t*)"frame0.txt") != NULL)
+		return FAIL;
+	if(devfs_find((uint8_t*)"nope") != -1 || devfs_find((uint8_t*)"rtc") == -1)
+		return FAIL;
+	if(devfs_find(devfs_path((uint8_t*)"/proc/stat")) == -1)
+		return FAIL;
+	if((fops = devfs_fops(devfs_find(devfs_path((uint8_t*)"dev/zero")))) == NULL)
+		return FAIL;
+	read_fn = (void*)fops[1];
+	if(read_fn(0, buf, sizeof(buf)) != sizeof(buf))
+		return FAIL;
+	for(i=0; i<sizeof(buf); i++){
+		if(buf[i] != 0)
+			return FAIL;
+	}
+	return PASS;
+}
+
+/* 
+
+ *LZ4 decoder test
+ * 
+ * Description: Decodes a block with an overlapping match and rejects a bad offset
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure
+ * Coverage: lz4_decompress
+ * Files: lz4.c/lz4.h
+ */
+int lz4_test(){
+	TEST_HEADER;
+
+	/* "abc", then 9 bytes from 3 back, then a last literal "d" */
+	uint8_t block[] = {0x35, 'a', 'b', 'c', 0x03, 0x00, 0x10, 'd'};
+	uint8_t bad[] = {0x10, 'a', 0x02, 0x00};
+	uint8_t out[16];
+	if(lz4_decompress(block, sizeof(block), out, sizeof(out)) != 13)
+		return FAIL;
+	if(strncmp((int8_t*)out, (int8_t*)"abcabcabcabcd", 13) != 0)
+		return FAIL;
+	/* output too small, and a match reaching before the start */
+	if(lz4_decompress(block, sizeof(block), out, 12) != -1)
+		return FAIL;
+	if(lz4_decompress(bad, sizeof(bad), out, sizeof(out)) != -1)
+		return FAIL;
+	return PASS;
+}
+
+#define BENCH_BUF_SIZE	0x10000		//64kB, larger than any file in the image
+#define BENCH_REPS		64
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+/* 
+
+ *Filesystem read throughput benchmark
+ * 
+ * Description: Times reading every regular file whole and one block per call,
+ *              and whole with the old block-at-a-time memcpy loop for comparison
+ * Inputs: NONE
+ * Outputs: NONE
+ * Side Effects: prints cycles per kB for the three, per file
+ * Coverage: Filesystem read_data run coalescing
+ * Files: filesys.c/filesys.h
+ */
+void filesys_bench(){
+	TEST_HEADER;
+
+	dentry_t test;
+	stat_t st;
+	uint64_t start;
+	uint32_t whole, old, blocks;		//a few million cycles at most, no 64-bit divide needed
+	uint32_t i, rep, off, kb;
+	for(i=0; read_dentry_by_index(i, &test) != -1; i++){
+		if(test.filetype != 2 || stat_dentry(&test, &st) == -1 || st.size == 0 || st.size > BENCH_BUF_SIZE)
+			continue;
+
+		start = rdtsc();
+		for(rep=0; rep<BENCH_REPS; rep++)
+			read_data(test.inode_num, 0, bench_buf, st.size);
+		whole = (uint32_t)(rdtsc() - start);
+
+		//compressed files have no old loop to compare with
+		old = 0;
+		if(read_data_blockwise(test.inode_num, 0, bench_buf, st.size) == (int32_t)st.size){
+			start = rdtsc();
+			for(rep=0; rep<BENCH_REPS; rep++)
+				read_data_blockwise(test.inode_num, 0, bench_buf, st.size);
+			old = (uint32_t)(rdtsc() - start);
+		}
+
+		start = rdtsc();
+		for(rep=0; rep<BENCH_REPS; rep++)
+			for(off=0; off<st.size; off+=DATA_BLOCK_SIZE)
+				read_data(test.inode_num, off, bench_buf + off, DATA_BLOCK_SIZE);
+		blocks = (uint32_t)(rdtsc() - start);
+
+		kb = (st.size*BENCH_REPS + 1023)/1024;
+		printf("%s: %u bytes, whole %u cyc/kB (old loop %u), per block %u cyc/kB\n", test.filename, st.size,
+			whole/kb, old/kb, blocks/kb);
+	}
+}
+
+/* 
+
+ *Buffer cache test
+ * 
+ * Description: Checks hits, misses and LRU eviction on the primary ATA disk (qemu -hda)
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure, empties the buffer cache
+ * Coverage: ATA PIO reads, buffer cache lookup and eviction
+ * Files: ata.c/ata.h, bcache.c/bcache.h
+ */
+int bcache_test(){
+	TEST_HEADER;
+
+	uint8_t *first, *again;
+	uint32_t i, hits, misses, evictions;
+	if(ata_sectors() < (BCACHE_SIZE+1)*SECTORS_PER_BLOCK)
+		return FAIL;		//needs a disk of at least BCACHE_SIZE+1 blocks
+	bcache_init();
+	if((first = bcache_get(0)) == NULL)
+		return FAIL;
+	bcache_put(first);
+	if((again = bcache_get(0)) != first)
+		return FAIL;
+	bcache_put(again);
+	bcache_stats(&hits, &misses, &evictions);
+	if(hits != 1 || misses != 1 || evictions != 0)
+		return FAIL;
+
+	/* touching BCACHE_SIZE other blocks pushes block 0 out */
+	for(i=1; i<=BCACHE_SIZE; i++){
+		if((again = bcache_get(i)) == NULL)
+			return FAIL;
+		bcache_put(again);
+	}
+	if((again = bcache_get(0)) == NULL)
+		return FAIL;
+	bcache_put(again);
+	bcache_stats(&hits, &misses, &evictions);
+	if(hits != 1 || misses != BCACHE_SIZE+2 || evictions != 2)
+		return FAIL;
+	return PASS;
+}
+
+#define ATA_BENCH_BYTES	0x200000	//2MB, or the whole disk if it is smaller
+
+/* 
+
+ *Disk read benchmark
+ * 
+ * Description: Reads the start of the disk with PIO and then DMA, 64kB per command
+ * Inputs: NONE
+ * Outputs: NONE
+ * Side Effects: prints MB/s and how much of the time the CPU was kept busy for each
+ * Coverage: ATA PIO and bus master DMA reads
+ * Files: ata.c/ata.h
+ */
+void ata_bench(){
+	TEST_HEADER;
+
+	uint32_t mode, lba, total, cycles, slept, us;
+	uint32_t chunk = BENCH_BUF_SIZE/ATA_SECTOR_SIZE;
+	uint64_t start, sleep_start;
+	total = ata_sectors();
+	if(total == 0 || tsc_khz < 1000){
+		printf("ata_bench needs a disk and a calibrated TSC\n");
+		return;
+	}
+	if(total > ATA_BENCH_BYTES/ATA_SECTOR_SIZE)
+		total = ATA_BENCH_BYTES/ATA_SECTOR_SIZE;
+	total -= total % chunk;
+
+	for(mode=0; mode<2; mode++){
+		if(mode == 1 && !ata_dma_enabled()){
+			printf("DMA: no bus master IDE controller\n");
+			break;
+		}
+		sleep_start = ata_sleep_cycles();
+		start = rdtsc();
+		for(lba=0; lba<total; lba+=chunk){
+			if((mode == 0 ? ata_read_pio(lba, chunk, bench_buf) : ata_read_dma(lba, chunk, bench_buf)) == -1){
+				printf("read failed at sector %u\n", lba);
+				return;
+			}
+		}
+		cycles = (uint32_t)(rdtsc() - start);
+		slept = (uint32_t)(ata_sleep_cycles() - sleep_start);
+		us = cycles / (tsc_khz/1000);
+		if(us == 0)
+			us = 1;
+		printf("%s: %u kB in %u us, %u MB/s, CPU busy %u%%\n", mode == 0 ? "PIO" : "DMA",
+			total*ATA_SECTOR_SIZE/1024, us, total*ATA_SECTOR_SIZE/us, 100 - slept/(cycles/100 + 1));
+	}
+}
+
+/* 
+
+ *Shared data page test
+ * 
+ * Description: The vdso is mapped user read-only and follows the PIT through VDSO_ADDR
+ * Inputs: NONE
+ * Outputs: int
+ * Side Effects: PASS for success, FAIL for failure, needs interrupts on for the tick
+ * Coverage: vdso_init, vdso_page, vdso_tick
+ * Files: vdso.c/vdso.h, paging.c/paging.h
+ */
+int vdso_test(){
+	TEST_HEADER;
+
+	const vdso_t* vdso = (const vdso_t*)VDSO_ADDR;
+	uint32_t ticks;
+	if(!directory_entry_array[VDSO_INDEX].present || !directory_entry_array[VDSO_INDEX].user_super
+		|| vdso_table_entry_array[0].read_write || !vdso_table_entry_array[0].user_super)
+		return FAIL;
+	if(vdso->tick_hz != PIT_INPUT_HZ/PIT_FREQ || vdso->tsc_khz != tsc_khz)
+		return FAIL;
+	ticks = vdso->ticks;
+	while(vdso->ticks == ticks);		//the next PIT interrupt
+	if(vdso->ticks != pit_ticks || (vdso->seq & 1) != 0 || vdso->tick_tsc < vdso->boot_tsc)
+		return FAIL;
+	return PASS;
+}
+
 /* Checkpoint 3 tests */
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
@@ -473,4 +858,14 @@ void launch_tests(){
 	//filesys_test();
 	//filesys_test_index(10);
 	//filesys_test_directory();
+	//TEST_OUTPUT("filesys_stat_test", filesys_stat_test());
+	//TEST_OUTPUT("filesys_path_test", filesys_path_test());
+	//TEST_OUTPUT("filesys_fsmap_test", filesys_fsmap_test());
+	//TEST_OUTPUT("filesys_fsck_test", filesys_fsck_test());
+	//TEST_OUTPUT("lz4_test", lz4_test());
+	//TEST_OUTPUT("devfs_test", devfs_test());
+	//filesys_bench();
+	//TEST_OUTPUT("bcache_test", bcache_test());
+	//TEST_OUTPUT("vdso_test", vdso_test());
+	//ata_bench();
 }
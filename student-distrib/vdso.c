@@ -0,0 +1,68 @@
+#include "vdso.h"
+#include "lib.h"
+#include "paging.h"
+#include "pit.h"
+#include "sys_calls.h"
+
+//a whole page, so nothing else the kernel keeps shows through the mapping
+static union{
+	vdso_t data;
+	uint8_t page[KB_4];
+}vdso_area __attribute__((aligned(KB_4)));
+
+static vdso_t* const vdso = &vdso_area.data;
+
+
+/*
+ * vdso_init
+ *   DESCRIPTION: Fills in the page and maps it for every program
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: called once paging is on and the TSC is calibrated
+ */
+void vdso_init(void){
+	vdso->tick_hz = PIT_INPUT_HZ / PIT_FREQ;
+	vdso->tsc_khz = tsc_khz;
+	vdso->boot_tsc = rdtsc();
+	vdso->tick_tsc = vdso->boot_tsc;
+	vdso_page((uint32_t)&vdso_area);
+}
+
+/*
+ * vdso_tick
+ *   DESCRIPTION: Publishes a PIT tick, from the PIT handler
+ *   INPUTS: NONE
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: a program that was reading when the tick came in sees seq move
+ *								 and reads again
+ */
+void vdso_tick(void){
+	vdso->seq++;
+	vdso->ticks = pit_ticks;
+	vdso->tick_tsc = rdtsc();
+	vdso->seq++;
+}
+
+/*
+ * vdso_switch
+ *   DESCRIPTION: Shows the process or thread about to run. There is one page for
+ *								 everyone, but only the one on the CPU can be reading it.
+ *   INPUTS: uint32_t pid - the process or thread
+ *   OUTPUTS: NONE
+ *   RETURN VALUE: NONE
+ *   SIDE EFFECTS: NONE
+ */
+void vdso_switch(uint32_t pid){
+	pcb_t* pcb = get_pcb(pid);
+
+	if(pcb == NULL){
+		return;
+	}
+	vdso->seq++;
+	vdso->pid = pcb->leader;
+	vdso->tid = pid;
+	vdso->terminal = pcb->terminal;
+	vdso->seq++;
+}
@@ -0,0 +1,26 @@
+/* VDSO HEADER FILE */
+#ifndef _VDSO_H
+#define _VDSO_H
+
+#include "types.h"
+
+/* One page mapped read-only into every program at VDSO_ADDR, so reading the
+ * clock or its own pid costs a program a few loads instead of a trap.
+ * ece391_vdso_t in the user headers must match. */
+typedef struct{
+	volatile uint32_t seq;		//bumped before and after every update, odd in between
+	volatile uint32_t ticks;	//PIT interrupts since boot
+	volatile uint32_t tick_hz;	//PIT interrupts per second
+	volatile uint32_t tsc_khz;	//time-stamp counter ticks per millisecond
+	volatile uint64_t boot_tsc;	//time-stamp counter when it was calibrated
+	volatile uint64_t tick_tsc;	//time-stamp counter at the last PIT interrupt
+	volatile uint32_t pid;		//program on the CPU, as spawn and waitpid name it
+	volatile uint32_t tid;		//thread on the CPU, the same as pid for a first thread
+	volatile uint32_t terminal;	//terminal it runs on, 1 to 3
+}vdso_t;
+
+void vdso_init(void);
+void vdso_tick(void);
+void vdso_switch(uint32_t pid);
+
+#endif
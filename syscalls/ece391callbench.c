@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define DEFAULT_CALLS 100000
+#define MAX_CALLS 1000000
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Times calls that do nothing but enter and leave the kernel: close on a
+ * descriptor that cannot be open fails straight away */
+static void time_calls (const char* how, uint32_t calls, uint32_t khz)
+{
+    uint32_t i, us;
+    uint64_t start, cycles;
+
+    start = ece391_rdtsc ();
+    for (i = 0; i < calls; i++)
+        (void)ece391_close (-1);
+    cycles = ece391_rdtsc () - start;
+    us = ece391_tsc_us (cycles, khz);
+
+    ece391_fdputs (1, (uint8_t*)how);
+    ece391_fdputs (1, (uint8_t*)": ");
+    put_num (0 == (cycles >> 32) ? (uint32_t)cycles / calls : ((uint32_t)(cycles >> 10) / calls) << 10);
+    ece391_fdputs (1, (uint8_t*)" cycles, ");
+    put_num (us < 4000000 ? us * 1000 / calls : us / calls * 1000);
+    ece391_fdputs (1, (uint8_t*)" ns per call\n");
+}
+
+/* "callbench [n]" makes n null system calls through int $0x80, then n
+ * through SYSENTER if the CPU has it */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    const uint8_t* p = args;
+    uint32_t calls = DEFAULT_CALLS, khz;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+        calls = ece391_next_num (&p);
+        if (0 == calls || calls > MAX_CALLS)
+            calls = DEFAULT_CALLS;
+    }
+    if (0 == (khz = ece391_tsc_khz ())) {
+        ece391_fdputs (1, (uint8_t*)"the TSC is not calibrated\n");
+        return 2;
+    }
+
+    (void)ece391_fast_syscalls (0);
+    time_calls ("int $0x80", calls, khz);
+    if (ece391_fast_syscalls (1))
+        time_calls ("sysenter ", calls, khz);
+    else
+        ece391_fdputs (1, (uint8_t*)"sysenter : not on this CPU\n");
+    return 0;
+}
@@ -6,27 +6,37 @@
 int main ()
 {
     int32_t fd, cnt;
+    uint32_t left;
+    ece391_stat_t st;
     uint8_t buf[1024];
 
     if (0 != ece391_getargs (buf, 1024)) {
-        ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
-	return 3;
-    }
-
-    if (-1 == (fd = ece391_open (buf))) {
+        /* no file named, but stdin may be a pipe or a redirected file */
+        if (0 != ece391_fstat (0, &st) || 3 == st.filetype) {
+            ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
+	    return 3;
+        }
+        fd = 0;
+    } else if (-1 == (fd = ece391_open (buf))) {
         ece391_fdputs (1, (uint8_t*)"file not found\n");
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, 1024))) {
+    /* with the size known up front we can stop without a final empty read */
+    if (0 == ece391_fstat (fd, &st) && 2 == st.filetype)
+        left = st.size;
+    else
+        left = 0xFFFFFFFF;
+
+    while (0 != left && 0 != (cnt = ece391_read (fd, buf, left < 1024 ? left : 1024))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"file read failed\n");
 	    return 3;
 	}
 	if (-1 == ece391_write (1, buf, cnt))
 	    return 3;
+	left -= cnt;
     }
 
     return 0;
 }
-
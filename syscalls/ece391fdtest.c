@@ -0,0 +1,67 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+#define MANY_FDS 20
+
+static void put_num (int32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Opens more than the first 8 descriptors hold, so the table grows, then
+ * runs testprint with its stdout dup2'd onto a pipe and reads back what it
+ * wrote.  The read end is FD_CLOEXEC so testprint does not hold it too. */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t fds[MANY_FDS], pipe_fds[2], saved, opened, i, cnt, len = 0, bad = 0;
+
+    for (opened = 0; opened < MANY_FDS; opened++) {
+        if (-1 == (fds[opened] = ece391_open ((uint8_t*)".")))
+            break;
+    }
+    ece391_fdputs (1, (uint8_t*)"opened ");
+    put_num (opened);
+    ece391_fdputs (1, (uint8_t*)" descriptors, the last is ");
+    put_num (opened > 0 ? fds[opened - 1] : -1);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    if (MANY_FDS != opened)
+        bad++;
+    for (i = 0; i < opened; i++)
+        (void)ece391_close (fds[i]);
+
+    if (-1 == ece391_pipe (pipe_fds) || -1 == (saved = ece391_dup (1))) {
+        ece391_fdputs (1, (uint8_t*)"could not make a pipe\n");
+        return 2;
+    }
+    (void)ece391_fcntl (pipe_fds[0], F_SETFD, FD_CLOEXEC);
+    (void)ece391_fcntl (saved, F_SETFD, FD_CLOEXEC);
+    if (FD_CLOEXEC != ece391_fcntl (pipe_fds[0], F_GETFD, 0))
+        bad++;
+
+    /* testprint's stdout is the pipe; once it halts only we hold the write end */
+    (void)ece391_dup2 (pipe_fds[1], 1);
+    (void)ece391_close (pipe_fds[1]);
+    if (0 != ece391_execute ((uint8_t*)"testprint"))
+        bad++;
+    (void)ece391_dup2 (saved, 1);
+    (void)ece391_close (saved);
+
+    while (len < BUFSIZE - 1 && 0 < (cnt = ece391_read (pipe_fds[0], buf + len, BUFSIZE - 1 - len)))
+        len += cnt;
+    buf[len] = '\0';
+    (void)ece391_close (pipe_fds[0]);
+
+    ece391_fdputs (1, (uint8_t*)"testprint wrote ");
+    put_num (len);
+    ece391_fdputs (1, (uint8_t*)" bytes into the pipe: ");
+    ece391_fdputs (1, buf);
+    if (0 == len)
+        bad++;
+    return 0 == bad ? 0 : 3;
+}
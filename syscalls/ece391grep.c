@@ -5,18 +5,71 @@
 
 #define BUFSIZE 1024
 #define SBUFSIZE 33
+#define ONEPASS_MAX 65536
+#define NUM_DIRENTS 16
 
-int32_t
-do_one_file (const char* s, const char* fname) 
+static int32_t
+search_line (const char* s, int32_t s_len, const char* fname, uint8_t* line, int32_t len)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
-    uint8_t data[BUFSIZE+1];
+    int32_t check;
+
+    for (check = 0; check < len; check++) {
+	if (s[0] == line[check] && 
+	    0 == ece391_strncmp ((uint8_t*)(line + check), (uint8_t*)s, s_len)) {
+	    if (0 != fname) {
+	        ece391_fdputs (1, (uint8_t*)fname);
+	        ece391_fdputs (1, (uint8_t*)":");
+	    }
+	    ece391_fdputs (1, line);
+	    ece391_fdputs (1, (uint8_t*)"\n");
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/* 
+ * The file size is known from fstat, so read the whole file into one
+ * buffer and scan it in a single pass instead of shuffling partial lines.
+ */
+static int32_t
+do_whole_file (int32_t fd, const char* s, const char* fname, uint32_t size)
+{
+    int32_t cnt, line_start, line_end, s_len;
+    uint32_t got;
+    uint8_t data[ONEPASS_MAX+1];
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
+    for (got = 0; got < size; got += cnt) {
+        cnt = ece391_read (fd, data + got, size - got);
+	if (-1 == cnt) {
+            ece391_fdputs (1, (uint8_t*)"file read failed\n");
+            return -1;
+	}
+	if (0 == cnt)
+	    break;
+    }
+    for (line_start = 0; line_start < (int32_t)got; line_start = line_end + 1) {
+        line_end = line_start;
+	while (line_end < (int32_t)got && '\n' != data[line_end])
+	    line_end++;
+	data[line_end] = '\0';
+	search_line (s, s_len, fname, data + line_start, line_end - line_start);
     }
+    return 0;
+}
+
+/* 
+ * Search whatever fd yields, a buffer at a time, until a read returns 0.
+ * Lines are printed without a file name when fname is 0.
+ */
+static int32_t
+do_stream (int32_t fd, const char* s, const char* fname)
+{
+    int32_t cnt, last, line_start, line_end, s_len;
+    uint8_t data[BUFSIZE+1];
+
+    s_len = ece391_strlen ((uint8_t*)s);
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -30,6 +83,9 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
+	    /* a pipe can hand over part of a line, read the rest behind it */
+	    if (line_end == last && 0 != cnt && 0 == line_start && last < BUFSIZE)
+		break;
 	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
 		/* copy from line_start to last down to 0 and fix last */
 		data[line_end] = '\0';
@@ -39,16 +95,7 @@ do_one_file (const char* s, const char* fname)
 	    }
 	    /* search the line */
 	    data[line_end] = '\0';
-	    for (check = line_start; check < line_end; check++) {
-		if (s[0] == data[check] && 
-		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
-		    break;
-		}
-	    }
+	    search_line (s, s_len, fname, data + line_start, line_end - line_start);
 	    line_start = line_end + 1;
 	    if (line_start >= last) {
 	        last = 0;
@@ -58,6 +105,24 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+    ece391_stat_t st;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (0 == ece391_fstat (fd, &st) && st.size <= ONEPASS_MAX) {
+        if (0 != do_whole_file (fd, s, fname, st.size))
+	    return -1;
+    } else if (0 != do_stream (fd, s, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -67,30 +132,40 @@ do_one_file (const char* s, const char* fname)
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i, j;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    ece391_dirent_t ents[NUM_DIRENTS];
+    ece391_stat_t st;
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
         return 3;
     }
 
+    /* fed by a pipe or a redirected file, search that instead of every file */
+    if (0 == ece391_fstat (0, &st) && 3 != st.filetype)
+        return 0 == do_stream (0, (char*)search, 0) ? 0 : 3;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	    return 3;
 	}
-	if ('.' == buf[0]) /* a directory... */
-	    continue;
-	buf[cnt] = '\0';
-	if (0 != do_one_file ((char*)search, (char*)buf))
-	    return 3;
+	for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	    if (2 != ents[i].filetype) /* a directory or device... */
+	        continue;
+	    for (j = 0; j < ents[i].name_len; j++)
+	        buf[j] = ents[i].name[j];
+	    buf[j] = '\0';
+	    if (0 != do_one_file ((char*)search, (char*)buf))
+	        return 3;
+	}
     }
 
     return 0;
@@ -0,0 +1,115 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define THREADS 2       /* besides main; the base shells leave few slots */
+#define ROUNDS 20000
+#define HOLD 50         /* busy work inside the lock, so ticks land there */
+#define ITEMS 500
+
+static ece391_mutex_t lock;
+static volatile uint32_t counter;
+
+/* one slot passed from main to the consumer thread */
+static ece391_mutex_t slot_lock;
+static ece391_cond_t slot_filled, slot_emptied;
+static volatile uint32_t slot, full;
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Adds to the counter a read and a write apart, which only comes out
+ * right if the mutex keeps the others out in between */
+static int32_t adder (void* arg)
+{
+    uint32_t i, v;
+    volatile uint32_t spin;
+
+    for (i = 0; i < ROUNDS; i++) {
+        ece391_mutex_lock (&lock);
+        v = counter;
+        for (spin = 0; spin < HOLD; spin++);
+        counter = v + 1;
+        ece391_mutex_unlock (&lock);
+    }
+    return 0;
+}
+
+/* Takes ITEMS values out of the slot and halts with their sum */
+static int32_t consumer (void* arg)
+{
+    uint32_t i, sum = 0;
+
+    for (i = 0; i < ITEMS; i++) {
+        ece391_mutex_lock (&slot_lock);
+        while (!full)
+            ece391_cond_wait (&slot_filled, &slot_lock);
+        sum += slot;
+        full = 0;
+        ece391_cond_signal (&slot_emptied);
+        ece391_mutex_unlock (&slot_lock);
+    }
+    return sum;
+}
+
+/* Runs the adders alongside main against one mutex, then hands numbers to
+ * a consumer thread one at a time through a condition variable */
+int main ()
+{
+    int32_t tids[THREADS], tid, status;
+    uint32_t i, started, sum, khz;
+    uint64_t start;
+
+    khz = ece391_tsc_khz ();
+    start = ece391_rdtsc ();
+    for (started = 0; started < THREADS; started++) {
+        if (-1 == (tids[started] = ece391_thread_create (adder, 0)))
+            break;
+    }
+    (void)adder (0);
+    for (i = 0; i < started; i++)
+        (void)ece391_thread_join (tids[i], &status);
+
+    put_num (counter);
+    ece391_fdputs (1, (uint8_t*)" of ");
+    put_num ((started + 1) * ROUNDS);
+    ece391_fdputs (1, (uint8_t*)" increments by ");
+    put_num (started + 1);
+    ece391_fdputs (1, (uint8_t*)" threads");
+    if (0 != khz) {
+        ece391_fdputs (1, (uint8_t*)" in ");
+        put_num (ece391_tsc_us (ece391_rdtsc () - start, khz) / 1000);
+        ece391_fdputs (1, (uint8_t*)" ms");
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+    if (counter != (started + 1) * ROUNDS)
+        return 3;
+
+    if (-1 == (tid = ece391_thread_create (consumer, 0))) {
+        ece391_fdputs (1, (uint8_t*)"could not start a thread\n");
+        return 2;
+    }
+    for (sum = 0, i = 1; i <= ITEMS; i++) {
+        ece391_mutex_lock (&slot_lock);
+        while (full)
+            ece391_cond_wait (&slot_emptied, &slot_lock);
+        slot = i;
+        full = 1;
+        sum += i;
+        ece391_cond_signal (&slot_filled);
+        ece391_mutex_unlock (&slot_lock);
+    }
+    (void)ece391_thread_join (tid, &status);
+
+    ece391_fdputs (1, (uint8_t*)"consumer summed ");
+    put_num (status);
+    ece391_fdputs (1, (uint8_t*)", sent ");
+    put_num (sum);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return (uint32_t)status == sum ? 0 : 3;
+}
@@ -4,25 +4,51 @@
 #include "ece391syscall.h"
 
 #define SBUFSIZE 33
+#define NUM_DIRENTS 16
+
+/* List the root from the mapped directory table, no call per entry */
+static int32_t ls_fsmap (const ece391_fsmap_t* map)
+{
+    int32_t i, j;
+    uint8_t buf[SBUFSIZE];
+
+    for (i = 0; i < (int32_t)map->dir_count && i < ECE391_FSMAP_DENTRIES; i++) {
+        for (j = 0; j < 32 && '\0' != map->dentries[i].name[j]; j++)
+            buf[j] = map->dentries[i].name[j];
+        buf[j] = '\n';
+        if (-1 == ece391_write (1, buf, j + 1))
+            return 3;
+    }
+    return 0;
+}
 
 int main ()
 {
-    int32_t fd, cnt;
+    int32_t fd, cnt, i, j;
     uint8_t buf[SBUFSIZE];
+    ece391_dirent_t ents[NUM_DIRENTS];
+    const ece391_fsmap_t* map;
+
+    if (0 == ece391_fsmap (&map))
+        return ls_fsmap (map);
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, ents, sizeof (ents)))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
-	        return 3;
+	    for (i = 0; i < cnt / (int32_t)sizeof (ece391_dirent_t); i++) {
+	        for (j = 0; j < ents[i].name_len; j++)
+	            buf[j] = ents[i].name[j];
+	        buf[ents[i].name_len] = '\n';
+	        if (-1 == ece391_write (1, buf, ents[i].name_len + 1))
+	            return 3;
+	    }
     }
 
     return 0;
@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TOTAL (16 * 1024 * 1024)
+#define MAX_CHUNK 4096
+
+static uint8_t buf[MAX_CHUNK];
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Pushes TOTAL bytes through a pipe in chunks of each size, writing a
+ * chunk and reading it back, and prints the rate and the cost per call */
+int main ()
+{
+    static const uint32_t chunks[] = {64, 512, MAX_CHUNK};
+    int32_t fds[2], got, cnt;
+    uint32_t c, i, khz, us, calls;
+    uint64_t start;
+
+    if (0 == (khz = ece391_tsc_khz ())) {
+        ece391_fdputs (1, (uint8_t*)"the TSC is not calibrated\n");
+        return 2;
+    }
+    if (-1 == ece391_pipe (fds)) {
+        ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+        return 2;
+    }
+
+    for (c = 0; c < sizeof (chunks) / sizeof (chunks[0]); c++) {
+        start = ece391_rdtsc ();
+        for (i = 0; i < TOTAL / chunks[c]; i++) {
+            if (chunks[c] != (uint32_t)ece391_write (fds[1], buf, chunks[c]))
+                return 3;
+            for (got = 0; got < (int32_t)chunks[c]; got += cnt) {
+                if (0 >= (cnt = ece391_read (fds[0], buf + got, chunks[c] - got)))
+                    return 3;
+            }
+        }
+        us = ece391_tsc_us (ece391_rdtsc () - start, khz);
+        if (0 == us)
+            us = 1;
+
+        ece391_fdputs (1, (uint8_t*)"chunk ");
+        put_num (chunks[c]);
+        ece391_fdputs (1, (uint8_t*)": ");
+        put_num ((TOTAL / 1024) * 1000 / us);
+        ece391_fdputs (1, (uint8_t*)" MB/s, ");
+        calls = 2 * (TOTAL / chunks[c]);
+        put_num (us < 4000000 ? us * 1000 / calls : us / calls * 1000);
+        ece391_fdputs (1, (uint8_t*)" ns per call\n");
+    }
+
+    ece391_close (fds[0]);
+    ece391_close (fds[1]);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define TICK_HZ 4
+#define IDLE_TICKS 40	/* 10 seconds without a line */
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* An event loop on stdin and a 4 Hz RTC at once: a dot per tick, each
+ * line typed is echoed with the ticks so far, and it stops on "quit" or
+ * after IDLE_TICKS ticks without a line */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    ece391_pollfd_t fds[2];
+    int32_t rtc, rate = TICK_HZ, cnt;
+    uint32_t ticks = 0, idle = 0;
+
+    if (-1 == (rtc = ece391_open ((uint8_t*)"/dev/rtc"))
+        || -1 == ece391_write (rtc, &rate, sizeof (rate))) {
+        ece391_fdputs (1, (uint8_t*)"could not open /dev/rtc\n");
+        return 2;
+    }
+    fds[0].fd = 0;
+    fds[0].events = ECE391_POLLIN;
+    fds[1].fd = rtc;
+    fds[1].events = ECE391_POLLIN;
+
+    ece391_fdputs (1, (uint8_t*)"type a line, or quit\n");
+    while (1) {
+        if (0 >= ece391_poll (fds, 2, -1)) {
+            ece391_fdputs (1, (uint8_t*)"poll failed\n");
+            return 3;
+        }
+        if (fds[1].revents & ECE391_POLLIN) {
+            (void)ece391_read (rtc, &rate, sizeof (rate));
+            ticks++;
+            ece391_fdputs (1, (uint8_t*)".");
+            if (++idle == IDLE_TICKS) {
+                ece391_fdputs (1, (uint8_t*)"\nidle, stopping\n");
+                break;
+            }
+        }
+        if (fds[0].revents & ECE391_POLLIN) {
+            if (-1 == (cnt = ece391_read (0, buf, BUFSIZE - 1)))
+                return 3;
+            if (cnt > 0 && '\n' == buf[cnt - 1])
+                cnt--;
+            buf[cnt] = '\0';
+            idle = 0;
+            if (0 == ece391_strcmp (buf, (uint8_t*)"quit"))
+                break;
+            ece391_fdputs (1, (uint8_t*)"\n");
+            put_num (ticks);
+            ece391_fdputs (1, (uint8_t*)" ticks: ");
+            ece391_fdputs (1, buf);
+            ece391_fdputs (1, (uint8_t*)"\n");
+        }
+    }
+    ece391_close (rtc);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+/* Lists the running processes, one read of /proc/ps */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t len;
+
+    if (-1 == (len = ece391_read_file ((uint8_t*)"/proc/ps", buf, BUFSIZE))) {
+        ece391_fdputs (1, (uint8_t*)"could not read /proc/ps\n");
+        return 2;
+    }
+    if (-1 == ece391_write (1, buf, len))
+        return 3;
+    return 0;
+}
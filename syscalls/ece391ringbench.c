@@ -0,0 +1,91 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "ece391sysnum.h"
+
+#define BUFSIZE 128
+#define CHUNK 16            /* a small write, like a line to the terminal */
+#define DEFAULT_CALLS 65536
+#define MAX_CALLS 1048576
+
+static ece391_ring_t ring;
+static uint8_t buf[CHUNK];
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+static void report (const char* how, uint32_t calls, uint32_t traps, uint64_t cycles, uint32_t khz)
+{
+    uint32_t ms = ece391_tsc_us (cycles, khz) / 1000;
+
+    if (0 == ms)
+        ms = 1;
+    ece391_fdputs (1, (uint8_t*)how);
+    ece391_fdputs (1, (uint8_t*)": ");
+    put_num (calls * 1000 / ms);    /* calls is at most MAX_CALLS */
+    ece391_fdputs (1, (uint8_t*)" calls/s, ");
+    put_num (calls / traps);
+    ece391_fdputs (1, (uint8_t*)" per trap\n");
+}
+
+/* "ringbench [n]" makes n small calls, half writes to /dev/null and half
+ * reads of /dev/zero, first one trap each and then in batches on a ring */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    const uint8_t* p = args;
+    uint32_t calls = DEFAULT_CALLS, khz, i, traps;
+    int32_t null_fd, zero_fd, n;
+    ece391_cqe_t cqe;
+    uint64_t start;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+        calls = ece391_next_num (&p);
+        if (0 == calls || calls > MAX_CALLS)
+            calls = DEFAULT_CALLS;
+    }
+    calls -= calls % ECE391_RING_ENTRIES;
+    if (0 == calls)
+        calls = ECE391_RING_ENTRIES;
+    if (0 == (khz = ece391_tsc_khz ())) {
+        ece391_fdputs (1, (uint8_t*)"the TSC is not calibrated\n");
+        return 2;
+    }
+    if (-1 == (null_fd = ece391_open ((uint8_t*)"/dev/null")) ||
+        -1 == (zero_fd = ece391_open ((uint8_t*)"/dev/zero"))) {
+        ece391_fdputs (1, (uint8_t*)"could not open /dev/null and /dev/zero\n");
+        return 2;
+    }
+
+    start = ece391_rdtsc ();
+    for (i = 0; i < calls; i += 2) {
+        if (CHUNK != ece391_write (null_fd, buf, CHUNK) ||
+            CHUNK != ece391_read (zero_fd, buf, CHUNK))
+            return 3;
+    }
+    report ("one trap each", calls, calls, ece391_rdtsc () - start, khz);
+
+    start = ece391_rdtsc ();
+    for (traps = 0, i = 0; i < calls; traps++) {
+        for (n = 0; n < ECE391_RING_ENTRIES; n += 2) {
+            (void)ece391_ring_queue (&ring, SYS_WRITE, null_fd, buf, CHUNK, i + n);
+            (void)ece391_ring_queue (&ring, SYS_READ, zero_fd, buf, CHUNK, i + n + 1);
+        }
+        if (ECE391_RING_ENTRIES != ece391_ring_enter (&ring))
+            return 3;
+        while (ece391_ring_reap (&ring, &cqe)) {
+            if (CHUNK != cqe.result || cqe.user_data != i++)
+                return 3;
+        }
+    }
+    report ("ring", calls, traps, ece391_rdtsc () - start, khz);
+
+    ece391_close (null_fd);
+    ece391_close (zero_fd);
+    return 0;
+}
@@ -4,14 +4,342 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define NAMESIZE 64
+#define PROCSIZE 512
+/* the kernel has six processes, and the three terminal shells keep theirs */
+#define MAX_STAGES 3
+#define MAX_JOBS 4
+
+/* A pipeline left running with &, one pid per stage.  Stages already
+ * reaped are -1, and the slot is free when n_stages is 0. */
+typedef struct job {
+    int32_t pids[MAX_STAGES];
+    int32_t n_stages;
+    uint8_t name[NAMESIZE];
+} job_t;
+
+static job_t jobs[MAX_JOBS];
+static const ece391_fsmap_t* map;
+
+static void
+put_num (int32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Drops the spaces at the end of s. */
+static void
+trim (uint8_t* s)
+{
+    int32_t end;
+
+    for (end = ece391_strlen (s); end > 0 && ' ' == s[end - 1]; end--);
+    s[end] = '\0';
+}
+
+/* Unknown commands are caught before any pipe is made.  The map only
+ * holds the root directory, so a path is left to execute and a name the
+ * map does not have (it may be from before a remount) goes to stat.
+ * Returns 0 only if the kernel has no such file either. */
+static int32_t
+known_command (uint8_t* cmd)
+{
+    int32_t i, rval;
+    uint8_t save;
+    ece391_stat_t st;
+
+    while (' ' == *cmd)
+        cmd++;
+    for (i = 0; '\0' != cmd[i] && ' ' != cmd[i]; i++) {
+        if ('/' == cmd[i])
+            return 1;
+    }
+    save = cmd[i];
+    cmd[i] = '\0';
+    rval = -1 != ece391_fsmap_lookup (map, cmd) || 0 == ece391_stat (cmd, &st);
+    cmd[i] = save;
+    return rval;
+}
+
+static const uint8_t*
+next_line (const uint8_t* p)
+{
+    while ('\0' != *p && '\n' != *p)
+        p++;
+    return '\n' == *p ? p + 1 : p;
+}
+
+/* Processes that can still be started: frames_total in /proc/meminfo less
+ * a line of /proc/ps for each process, thread or zombie.  A pipeline that
+ * could not all start is refused before any of it runs.  Without /proc
+ * it is MAX_STAGES, and spawn reports what does not fit. */
+static int32_t
+free_slots ()
+{
+    uint8_t buf[PROCSIZE];
+    const uint8_t* p;
+    int32_t total = MAX_STAGES, used;
+
+    if (-1 == ece391_read_file ((uint8_t*)"/proc/meminfo", buf, PROCSIZE))
+        return MAX_STAGES;
+    for (p = buf; '\0' != *p; p = next_line (p)) {
+        if (0 == ece391_strncmp (p, (uint8_t*)"frames_total ", 13))
+            total = ece391_next_num (&p);
+    }
+    if (-1 == ece391_read_file ((uint8_t*)"/proc/ps", buf, PROCSIZE))
+        return MAX_STAGES;
+    /* after a header line */
+    for (used = 0, p = next_line (buf); '\0' != *p; p = next_line (p))
+        used++;
+    return total - used;
+}
+
+/* Finds "op file" in a stage, copies the file name out and blanks both
+ * from the stage so only the command is left.  Returns 1 if it was there,
+ * 0 if not and -1 if op has no file name after it. */
+static int32_t
+take_redirect (uint8_t* stage, uint8_t op, uint8_t* file)
+{
+    int32_t i, j;
+
+    for (i = 0; '\0' != stage[i] && op != stage[i]; i++);
+    if ('\0' == stage[i])
+        return 0;
+    stage[i++] = ' ';
+    while (' ' == stage[i])
+        i++;
+    for (j = 0; j < NAMESIZE - 1 && '\0' != stage[i] && ' ' != stage[i] &&
+         '<' != stage[i] && '>' != stage[i]; i++, j++) {
+        file[j] = stage[i];
+        stage[i] = ' ';
+    }
+    file[j] = '\0';
+    return 0 == j ? -1 : 1;
+}
+
+/* The same messages execute's return value has always produced. */
+static void
+report_status (int32_t rval)
+{
+    if (-1 == rval)
+        ece391_fdputs (1, (uint8_t*)"no such command\n");
+    else if (256 == rval)
+        ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
+    else if (0 != rval)
+        ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+}
+
+static void
+report_job (int32_t j, const char* what)
+{
+    ece391_fdputs (1, (uint8_t*)"[");
+    put_num (j + 1);
+    ece391_fdputs (1, (uint8_t*)"] ");
+    ece391_fdputs (1, (uint8_t*)what);
+    ece391_fdputs (1, (uint8_t*)"  ");
+    ece391_fdputs (1, jobs[j].name);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* Reaps the stages of background jobs that have halted, without blocking,
+ * and reports each job whose stages are all done. */
+static void
+check_jobs ()
+{
+    int32_t j, i, left;
+
+    for (j = 0; j < MAX_JOBS; j++) {
+        if (0 == jobs[j].n_stages)
+            continue;
+        for (left = 0, i = 0; i < jobs[j].n_stages; i++) {
+            if (-1 == jobs[j].pids[i])
+                continue;
+            if (0 == ece391_waitpid (jobs[j].pids[i], 0, WNOHANG))
+                left++;
+            else
+                jobs[j].pids[i] = -1;
+        }
+        if (0 == left) {
+            report_job (j, "done");
+            jobs[j].n_stages = 0;
+        }
+    }
+}
+
+static void
+list_jobs ()
+{
+    int32_t j;
+
+    check_jobs ();
+    for (j = 0; j < MAX_JOBS; j++) {
+        if (0 != jobs[j].n_stages)
+            report_job (j, "running");
+    }
+}
+
+static void
+wait_jobs ()
+{
+    int32_t j, i;
+
+    for (j = 0; j < MAX_JOBS; j++) {
+        if (0 == jobs[j].n_stages)
+            continue;
+        for (i = 0; i < jobs[j].n_stages; i++) {
+            if (-1 != jobs[j].pids[i])
+                (void)ece391_waitpid (jobs[j].pids[i], 0, 0);
+        }
+        report_job (j, "done");
+        jobs[j].n_stages = 0;
+    }
+}
+
+/*
+ * Runs "stage | stage ... < in &".  Every stage is spawned with its
+ * stdin and stdout wired up, so they all run at once; without the & the
+ * shell waits for all of them before the next prompt.  There is no
+ * "> out", the file system cannot be written.
+ */
+static void
+run_pipeline (uint8_t* line)
+{
+    uint8_t* stages[MAX_STAGES];
+    uint8_t in_name[NAMESIZE];
+    int32_t pids[MAX_STAGES];
+    int32_t n, i, j, k, bg, end, in, out, has_in, fds[2], status;
+
+    /* a trailing & leaves the pipeline running in the background */
+    trim (line);
+    if ('\0' == line[0])
+        return;
+    end = ece391_strlen (line);
+    bg = (end > 0 && '&' == line[end - 1]);
+    if (bg) {
+        line[end - 1] = '\0';
+        trim (line);
+        for (j = 0; j < MAX_JOBS && 0 != jobs[j].n_stages; j++);
+        if (MAX_JOBS == j) {
+            ece391_fdputs (1, (uint8_t*)"too many jobs\n");
+            return;
+        }
+        for (i = 0; i < NAMESIZE - 1 && '\0' != line[i]; i++)
+            jobs[j].name[i] = line[i];
+        jobs[j].name[i] = '\0';
+    }
+
+    for (n = 1, stages[0] = line, i = 0; '\0' != line[i]; i++) {
+        if ('|' != line[i])
+            continue;
+        if (MAX_STAGES == n) {
+            ece391_fdputs (1, (uint8_t*)"too many stages\n");
+            return;
+        }
+        line[i] = '\0';
+        stages[n++] = line + i + 1;
+    }
+
+    /* only the first stage reads a file, none can write one */
+    has_in = take_redirect (stages[0], '<', in_name);
+    for (i = 0; i < n; i++) {
+        trim (stages[i]);
+        for (j = 0; '\0' != stages[i][j] && '>' != stages[i][j]; j++);
+        if ('\0' != stages[i][j]) {
+            ece391_fdputs (1, (uint8_t*)"cannot redirect output, the file system is read-only\n");
+            return;
+        }
+        for (j = 0; '\0' != stages[i][j] && '<' != stages[i][j]; j++);
+        if (-1 == has_in || '\0' != stages[i][j]) {
+            ece391_fdputs (1, (uint8_t*)"bad redirection\n");
+            return;
+        }
+        if ('\0' == stages[i][0]) {
+            ece391_fdputs (1, (uint8_t*)"empty command\n");
+            return;
+        }
+        if (!known_command (stages[i])) {
+            ece391_fdputs (1, (uint8_t*)"no such command\n");
+            return;
+        }
+    }
+
+    if (n > free_slots ()) {
+        ece391_fdputs (1, (uint8_t*)"not enough free processes\n");
+        return;
+    }
+
+    /* one stage, no redirection, in the foreground: the terminal is its own */
+    if (1 == n && !bg && !has_in) {
+        report_status (ece391_execute (stages[0]));
+        return;
+    }
+
+    in = 0;
+    if (has_in && -1 == (in = ece391_open (in_name))) {
+        ece391_fdputs (1, (uint8_t*)"file not found\n");
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        if (i < n - 1) {
+            if (-1 == ece391_pipe (fds)) {
+                ece391_fdputs (1, (uint8_t*)"could not make a pipe\n");
+                break;
+            }
+            /* only the stages wired to them should hold the ends */
+            (void)ece391_fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+            (void)ece391_fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+            out = fds[1];
+        } else
+            out = 1;
+        pids[i] = ece391_spawn (stages[i], in, out);
+        /* the stages hold their own copies of the ends now */
+        if (0 != in)
+            (void)ece391_close (in);
+        if (1 != out)
+            (void)ece391_close (out);
+        in = (i < n - 1) ? fds[0] : 0;
+        if (-1 == pids[i]) {
+            ece391_fdputs (1, (uint8_t*)"could not start a process\n");
+            break;
+        }
+    }
+    if (0 != in)
+        (void)ece391_close (in);
+
+    /* the stages that did start see their pipes close and finish */
+    if (bg && i > 0) {
+        for (j = 0; 0 != jobs[j].n_stages; j++);
+        for (k = 0; k < i; k++)
+            jobs[j].pids[k] = pids[k];
+        jobs[j].n_stages = i;
+        ece391_fdputs (1, (uint8_t*)"[");
+        put_num (j + 1);
+        ece391_fdputs (1, (uint8_t*)"]");
+        for (k = 0; k < i; k++) {
+            ece391_fdputs (1, (uint8_t*)" ");
+            put_num (pids[k]);
+        }
+        ece391_fdputs (1, (uint8_t*)"\n");
+        return;
+    }
+    for (status = 0, j = 0; j < i; j++)
+        (void)ece391_waitpid (pids[j], &status, 0);
+    if (i == n)
+        report_status (status);
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt;
     uint8_t buf[BUFSIZE];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
+    if (-1 == ece391_fsmap (&map))
+        map = 0;
 
     while (1) {
+        check_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -22,15 +350,16 @@ int main ()
 	buf[cnt] = '\0';
 	if (0 == ece391_strcmp (buf, (uint8_t*)"exit"))
 	    return 0;
+	if (0 == ece391_strcmp (buf, (uint8_t*)"jobs")) {
+	    list_jobs ();
+	    continue;
+	}
+	if (0 == ece391_strcmp (buf, (uint8_t*)"wait")) {
+	    wait_jobs ();
+	    continue;
+	}
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
-	if (-1 == rval)
-	    ece391_fdputs (1, (uint8_t*)"no such command\n");
-	else if (256 == rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
-	else if (0 != rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+	run_pipeline (buf);
     }
 }
-
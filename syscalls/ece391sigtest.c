@@ -4,11 +4,39 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define ALARM_MS 250
+#define PRIME_LIMIT 150000
 
 static uint8_t charbuf;
 static volatile uint8_t* badbuf = 0;
+static volatile uint32_t alarms;
 void segfault_sighandler (int signum);
 void alarm_sighandler (int signum);
+void tick_sighandler (int signum);
+
+/* "sigtest 2": counts primes while ALARM, not a loop on the RTC, marks
+ * the time going by */
+static int32_t
+alarm_test ()
+{
+    uint32_t n, d, count = 0;
+    uint8_t num[12];
+
+    ece391_set_handler (ALARM, tick_sighandler);
+    ece391_alarm (ALARM_MS);
+    for (n = 2; n < PRIME_LIMIT; n++) {
+        for (d = 2; d * d <= n && 0 != n % d; d++);
+        if (d * d > n)
+            count++;
+    }
+    ece391_alarm (0);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    ece391_fdputs (1, ece391_itoa (count, num, 10));
+    ece391_fdputs (1, (uint8_t*)" primes, ");
+    ece391_fdputs (1, ece391_itoa (alarms, num, 10));
+    ece391_fdputs (1, (uint8_t*)" alarms\n");
+    return 0;
+}
 
 int main ()
 {
@@ -20,6 +48,8 @@ int main ()
 	return 3;
     }
 
+	if (buf[0] == '2')
+		return alarm_test ();
 	if (buf[0] == '1') {
 		ece391_fdputs(1, (uint8_t*)"Installing signal handlers\n");
 		ece391_set_handler(SEGFAULT, segfault_sighandler);
@@ -79,3 +109,10 @@ alarm_sighandler (int signum)
         default: ece391_fdputs(1, (uint8_t*)"invalid\n"); break;
     }
 }
+
+void
+tick_sighandler (int signum)
+{
+    alarms++;
+    ece391_fdputs (1, (uint8_t*)".");
+}
@@ -102,3 +102,237 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* Index of the root entry called name, or -1.  Like the kernel, only the
+ * first 32 characters of a name count. */
+int32_t ece391_fsmap_lookup(const ece391_fsmap_t* map, const uint8_t* name)
+{
+    int32_t i;
+
+    if (map == 0 || name == 0 || '\0' == name[0])
+        return -1;
+    for (i = 0; i < (int32_t)map->dir_count && i < ECE391_FSMAP_DENTRIES; i++) {
+        if (0 == ece391_strncmp (map->dentries[i].name, name, 32))
+            return i;
+    }
+    return -1;
+}
+
+/* Size in bytes of the index'th root entry: the inode length for regular
+ * files, 0 for everything else or an inode past the mapped lengths. */
+int32_t ece391_fsmap_size(const ece391_fsmap_t* map, int32_t index)
+{
+    int32_t inode;
+
+    if (map == 0 || index < 0 || index >= (int32_t)map->dir_count)
+        return 0;
+    inode = map->dentries[index].inode;
+    if (2 != map->dentries[index].filetype || inode < 0 || inode >= (int32_t)map->inode_count)
+        return 0;
+    return map->i_length[inode];
+}
+
+/* Reads a whole small file, such as one under /proc, into buf and
+ * terminates it.  Returns the length or -1. */
+int32_t ece391_read_file(const uint8_t* name, uint8_t* buf, int32_t size)
+{
+    int32_t fd, cnt, len = 0;
+
+    if (size <= 0 || -1 == (fd = ece391_open (name)))
+        return -1;
+    while (len < size - 1 && 0 < (cnt = ece391_read (fd, buf + len, size - 1 - len)))
+        len += cnt;
+    (void)ece391_close (fd);
+    buf[len] = '\0';
+    return len;
+}
+
+/* Parses the next decimal number at or after *p and moves *p past it.
+ * Returns 0 when there are no more digits on the line. */
+uint32_t ece391_next_num(const uint8_t** p)
+{
+    uint32_t n = 0;
+
+    while ('\0' != **p && '\n' != **p && (**p < '0' || **p > '9'))
+        (*p)++;
+    while (**p >= '0' && **p <= '9')
+        n = n * 10 + *(*p)++ - '0';
+    return n;
+}
+
+/* Time-stamp counter, for benchmarks */
+uint64_t ece391_rdtsc(void)
+{
+    uint64_t t;
+
+    asm volatile ("rdtsc" : "=A" (t));
+    return t;
+}
+
+/* Time-stamp counter ticks per millisecond, or 0 if it was not calibrated */
+uint32_t ece391_tsc_khz(void)
+{
+    return ece391_vdso ()->tsc_khz;
+}
+
+/* Microseconds in a count of time-stamp counter ticks.  There is no
+ * 64-bit division here, so this drops the low 10 bits of both. */
+uint32_t ece391_tsc_us(uint64_t cycles, uint32_t khz)
+{
+    uint32_t c = (uint32_t)(cycles >> 10);
+    uint32_t k = khz >> 10;
+
+    if (0 == k)
+        return 0;
+    if (c < 0xFFFFFFFF / 1000)
+        return c * 1000 / k;
+    return c / k * 1000;
+}
+
+/* Queues one call on the ring.  Returns 0, or -1 if the submission queue
+ * is full. */
+int32_t ece391_ring_queue(ece391_ring_t* ring, uint32_t op, int32_t fd, const void* buf,
+                          int32_t nbytes, uint32_t user_data)
+{
+    ece391_sqe_t* sqe;
+
+    if (ring->sq_tail - ring->sq_head >= ECE391_RING_ENTRIES)
+        return -1;
+    sqe = &ring->sq[ring->sq_tail % ECE391_RING_ENTRIES];
+    sqe->op = op;
+    sqe->fd = fd;
+    sqe->buf = (uint32_t)buf;
+    sqe->nbytes = nbytes;
+    sqe->user_data = user_data;
+    ring->sq_tail++;
+    return 0;
+}
+
+/* Takes the oldest result off the ring.  Returns 1, or 0 if there is none. */
+int32_t ece391_ring_reap(ece391_ring_t* ring, ece391_cqe_t* cqe)
+{
+    if (ring->cq_head == ring->cq_tail)
+        return 0;
+    *cqe = ring->cq[ring->cq_head % ECE391_RING_ENTRIES];
+    ring->cq_head++;
+    return 1;
+}
+
+/* The page the kernel shares with every program */
+const ece391_vdso_t* ece391_vdso(void)
+{
+    return (const ece391_vdso_t*)ECE391_VDSO_ADDR;
+}
+
+/* PIT ticks since boot */
+uint32_t ece391_ticks(void)
+{
+    return ece391_vdso ()->ticks;
+}
+
+/* Milliseconds since boot: whole ticks, plus the time-stamp counter since
+ * the last one.  Read again if a tick came in halfway. */
+uint32_t ece391_clock_ms(void)
+{
+    const ece391_vdso_t* v = ece391_vdso ();
+    uint32_t seq, ticks, ms;
+    uint64_t tsc;
+
+    do {
+        seq = v->seq;
+        ticks = v->ticks;
+        tsc = v->tick_tsc;
+    } while ((seq & 1) || seq != v->seq);
+    ms = ticks / v->tick_hz * 1000 + ticks % v->tick_hz * 1000 / v->tick_hz;
+    return ms + ece391_tsc_us (ece391_rdtsc () - tsc, v->tsc_khz) / 1000;
+}
+
+/* This program's pid, as spawn and waitpid name it */
+uint32_t ece391_getpid(void)
+{
+    return ece391_vdso ()->pid;
+}
+
+/* The terminal this program runs on, 1 to 3 */
+uint32_t ece391_terminal(void)
+{
+    return ece391_vdso ()->terminal;
+}
+
+/* Stores new in *p if it holds old.  Returns what *p held. */
+static uint32_t cmpxchg(volatile uint32_t* p, uint32_t old, uint32_t new)
+{
+    uint32_t prev;
+
+    asm volatile ("lock; cmpxchgl %2, %1"
+                  : "=a" (prev), "+m" (*p)
+                  : "r" (new), "0" (old)
+                  : "memory");
+    return prev;
+}
+
+/* Stores v in *p and returns what it held. */
+static uint32_t xchg(volatile uint32_t* p, uint32_t v)
+{
+    asm volatile ("xchgl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+    return v;
+}
+
+/* Takes the mutex.  Free, it is one locked instruction; held, the state
+ * goes to 2 so the holder knows to wake someone, and the caller sleeps. */
+void ece391_mutex_lock(ece391_mutex_t* m)
+{
+    uint32_t c;
+
+    if (0 == (c = cmpxchg (&m->state, 0, 1)))
+        return;
+    if (2 != c)
+        c = xchg (&m->state, 2);
+    while (0 != c) {
+        (void)ece391_futex_wait ((uint32_t*)&m->state, 2);
+        c = xchg (&m->state, 2);
+    }
+}
+
+/* Returns 1 if it took the mutex, 0 if it was held. */
+int32_t ece391_mutex_trylock(ece391_mutex_t* m)
+{
+    return 0 == cmpxchg (&m->state, 0, 1);
+}
+
+/* Only a mutex someone went to sleep on costs a system call. */
+void ece391_mutex_unlock(ece391_mutex_t* m)
+{
+    if (2 == xchg (&m->state, 0))
+        (void)ece391_futex_wake ((uint32_t*)&m->state, 1);
+}
+
+/* Releases m, sleeps until a signal after this call, then takes m again.
+ * Like any condition variable it can wake early, so check in a loop. */
+void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m)
+{
+    uint32_t seq;
+
+    /* counted before seq is read, so a signal that sees no waiters
+     * has already moved seq past what this one sleeps on */
+    asm volatile ("lock; incl %0" : "+m" (c->waiters) : : "memory");
+    seq = c->seq;
+    ece391_mutex_unlock (m);
+    (void)ece391_futex_wait ((uint32_t*)&c->seq, seq);
+    asm volatile ("lock; decl %0" : "+m" (c->waiters) : : "memory");
+    ece391_mutex_lock (m);
+}
+
+/* With nobody in cond_wait, only seq moves and no system call is made. */
+void ece391_cond_signal(ece391_cond_t* c)
+{
+    asm volatile ("lock; incl %0" : "+m" (c->seq) : : "memory");
+    if (0 != c->waiters)
+        (void)ece391_futex_wake ((uint32_t*)&c->seq, 1);
+}
+
+void ece391_cond_broadcast(ece391_cond_t* c)
+{
+    asm volatile ("lock; incl %0" : "+m" (c->seq) : : "memory");
+    if (0 != c->waiters)
+        (void)ece391_futex_wake ((uint32_t*)&c->seq, 0x7FFFFFFF);
+}
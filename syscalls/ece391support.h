@@ -1,6 +1,8 @@
 #if !defined(ECE391SUPPORT_H)
 #define ECE391SUPPORT_H
 
+#include "ece391syscall.h"
+
 extern uint32_t ece391_strlen(const uint8_t* s);
 extern void ece391_strcpy(uint8_t* dst, const uint8_t* src);
 extern void ece391_fdputs(int32_t fd, const uint8_t* s);
@@ -9,5 +11,48 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* lookups in the table mapped by ece391_fsmap, no system calls */
+extern int32_t ece391_fsmap_lookup(const ece391_fsmap_t* map, const uint8_t* name);
+extern int32_t ece391_fsmap_size(const ece391_fsmap_t* map, int32_t index);
+
+/* helpers for reading the text files under /proc */
+extern int32_t ece391_read_file(const uint8_t* name, uint8_t* buf, int32_t size);
+extern uint32_t ece391_next_num(const uint8_t** p);
+
+/* timing for the benchmark programs */
+extern uint64_t ece391_rdtsc(void);
+extern uint32_t ece391_tsc_khz(void);
+extern uint32_t ece391_tsc_us(uint64_t cycles, uint32_t khz);
+
+/* queueing on a ring for ece391_ring_enter, no system calls */
+extern int32_t ece391_ring_queue(ece391_ring_t* ring, uint32_t op, int32_t fd, const void* buf,
+                                 int32_t nbytes, uint32_t user_data);
+extern int32_t ece391_ring_reap(ece391_ring_t* ring, ece391_cqe_t* cqe);
+
+/* reads of the kernel's shared page, no system calls */
+extern const ece391_vdso_t* ece391_vdso(void);
+extern uint32_t ece391_ticks(void);
+extern uint32_t ece391_clock_ms(void);
+extern uint32_t ece391_getpid(void);
+extern uint32_t ece391_terminal(void);
+
+/* locks for threads, entering the kernel only when they have to wait or
+ * someone is waiting.  Both start out zeroed. */
+typedef struct ece391_mutex {
+    volatile uint32_t state;    /* 0 free, 1 held, 2 held with sleepers */
+} ece391_mutex_t;
+
+typedef struct ece391_cond {
+    volatile uint32_t seq;      /* bumped by every signal */
+    volatile uint32_t waiters;  /* threads in cond_wait, no wake is sent at 0 */
+} ece391_cond_t;
+
+extern void ece391_mutex_lock(ece391_mutex_t* m);
+extern int32_t ece391_mutex_trylock(ece391_mutex_t* m);
+extern void ece391_mutex_unlock(ece391_mutex_t* m);
+extern void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m);
+extern void ece391_cond_signal(ece391_cond_t* c);
+extern void ece391_cond_broadcast(ece391_cond_t* c);
+
 #endif /* ECE391SUPPORT_H */
 
@@ -3,6 +3,119 @@
 
 #include <stdint.h>
 
+/* File status filled in by stat and fstat.  The filetype is 0 for the
+ * RTC, 1 for a directory, 2 for a regular file and 3 for the terminal. */
+typedef struct ece391_stat {
+    uint32_t size;
+    uint32_t filetype;
+    uint32_t inode;
+    uint32_t blocks;
+} ece391_stat_t;
+
+/* Directory record filled in by getdents; as many as fit are packed
+ * back to back.  The name is not NUL-terminated when it is 32 bytes. */
+typedef struct __attribute__((packed)) ece391_dirent {
+    uint32_t inode;
+    uint32_t size;
+    uint8_t filetype;
+    uint8_t name_len;
+    uint8_t name[32];
+} ece391_dirent_t;
+
+/* Root directory entry as stored in the boot block. */
+typedef struct ece391_dentry {
+    uint8_t name[32];
+    int32_t filetype;
+    int32_t inode;
+    int8_t reserved[24];
+} ece391_dentry_t;
+
+#define ECE391_FSMAP_INODES 1020
+#define ECE391_FSMAP_DENTRIES 63
+
+/* Read-only directory table mapped by fsmap.  The first page holds the
+ * counts and the length of every inode, the second is a copy of the
+ * boot block.  The generation changes whenever another image is mounted,
+ * so a program can tell that names it looked up earlier are stale. */
+typedef struct ece391_fsmap {
+    uint32_t generation;
+    uint32_t dir_count;
+    uint32_t inode_count;
+    uint32_t data_count;
+    uint32_t i_length[ECE391_FSMAP_INODES];
+    int32_t boot_dir_count;
+    int32_t boot_inode_count;
+    int32_t boot_data_count;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t features;
+    int8_t boot_reserved[40];
+    ece391_dentry_t dentries[ECE391_FSMAP_DENTRIES];
+} ece391_fsmap_t;
+
+/* Read-only page the kernel keeps up to date at ECE391_VDSO_ADDR in every
+ * program.  seq is odd while the kernel is writing and changes with every
+ * update, so a reader that sees it change reads again. */
+#define ECE391_VDSO_ADDR 0x8400000
+
+typedef struct ece391_vdso {
+    volatile uint32_t seq;
+    volatile uint32_t ticks;        /* PIT interrupts since boot */
+    volatile uint32_t tick_hz;      /* PIT interrupts per second */
+    volatile uint32_t tsc_khz;      /* time-stamp counter ticks per ms */
+    volatile uint64_t boot_tsc;     /* time-stamp counter at calibration */
+    volatile uint64_t tick_tsc;     /* time-stamp counter at the last tick */
+    volatile uint32_t pid;          /* this program */
+    volatile uint32_t tid;          /* this thread */
+    volatile uint32_t terminal;     /* 1 to 3 */
+} ece391_vdso_t;
+
+/* A pair of queues in the program's own memory for running many calls
+ * with one trap.  The program fills sq[sq_tail % ECE391_RING_ENTRIES] and
+ * bumps sq_tail; ring_enter runs the queued calls in order and posts each
+ * result to cq, and the program takes them from cq_head.  The ops are
+ * read, write, open and close, numbered as their system calls. */
+#define ECE391_RING_ENTRIES 64
+
+typedef struct ece391_sqe {
+    uint32_t op;            /* SYS_READ, SYS_WRITE, SYS_OPEN or SYS_CLOSE */
+    int32_t fd;
+    uint32_t buf;           /* buffer, or file name for open */
+    int32_t nbytes;
+    uint32_t user_data;     /* copied to the completion */
+} ece391_sqe_t;
+
+typedef struct ece391_cqe {
+    int32_t result;         /* what the system call would have returned */
+    uint32_t user_data;
+} ece391_cqe_t;
+
+typedef struct ece391_ring {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    ece391_sqe_t sq[ECE391_RING_ENTRIES];
+    ece391_cqe_t cq[ECE391_RING_ENTRIES];
+} ece391_ring_t;
+
+/* One fd for poll to watch.  events asks for ECE391_POLLIN (a read would
+ * not wait) and ECE391_POLLOUT (a write would not wait); revents says
+ * which are true, plus ERR for a pipe nobody reads, HUP for a pipe nobody
+ * writes and NVAL for an fd that is not open.  A negative fd is skipped. */
+#define ECE391_POLLIN   0x01
+#define ECE391_POLLOUT  0x04
+#define ECE391_POLLERR  0x08
+#define ECE391_POLLHUP  0x10
+#define ECE391_POLLNVAL 0x20
+#define ECE391_POLL_MAX 16
+
+typedef struct ece391_pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+} ece391_pollfd_t;
+
 /* All calls return >= 0 on success or -1 on failure. */
 
 /*  
@@ -19,8 +132,62 @@ extern int32_t ece391_open (const uint8_t* filename);
 extern int32_t ece391_close (int32_t fd);
 extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
+/* A handler runs on the program's stack the next time the thread leaves
+ * the kernel, and returns into a sigreturn that resumes where it was.
+ * Without one, DIV_ZERO, SEGFAULT and INTERRUPT (ctrl-c) halt the program
+ * and ALARM and USER1 are ignored. */
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_stat (const uint8_t* filename, ece391_stat_t* buf);
+extern int32_t ece391_fstat (int32_t fd, ece391_stat_t* buf);
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_fsmap (const ece391_fsmap_t** map);
+/* fds[0] reads what is written to fds[1] */
+extern int32_t ece391_pipe (int32_t fds[2]);
+/* Starts command and returns its pid without waiting for it.  The child's
+ * stdin and stdout are copies of the caller's in_fd and out_fd. */
+extern int32_t ece391_spawn (const uint8_t* command, int32_t in_fd, int32_t out_fd);
+/* Waits for child pid, or any child if pid is -1, to halt and frees it.
+ * The status is what execute would have returned for it.  With WNOHANG
+ * it returns 0 instead of sleeping when no such child has halted yet. */
+#define WNOHANG 1
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t flags);
+/* Starts fn (arg) in a new thread that shares this program's memory and
+ * files but has its own stack, and returns its id.  The thread halts with
+ * what fn returns; thread_join waits for that and collects the status.
+ * When the program's first thread halts, the others go with it. */
+extern int32_t ece391_thread_create (int32_t (*fn)(void*), void* arg);
+extern int32_t ece391_thread_join (int32_t tid, int32_t* status);
+/* futex_wait sleeps until futex_wake on the same word, but returns -1 at
+ * once if *addr no longer equals expected.  futex_wake wakes up to n
+ * sleepers and returns how many it woke.  addr must be 4-byte aligned. */
+extern int32_t ece391_futex_wait (uint32_t* addr, uint32_t expected);
+extern int32_t ece391_futex_wake (uint32_t* addr, int32_t n);
+/* Runs what is queued on ring and returns how many calls it ran; it stops
+ * early if the completion queue fills up. */
+extern int32_t ece391_ring_enter (ece391_ring_t* ring);
+/* System calls use SYSENTER when the CPU has it.  ece391_fast_syscalls (0)
+ * goes back to int $0x80, and it returns 1 if SYSENTER is in use. */
+extern int32_t ece391_fast_syscalls (int32_t on);
+/* Raises ALARM every ms milliseconds, or never for 0; the default is every
+ * 10 seconds.  Returns the previous period. */
+extern int32_t ece391_alarm (uint32_t ms);
+/* Sleeps until one of nfds fds is ready and returns how many are, or 0
+ * once timeout ms pass; 0 only looks and -1 waits as long as it takes.
+ * It returns -1 early for a signal that has a handler or would halt. */
+extern int32_t ece391_poll (ece391_pollfd_t* fds, uint32_t nfds, int32_t timeout);
+/* A program started by execute or spawn gets a copy of every descriptor
+ * of its caller under the same number, except those marked FD_CLOEXEC
+ * with fcntl; execute passes stdin and stdout on as they are, spawn puts
+ * in_fd and out_fd there.  dup copies fd to the lowest free descriptor,
+ * dup2 onto new_fd after closing it, stdin and stdout included.  Up to
+ * 32 descriptors can be open. */
+#define F_GETFD 1
+#define F_SETFD 2
+#define FD_CLOEXEC 1
+extern int32_t ece391_dup (int32_t fd);
+extern int32_t ece391_dup2 (int32_t fd, int32_t new_fd);
+extern int32_t ece391_fcntl (int32_t fd, int32_t cmd, int32_t arg);
 
 enum signums {
 	DIV_ZERO = 0,
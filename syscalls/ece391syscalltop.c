@@ -0,0 +1,106 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 4096
+#define NUM_CALLS 28
+#define NUM_BUCKETS 32
+
+static const char* names[NUM_CALLS] = {
+    "", "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "stat", "fstat", "getdents",
+    "fsmap", "pipe", "spawn", "waitpid", "thread_create", "thread_join",
+    "futex_wait", "futex_wake", "alarm", "ring_enter", "poll",
+    "dup", "dup2", "fcntl"
+};
+
+/* Writes a number padded with spaces to width characters */
+static void put_col (uint32_t n, uint32_t width)
+{
+    uint8_t buf[12];
+    uint32_t len;
+
+    ece391_itoa (n, buf, 10);
+    for (len = ece391_strlen (buf); len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, buf);
+}
+
+static const uint8_t* next_line (const uint8_t* p)
+{
+    while ('\0' != *p && '\n' != *p)
+        p++;
+    return '\n' == *p ? p + 1 : p;
+}
+
+/* Bucket b holds calls that took 2^b to 2^(b+1) - 1 cycles, so a call in it
+ * took less than this */
+static uint32_t bucket_limit (uint32_t b)
+{
+    return b + 1 < NUM_BUCKETS ? 1U << (b + 1) : 0xFFFFFFFF;
+}
+
+/* The bucket limit that pct percent of the calls came in under */
+static uint32_t percentile (const uint32_t* counts, uint32_t lo, uint32_t hi,
+                            uint32_t calls, uint32_t pct)
+{
+    uint32_t want = calls - calls * (100 - pct) / 100, seen = 0, b;
+
+    for (b = lo; b < hi; b++) {
+        seen += counts[b - lo];
+        if (seen >= want)
+            break;
+    }
+    return bucket_limit (b);
+}
+
+/* "syscalltop [pid]" shows how long each system call took, from the log2
+ * cycle histograms in /proc/syscalls: for the whole system since boot, or
+ * for one process since it started */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    const uint8_t* p;
+    uint32_t want = 0, pid, num, calls, kcycles, lo, hi, avg, shown = 0;
+    uint32_t counts[NUM_BUCKETS];
+
+    if (0 == ece391_getargs (buf, BUFSIZE)) {
+        p = buf;
+        want = ece391_next_num (&p);
+    }
+    if (-1 == ece391_read_file ((uint8_t*)"/proc/syscalls", buf, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"could not read /proc/syscalls\n");
+        return 2;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"call           calls   avg cyc   p50 <   p99 <   max <\n");
+    /* pid num calls kcycles first_bucket counts, after a header line */
+    for (p = next_line (buf); '\0' != *p; p = next_line (p)) {
+        pid = ece391_next_num (&p);
+        num = ece391_next_num (&p);
+        calls = ece391_next_num (&p);
+        kcycles = ece391_next_num (&p);
+        lo = ece391_next_num (&p);
+        if (pid != want || num >= NUM_CALLS || 0 == calls || lo >= NUM_BUCKETS)
+            continue;
+        for (hi = lo; hi < NUM_BUCKETS && '\0' != *p && '\n' != *p; hi++)
+            counts[hi - lo] = ece391_next_num (&p);
+        if (hi == lo)
+            continue;
+
+        /* kcycles * 1024 / calls without overflowing */
+        avg = kcycles / calls * 1024 + kcycles % calls * 1024 / calls;
+        ece391_fdputs (1, (uint8_t*)names[num]);
+        put_col (calls, 20 - ece391_strlen ((uint8_t*)names[num]));
+        put_col (avg, 10);
+        put_col (percentile (counts, lo, hi, calls, 50), 8);
+        put_col (percentile (counts, lo, hi, calls, 99), 8);
+        put_col (bucket_limit (hi - 1), 8);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        shown++;
+    }
+    if (0 == shown)
+        ece391_fdputs (1, (uint8_t*)"no timed system calls for that pid\n");
+    return 0;
+}
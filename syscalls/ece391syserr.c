@@ -7,6 +7,7 @@
 #define BIG_FD 1073741823
 #define BIG_NUM 1073741823
 #define NEG_NUM -1073741823
+#define MAX_FDS 32
 
 /* call_sys
  * This function calls the system call #(num)
@@ -91,7 +92,7 @@ int err_big_fd(void) {
 
 
 /* TEST 3 err_open_lots
- * calls open correctly seven times
+ * calls open correctly MAX_FDS - 1 times
  * prints "[TEST_NAME]: PASS" if behavior is EXPECTED
  *     and then returns 0
  * prints "[TEST_NAME]: FAIL" if behavior is UNEXPECTED
@@ -100,15 +101,15 @@ int err_big_fd(void) {
 int err_open_lots(void) {
     int32_t i, cnt = 0;
 	
-	// fd = 0,1 taken, so we should be able to open 6 files (2,3,4,5,6,7)
-	// the last file open should fail
-    for (i = 0; i < 7; i++) {
+	// fd = 0,1 taken, so we should be able to open MAX_FDS - 2 files as
+	// the table grows; the last file open should fail
+    for (i = 0; i < MAX_FDS - 1; i++) {
 	    if (-1 == ece391_open ((uint8_t*)".")) {
 			cnt++;
         }
     }
     //close all fds that were just opened.
-    for(i = 2; i < 8; i++)
+    for(i = 2; i < MAX_FDS; i++)
     {
     	ece391_close(i);
     }
@@ -292,6 +293,53 @@ int err_vidmap(void) {
 	return fail;
  }
 
+ /* TEST 9 err_syscall_args
+ * reads the first 5 bytes of frame0.txt and sets FD_CLOEXEC through fcntl,
+ * once over int $0x80 and once over SYSENTER, so a call's second and third
+ * arguments have to arrive intact on both ways in
+ * prints "[TEST_NAME]: PASS" if behavior is EXPECTED
+ *     and then returns 0
+ * prints "[TEST_NAME]: FAIL" if behavior is UNEXPECTED
+ *     and then returns 2
+ */
+
+ int err_syscall_args(void)
+ {
+	int fail = 0;
+	int fast, fd;
+	uint8_t buf[32];
+
+	for (fast = 0; fast < 2; fast++) {
+		if (fast != ece391_fast_syscalls(fast))
+			break;		/* no SYSENTER on this CPU */
+		if (-1 == (fd = ece391_open((uint8_t*)"frame0.txt"))) {
+			ece391_fdputs (1, (uint8_t*)"open frame0.txt fail\n");
+			fail = 2;
+			break;
+		}
+		buf[5] = '\0';
+		if (5 != ece391_read(fd, buf, 5) || 0 != ece391_strcmp(buf, (uint8_t*)"/\\/\\/")) {
+			ece391_fdputs (1, (uint8_t*)"read arguments fail\n");
+			fail = 2;
+		}
+		if (0 != ece391_fcntl(fd, F_SETFD, FD_CLOEXEC)
+			|| FD_CLOEXEC != ece391_fcntl(fd, F_GETFD, 0)) {
+			ece391_fdputs (1, (uint8_t*)"fcntl flag fail\n");
+			fail = 2;
+		}
+		ece391_close(fd);
+	}
+	(void)ece391_fast_syscalls(1);
+
+	if (fail) {
+		ece391_fdputs (1, (uint8_t*)"err_syscall_args: FAIL\n");
+	} else {
+		ece391_fdputs (1, (uint8_t*)"err_syscall_args: PASS\n");
+	}
+
+	return fail;
+ }
+
 
 int main ()
 {
@@ -299,7 +347,7 @@ int main ()
     uint8_t buf[128];
 	int fail = 0;
 
-    ece391_fdputs (1, (uint8_t*)"Choose from tests 1-8. 0 to run all: ");
+    ece391_fdputs (1, (uint8_t*)"Choose from tests 1-9. 0 to run all: ");
     if (-1 == (cnt = ece391_read (0, buf, 127))) {
         ece391_fdputs (1, (uint8_t*)"Can't read test #\n");
 		return 2;
@@ -316,6 +364,7 @@ int main ()
 			fail += err_vidmap();
 			fail += err_stdin_out();
 			fail += err_syscall_num();
+			fail += err_syscall_args();
 			if(fail) {
 				ece391_fdputs (1, (uint8_t*)"\nOverall Tests: FAIL\n");
 			} else {
@@ -338,8 +387,10 @@ int main ()
 			return err_stdin_out();
 		case 8:
 			return err_syscall_num();
+		case 9:
+			return err_syscall_args();
 		default:
-			ece391_fdputs (1, (uint8_t*)"Invalid test number. Choose from tests 1-8 or 0");
+			ece391_fdputs (1, (uint8_t*)"Invalid test number. Choose from tests 1-9 or 0");
 			break;
 	}
     return 0;
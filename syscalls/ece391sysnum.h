@@ -11,5 +11,22 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_STAT    11
+#define SYS_FSTAT   12
+#define SYS_GETDENTS 13
+#define SYS_FSMAP   14
+#define SYS_PIPE    15
+#define SYS_SPAWN   16
+#define SYS_WAITPID 17
+#define SYS_THREAD_CREATE 18
+#define SYS_THREAD_JOIN 19
+#define SYS_FUTEX_WAIT 20
+#define SYS_FUTEX_WAKE 21
+#define SYS_ALARM 22
+#define SYS_RING_ENTER 23
+#define SYS_POLL 24
+#define SYS_DUP 25
+#define SYS_DUP2 26
+#define SYS_FCNTL 27
 
 #endif /* ECE391SYSNUM_H */
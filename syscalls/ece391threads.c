@@ -0,0 +1,74 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TICK_HZ 8
+#define TICKS 16
+#define PRIME_LIMIT 60000
+
+static volatile uint32_t done;	/* set by main once the primes are counted */
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Waits on the RTC in its own thread, a dot per tick, while main computes.
+ * Halts with the number of ticks it saw before main finished. */
+static int32_t ticker (void* arg)
+{
+    int32_t rtc = (int32_t)arg;
+    int32_t rate = TICK_HZ;
+    uint32_t ticks, before = TICKS;
+
+    if (-1 == ece391_write (rtc, &rate, sizeof (rate)))
+        return 0;
+    for (ticks = 0; ticks < TICKS; ticks++) {
+        (void)ece391_read (rtc, &rate, sizeof (rate));
+        if (done && TICKS == before)
+            before = ticks;
+        ece391_fdputs (1, (uint8_t*)".");
+    }
+    return before;
+}
+
+/* Counts primes by trial division while the ticker thread waits on the
+ * RTC, then joins it; both share the program's memory and open files */
+int main ()
+{
+    int32_t rtc, tid, status;
+    uint32_t n, d, count = 0;
+
+    if (-1 == (rtc = ece391_open ((uint8_t*)"/dev/rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"could not open /dev/rtc\n");
+        return 2;
+    }
+    if (-1 == (tid = ece391_thread_create (ticker, (void*)rtc))) {
+        ece391_fdputs (1, (uint8_t*)"could not start a thread\n");
+        return 2;
+    }
+
+    for (n = 2; n < PRIME_LIMIT; n++) {
+        for (d = 2; d * d <= n && 0 != n % d; d++);
+        if (d * d > n)
+            count++;
+    }
+    done = 1;
+
+    if (tid != ece391_thread_join (tid, &status)) {
+        ece391_fdputs (1, (uint8_t*)"join failed\n");
+        return 3;
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+    put_num (count);
+    ece391_fdputs (1, (uint8_t*)" primes counted in ");
+    put_num (status);
+    ece391_fdputs (1, (uint8_t*)" of the ticker's ");
+    put_num (TICKS);
+    ece391_fdputs (1, (uint8_t*)" RTC ticks\n");
+    ece391_close (rtc);
+    return 0;
+}
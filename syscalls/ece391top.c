@@ -0,0 +1,139 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 2048
+#define MAX_PID 8
+#define ROUNDS 10
+#define RTC_HZ 2
+
+static uint32_t last_ticks[MAX_PID], last_calls[MAX_PID];
+
+/* Writes a number padded with spaces to width characters */
+static void put_col (uint32_t n, uint32_t width)
+{
+    uint8_t buf[12];
+    uint32_t len;
+
+    ece391_itoa (n, buf, 10);
+    for (len = ece391_strlen (buf); len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, buf);
+}
+
+static const uint8_t* next_line (const uint8_t* p)
+{
+    while ('\0' != *p && '\n' != *p)
+        p++;
+    return '\n' == *p ? p + 1 : p;
+}
+
+static uint32_t line_sum (const uint8_t* p)
+{
+    uint32_t sum = 0;
+
+    while ('\0' != *p && '\n' != *p)
+        sum += ece391_next_num (&p);
+    return sum;
+}
+
+static uint32_t percent (uint32_t part, uint32_t whole)
+{
+    return 0 == whole ? 0 : part * 100 / whole;
+}
+
+/* Prints what changed since the last round, from three reads of /proc */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    const uint8_t* p;
+    uint32_t rounds = ROUNDS, r, i, pid, ticks, calls, rate = RTC_HZ;
+    uint32_t now[4], last[4] = {0, 0, 0, 0};   /* ticks, switches, syscalls, irqs */
+    uint32_t cache[5];
+    int32_t rtc;
+
+    if (0 == ece391_getargs (buf, BUFSIZE) && buf[0] >= '0' && buf[0] <= '9') {
+        p = buf;
+        rounds = ece391_next_num (&p);
+    }
+    if (-1 == (rtc = ece391_open ((uint8_t*)"/dev/rtc"))
+        || -1 == ece391_write (rtc, &rate, sizeof (rate))) {
+        ece391_fdputs (1, (uint8_t*)"could not open /dev/rtc\n");
+        return 2;
+    }
+
+    for (r = 0; r <= rounds; r++) {
+        if (-1 == ece391_read_file ((uint8_t*)"/proc/stat", buf, BUFSIZE)) {
+            ece391_fdputs (1, (uint8_t*)"could not read /proc/stat\n");
+            return 2;
+        }
+        /* ticks, hz, tsc_khz, context_switches, syscalls, irqs */
+        p = buf;
+        now[0] = ece391_next_num (&p);
+        p = next_line (next_line (next_line (p)));
+        now[1] = ece391_next_num (&p);
+        p = next_line (p);
+        now[2] = line_sum (p);
+        now[3] = line_sum (next_line (p));
+
+        if (0 != r) {
+            ece391_fdputs (1, (uint8_t*)"ticks");
+            put_col (now[0] - last[0], 5);
+            ece391_fdputs (1, (uint8_t*)"  switches");
+            put_col (now[1] - last[1], 5);
+            ece391_fdputs (1, (uint8_t*)"  syscalls");
+            put_col (now[2] - last[2], 7);
+            ece391_fdputs (1, (uint8_t*)"  irqs");
+            put_col (now[3] - last[3], 6);
+            ece391_fdputs (1, (uint8_t*)"\n");
+
+            if (-1 != ece391_read_file ((uint8_t*)"/proc/fscache", buf, BUFSIZE)) {
+                for (p = buf, i = 0; i < 5; i++, p = next_line (p))
+                    cache[i] = ece391_next_num (&p);
+                ece391_fdputs (1, (uint8_t*)"dcache hit%");
+                put_col (percent (cache[0], cache[0] + cache[1]), 4);
+                ece391_fdputs (1, (uint8_t*)"  bcache hit%");
+                put_col (percent (cache[2], cache[2] + cache[3]), 4);
+                ece391_fdputs (1, (uint8_t*)"\n");
+            }
+        }
+
+        if (-1 == ece391_read_file ((uint8_t*)"/proc/ps", buf, BUFSIZE)) {
+            ece391_fdputs (1, (uint8_t*)"could not read /proc/ps\n");
+            return 2;
+        }
+        if (0 != r)
+            ece391_fdputs (1, (uint8_t*)"  pid cpu%  calls name\n");
+        /* pid ppid tty ticks syscalls state name, after a header line */
+        for (p = next_line (buf); '\0' != *p; p = next_line (p)) {
+            pid = ece391_next_num (&p);
+            (void)ece391_next_num (&p);
+            (void)ece391_next_num (&p);
+            ticks = ece391_next_num (&p);
+            calls = ece391_next_num (&p);
+            if (pid >= MAX_PID)
+                continue;
+            if (0 != r) {
+                put_col (pid, 5);
+                put_col (percent (ticks - last_ticks[pid], now[0] - last[0]), 5);
+                put_col (calls - last_calls[pid], 7);
+                /* skip the state letter, the name is the rest of the line */
+                for (p += 3, i = 0; '\0' != p[i] && '\n' != p[i]; i++);
+                ece391_fdputs (1, (uint8_t*)" ");
+                (void)ece391_write (1, p, i);
+                ece391_fdputs (1, (uint8_t*)"\n");
+            }
+            last_ticks[pid] = ticks;
+            last_calls[pid] = calls;
+        }
+        for (i = 0; i < 4; i++)
+            last[i] = now[i];
+
+        /* one second between rounds */
+        for (i = 0; r < rounds && i < RTC_HZ; i++)
+            (void)ece391_read (rtc, &rate, sizeof (rate));
+    }
+
+    return 0;
+}
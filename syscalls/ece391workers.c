@@ -0,0 +1,98 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 128
+#define MAX_WORKERS 8
+#define DEFAULT_WORKERS 2
+#define PRIME_LIMIT 40000
+#define STATUS_BASE 10	/* a worker's status is STATUS_BASE plus its index */
+
+static void put_num (uint32_t n)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, ece391_itoa (n, num, 10));
+}
+
+/* Something for a worker to chew on, counted by trial division. */
+static uint32_t count_primes (uint32_t limit)
+{
+    uint32_t n, d, count = 0;
+
+    for (n = 2; n < limit; n++) {
+        for (d = 2; d * d <= n && 0 != n % d; d++);
+        if (d * d > n)
+            count++;
+    }
+    return count;
+}
+
+/* "workers -w i" is one worker, halting with STATUS_BASE + i */
+static int32_t worker (const uint8_t* p)
+{
+    uint32_t i = ece391_next_num (&p);
+
+    ece391_fdputs (1, (uint8_t*)"worker ");
+    put_num (i);
+    ece391_fdputs (1, (uint8_t*)": ");
+    put_num (count_primes (PRIME_LIMIT + i * 1000));
+    ece391_fdputs (1, (uint8_t*)" primes\n");
+    return STATUS_BASE + i;
+}
+
+/* "workers [n]" spawns n copies of itself at once, then collects their
+ * exit statuses with waitpid (-1) in whatever order they halt */
+int main ()
+{
+    uint8_t args[BUFSIZE], cmd[BUFSIZE], num[12];
+    const uint8_t* p = args;
+    int32_t pids[MAX_WORKERS], pid, status, bad = 0;
+    uint32_t n = DEFAULT_WORKERS, started, i, khz;
+    uint64_t start;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+        if (0 == ece391_strncmp (args, (uint8_t*)"-w", 2))
+            return worker (args + 2);
+        n = ece391_next_num (&p);
+        if (0 == n || n > MAX_WORKERS)
+            n = DEFAULT_WORKERS;
+    }
+
+    khz = ece391_tsc_khz ();
+    start = ece391_rdtsc ();
+    for (started = 0; started < n; started++) {
+        ece391_strcpy (cmd, (uint8_t*)"workers -w ");
+        ece391_strcpy (cmd + ece391_strlen (cmd), ece391_itoa (started, num, 10));
+        if (-1 == (pids[started] = ece391_spawn (cmd, 0, 1))) {
+            ece391_fdputs (1, (uint8_t*)"no process free for worker ");
+            put_num (started);
+            ece391_fdputs (1, (uint8_t*)"\n");
+            break;
+        }
+    }
+
+    while (0 < (pid = ece391_waitpid (-1, &status, 0))) {
+        for (i = 0; i < started && pids[i] != pid; i++);
+        ece391_fdputs (1, (uint8_t*)"pid ");
+        put_num (pid);
+        ece391_fdputs (1, (uint8_t*)" exited with ");
+        put_num (status);
+        if (i == started || STATUS_BASE + i != (uint32_t)status) {
+            ece391_fdputs (1, (uint8_t*)", expected another status");
+            bad++;
+        }
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    put_num (started);
+    ece391_fdputs (1, (uint8_t*)" workers collected");
+    if (0 != khz) {
+        ece391_fdputs (1, (uint8_t*)" in ");
+        put_num (ece391_tsc_us (ece391_rdtsc () - start, khz) / 1000);
+        ece391_fdputs (1, (uint8_t*)" ms");
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0 == bad ? 0 : 3;
+}